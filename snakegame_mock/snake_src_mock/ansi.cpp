@@ -0,0 +1,218 @@
+#include <unistd.h>
+#include <cstring>
+
+#include "ansi.h"
+#include "termout.h"
+
+namespace
+{
+
+// A cursor move costs about this many bytes, shorter gaps are written over
+const int MaxSkipByWriting = 4;
+
+volatile sig_atomic_t gResized = 0;
+
+void onResize(int)
+{
+    gResized = 1;
+}
+
+}
+
+AnsiRenderer::AnsiRenderer(): AnsiRenderer(STDOUT_FILENO, getTerminalWidth(), getTerminalHeight())
+{
+    this->mInputFd = STDIN_FILENO;
+    tcgetattr(this->mInputFd, &this->mSavedTerminal);
+    termios raw = this->mSavedTerminal;
+    // Keys come one at a time without echo, read never waits
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(this->mInputFd, TCSANOW, &raw);
+    struct sigaction resize = {};
+    resize.sa_handler = onResize;
+    resize.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &resize, &this->mSavedResize);
+    // Own screen, no cursor, cleared
+    const char start[] = "\x1b[?1049h\x1b[?25l\x1b[H\x1b[2J";
+    writeTerminal(this->mOutputFd, start, sizeof(start) - 1);
+}
+
+AnsiRenderer::AnsiRenderer(int outputFd, int width, int height): CellRenderer(width, height), mOutputFd(outputFd), mFront(width * height)
+{
+    // Worst case every cell needs a move and a style change
+    this->mOutput.reserve(width * height * 16);
+}
+
+AnsiRenderer::~AnsiRenderer()
+{
+    if (this->mInputFd >= 0)
+    {
+        const char end[] = "\x1b[0m\x1b(B\x1b[?25h\x1b[?1049l";
+        writeTerminal(this->mOutputFd, end, sizeof(end) - 1);
+        tcsetattr(this->mInputFd, TCSANOW, &this->mSavedTerminal);
+        sigaction(SIGWINCH, &this->mSavedResize, nullptr);
+    }
+}
+
+void AnsiRenderer::present()
+{
+    this->mOutput.clear();
+    if (this->mClearScreen)
+    {
+        this->mOutput += "\x1b[2J";
+        this->mClearScreen = false;
+    }
+    int width = this->getWidth();
+    for (int y = 0; y < this->getHeight(); y ++)
+    {
+        // Most rows don't change from one frame to the next
+        if (std::memcmp(&this->mScreen[y * width], &this->mFront[y * width], width * sizeof(Cell)) == 0)
+        {
+            continue;
+        }
+        for (int x = 0; x < width; x ++)
+        {
+            const Cell& cell = this->mScreen[y * width + x];
+            if (cell == this->mFront[y * width + x])
+            {
+                continue;
+            }
+            this->moveCursor(x, y);
+            this->putCell(cell);
+            this->mFront[y * width + x] = cell;
+        }
+    }
+    writeTerminalFrame(this->mOutputFd, this->mOutput.data(), this->mOutput.size());
+}
+
+int AnsiRenderer::readKey()
+{
+    if (this->mInputFd < 0)
+    {
+        return NoKey;
+    }
+    // Any number of resizes since the last key make one
+    if (gResized)
+    {
+        gResized = 0;
+        int width = getTerminalWidth();
+        int height = getTerminalHeight();
+        this->resizeScreen(width, height);
+        this->mFront.assign(width * height, Cell());
+        this->mOutput.reserve(width * height * 16);
+        this->mCursorX = -1;
+        this->mCursorY = -1;
+        this->mClearScreen = true;
+        return KeyResize;
+    }
+    ssize_t received = read(this->mInputFd, this->mInput + this->mNumInput, sizeof(this->mInput) - this->mNumInput);
+    if (received > 0)
+    {
+        this->mNumInput += received;
+    }
+    if (this->mNumInput == 0)
+    {
+        return NoKey;
+    }
+    int key = static_cast<unsigned char>(this->mInput[0]);
+    int used = 1;
+    // Arrows are ESC [ A to D, or ESC O A to D in application mode
+    if (key == 27 && this->mNumInput >= 3 && (this->mInput[1] == '[' || this->mInput[1] == 'O'))
+    {
+        switch (this->mInput[2])
+        {
+            case 'A':
+                key = KeyUp;
+                break;
+            case 'B':
+                key = KeyDown;
+                break;
+            case 'C':
+                key = KeyRight;
+                break;
+            case 'D':
+                key = KeyLeft;
+                break;
+        }
+        used = key == 27 ? 1 : 3;
+    }
+    this->mNumInput -= used;
+    std::memmove(this->mInput, this->mInput + used, this->mNumInput);
+    return key;
+}
+
+void AnsiRenderer::moveCursor(int x, int y)
+{
+    if (x == this->mCursorX && y == this->mCursorY)
+    {
+        return;
+    }
+    if (y == this->mCursorY && this->mCursorX >= 0 && x > this->mCursorX)
+    {
+        if (x - this->mCursorX <= MaxSkipByWriting)
+        {
+            // The cells in between are unchanged, writing them again is shorter
+            for (int i = this->mCursorX; i < x; i ++)
+            {
+                this->putCell(this->mFront[y * this->getWidth() + i]);
+            }
+            return;
+        }
+        this->mOutput += "\x1b[";
+        this->appendNumber(x - this->mCursorX);
+        this->mOutput += 'C';
+    }
+    else if (y == this->mCursorY + 1 && x == 0 && this->mCursorY >= 0)
+    {
+        this->mOutput += "\r\n";
+    }
+    else
+    {
+        this->mOutput += "\x1b[";
+        this->appendNumber(y + 1);
+        this->mOutput += ';';
+        this->appendNumber(x + 1);
+        this->mOutput += 'H';
+    }
+    this->mCursorX = x;
+    this->mCursorY = y;
+}
+
+void AnsiRenderer::putCell(const Cell& cell)
+{
+    unsigned char changed = cell.style ^ this->mStyle;
+    if (changed & StandoutStyle)
+    {
+        this->mOutput += cell.style & StandoutStyle ? "\x1b[7m" : "\x1b[27m";
+    }
+    if (changed & LineStyle)
+    {
+        this->mOutput += cell.style & LineStyle ? "\x1b(0" : "\x1b(B";
+    }
+    this->mStyle = cell.style;
+    this->mOutput += cell.symbol;
+    this->mCursorX ++;
+    // The last column leaves the cursor waiting to wrap, better not count on it
+    if (this->mCursorX >= this->getWidth())
+    {
+        this->mCursorX = -1;
+        this->mCursorY = -1;
+    }
+}
+
+void AnsiRenderer::appendNumber(int number)
+{
+    char digits[12];
+    int length = 0;
+    do
+    {
+        digits[length ++] = '0' + number % 10;
+        number /= 10;
+    }
+    while (number > 0);
+    while (length > 0)
+    {
+        this->mOutput += digits[-- length];
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef ANSI_H
+#define ANSI_H
+
+#include <string>
+#include <vector>
+#include <termios.h>
+#include <signal.h>
+
+#include "cells.h"
+
+// Talks to the terminal with plain ANSI escapes, no curses at all.
+// The front buffer holds what the terminal shows; present sends only the
+// cells that differ from it, moving the cursor the shortest way there.
+class AnsiRenderer : public CellRenderer
+{
+public:
+    // Takes over the terminal
+    AnsiRenderer();
+    // Draws into outputFd as if it were a terminal of the given size
+    AnsiRenderer(int outputFd, int width, int height);
+    ~AnsiRenderer();
+    AnsiRenderer(const AnsiRenderer&) = delete;
+    AnsiRenderer& operator = (const AnsiRenderer&) = delete;
+
+    void present() override;
+    int readKey() override;
+
+private:
+    void moveCursor(int x, int y);
+    void putCell(const Cell& cell);
+    void appendNumber(int number);
+
+    int mOutputFd;
+    // -1 unless we own the terminal
+    int mInputFd = -1;
+    termios mSavedTerminal;
+    struct sigaction mSavedResize;
+    // After a resize the terminal shows who knows what, the next frame starts from a cleared one
+    bool mClearScreen = false;
+    std::vector<Cell> mFront;
+    std::string mOutput;
+    // Where the terminal's cursor is, -1 when we don't know
+    int mCursorX = -1;
+    int mCursorY = -1;
+    unsigned char mStyle = 0;
+    char mInput[16];
+    int mNumInput = 0;
+};
+
+#endif
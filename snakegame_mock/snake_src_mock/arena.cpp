@@ -0,0 +1,416 @@
+#include <algorithm>
+
+#include "arena.h"
+
+Arena::Arena(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength, unsigned int seed): mGameBoardWidth(gameBoardWidth), mGameBoardHeight(gameBoardHeight), mInitialSnakeLength(initialSnakeLength), mRandom(seed)
+{
+    // An arena of a size isArenaSize refuses is never stepped, it gets no grids
+    size_t cells = isArenaSize(gameBoardWidth, gameBoardHeight) ? size_t(gameBoardWidth) * size_t(gameBoardHeight) : 0;
+    this->mGrid.assign(cells, 0);
+    this->mHeadClaim.assign(cells, -1);
+}
+
+bool isArenaSize(int width, int height)
+{
+    return width > 0 && height > 0 && width <= MaxBoardSize && height <= MaxBoardSize
+        && static_cast<long long>(width) * height <= MaxArenaCells;
+}
+
+int Arena::cellIndex(int x, int y) const
+{
+    return y * this->mGameBoardWidth + x;
+}
+
+// The outermost ring of cells is the wall, the same as Snake::hitWall
+bool Arena::isWall(int x, int y) const
+{
+    return x <= 0 || y <= 0 || x >= this->mGameBoardWidth - 1 || y >= this->mGameBoardHeight - 1;
+}
+
+void Arena::ensureSlot(int slot)
+{
+    if (slot < this->getNumSlots())
+    {
+        return;
+    }
+    this->mSnakes.resize(slot + 1);
+    this->mPoints.resize(slot + 1, 0);
+    this->mInputs.resize(slot + 1, Direction::Up);
+    this->mHasInput.resize(slot + 1, 0);
+    this->mRespawned.resize(slot + 1, 0);
+    this->mEaten.resize(slot + 1, 0);
+    this->mPending.resize(slot + 1, 0);
+    this->mDead.resize(slot + 1, 0);
+    this->mNextHeads.resize(slot + 1);
+}
+
+int Arena::addSnake()
+{
+    int slot;
+    if (!this->mFreeSlots.empty())
+    {
+        slot = this->mFreeSlots.back();
+        this->mFreeSlots.pop_back();
+    }
+    else
+    {
+        slot = this->getNumSlots();
+        this->ensureSlot(slot);
+    }
+    this->mPoints[slot] = 0;
+    this->mHasInput[slot] = 0;
+    // The snake enters the board on the next step
+    this->mPending[slot] = 1;
+    return slot;
+}
+
+void Arena::removeSnake(int slot)
+{
+    if (slot < 0 || slot >= this->getNumSlots())
+    {
+        return;
+    }
+    this->clearSnake(slot);
+    this->mPending[slot] = 0;
+    this->mFreeSlots.push_back(slot);
+}
+
+void Arena::setInput(int slot, Direction direction)
+{
+    this->mInputs[slot] = direction;
+    this->mHasInput[slot] = 1;
+}
+
+// Remove a snake from the board, its cells become empty
+void Arena::clearSnake(int slot)
+{
+    if (!this->mSnakes[slot])
+    {
+        return;
+    }
+    const SnakeBodies& body = this->mSnakes[slot]->getSnake();
+    for (int i = 0; i < body.size(); i ++)
+    {
+        this->mGrid[this->cellIndex(body[i].getX(), body[i].getY())] = 0;
+    }
+    this->mSnakes[slot].reset();
+    this->mNumSnakes --;
+}
+
+// Put a fresh snake at a random free place, heading up
+bool Arena::spawnSnake(int slot)
+{
+    int length = this->mInitialSnakeLength;
+    if (this->mGameBoardWidth < 3 || this->mGameBoardHeight < length + 4)
+    {
+        return false;
+    }
+    std::uniform_int_distribution<int> randomX(1, this->mGameBoardWidth - 2);
+    std::uniform_int_distribution<int> randomY(2, this->mGameBoardHeight - 1 - length);
+    for (int attempt = 0; attempt < 64; attempt ++)
+    {
+        int x = randomX(this->mRandom);
+        int y = randomY(this->mRandom);
+        bool free = true;
+        for (int i = -1; i < length && free; i ++)
+        {
+            free = this->mGrid[this->cellIndex(x, y + i)] == 0;
+        }
+        if (!free)
+        {
+            continue;
+        }
+        this->mSnakes[slot].reset(new Snake(this->mGameBoardWidth, this->mGameBoardHeight, length, x, y));
+        for (int i = 0; i < length; i ++)
+        {
+            this->mGrid[this->cellIndex(x, y + i)] = slot + 1;
+        }
+        this->mNumSnakes ++;
+        return true;
+    }
+    return false;
+}
+
+// Drop a food on a random empty cell
+bool Arena::createRamdonFood()
+{
+    std::uniform_int_distribution<int> randomX(1, this->mGameBoardWidth - 2);
+    std::uniform_int_distribution<int> randomY(1, this->mGameBoardHeight - 2);
+    for (int attempt = 0; attempt < 64; attempt ++)
+    {
+        int x = randomX(this->mRandom);
+        int y = randomY(this->mRandom);
+        if (this->mGrid[this->cellIndex(x, y)] != 0)
+        {
+            continue;
+        }
+        this->addFood(SnakeBody(x, y));
+        this->mNewFoods.push_back(SnakeBody(x, y));
+        return true;
+    }
+    return false;
+}
+
+void Arena::eatFood(int index)
+{
+    for (int i = 0; i < this->mFoods.size(); i ++)
+    {
+        if (this->cellIndex(this->mFoods[i].getX(), this->mFoods[i].getY()) == index)
+        {
+            this->mFoods[i] = this->mFoods.back();
+            this->mFoods.pop_back();
+            break;
+        }
+    }
+    this->mGrid[index] = 0;
+}
+
+void Arena::step()
+{
+    int numSlots = this->getNumSlots();
+    this->mTick ++;
+    this->mNewFoods.clear();
+    std::fill(this->mRespawned.begin(), this->mRespawned.end(), 0);
+    std::fill(this->mEaten.begin(), this->mEaten.end(), 0);
+
+    // Snake::changeDirection only takes turns to the side
+    for (int slot = 0; slot < numSlots; slot ++)
+    {
+        if (this->mSnakes[slot] && this->mHasInput[slot])
+        {
+            this->mSnakes[slot]->changeDirection(this->mInputs[slot]);
+        }
+        this->mHasInput[slot] = 0;
+    }
+
+    // Walls and bodies kill, two heads meeting on one cell kill both
+    for (int slot = 0; slot < numSlots; slot ++)
+    {
+        this->mDead[slot] = 0;
+        if (!this->mSnakes[slot])
+        {
+            continue;
+        }
+        SnakeBody next = this->mSnakes[slot]->nextHead();
+        this->mNextHeads[slot] = next;
+        if (this->isWall(next.getX(), next.getY()))
+        {
+            this->mDead[slot] = 1;
+            continue;
+        }
+        int index = this->cellIndex(next.getX(), next.getY());
+        if (this->mGrid[index] > 0)
+        {
+            this->mDead[slot] = 1;
+        }
+        int claim = this->mHeadClaim[index];
+        if (claim == -1)
+        {
+            this->mHeadClaim[index] = slot;
+        }
+        else
+        {
+            this->mDead[slot] = 1;
+            this->mDead[claim] = 1;
+        }
+    }
+    for (int slot = 0; slot < numSlots; slot ++)
+    {
+        if (this->mSnakes[slot] && !this->isWall(this->mNextHeads[slot].getX(), this->mNextHeads[slot].getY()))
+        {
+            this->mHeadClaim[this->cellIndex(this->mNextHeads[slot].getX(), this->mNextHeads[slot].getY())] = -1;
+        }
+    }
+
+    // Move the survivors, dead snakes come back at a new place
+    for (int slot = 0; slot < numSlots; slot ++)
+    {
+        if (!this->mSnakes[slot])
+        {
+            continue;
+        }
+        if (this->mDead[slot])
+        {
+            this->clearSnake(slot);
+            this->mPoints[slot] = 0;
+            this->mPending[slot] = 1;
+            continue;
+        }
+        Snake& snake = *this->mSnakes[slot];
+        SnakeBody head = snake.createNewHead();
+        int index = this->cellIndex(head.getX(), head.getY());
+        if (this->mGrid[index] == -1)
+        {
+            this->eatFood(index);
+            this->mPoints[slot] ++;
+            this->mEaten[slot] = 1;
+        }
+        else
+        {
+            SnakeBody tail = snake.getSnake().back();
+            this->mGrid[this->cellIndex(tail.getX(), tail.getY())] = 0;
+            snake.getSnake().pop_back();
+        }
+        this->mGrid[index] = slot + 1;
+    }
+    for (int slot = 0; slot < numSlots; slot ++)
+    {
+        if (this->mPending[slot] && this->spawnSnake(slot))
+        {
+            this->mPending[slot] = 0;
+            this->mRespawned[slot] = 1;
+        }
+    }
+
+    // Keep about one food per snake on the board
+    int targetFoods = std::max(1, this->mNumSnakes);
+    while (this->mFoods.size() < targetFoods && this->createRamdonFood())
+    {
+    }
+}
+
+int Arena::getWidth() const
+{
+    return this->mGameBoardWidth;
+}
+
+int Arena::getHeight() const
+{
+    return this->mGameBoardHeight;
+}
+
+uint32_t Arena::getTick() const
+{
+    return this->mTick;
+}
+
+int Arena::getNumSlots() const
+{
+    return this->mSnakes.size();
+}
+
+int Arena::getNumSnakes() const
+{
+    return this->mNumSnakes;
+}
+
+bool Arena::isActive(int slot) const
+{
+    return slot >= 0 && slot < this->getNumSlots() && this->mSnakes[slot] != nullptr;
+}
+
+Snake& Arena::getSnake(int slot) const
+{
+    return *this->mSnakes[slot];
+}
+
+int Arena::getPoints(int slot) const
+{
+    return this->mPoints[slot];
+}
+
+bool Arena::isRespawned(int slot) const
+{
+    return this->mRespawned[slot];
+}
+
+bool Arena::hasEaten(int slot) const
+{
+    return this->mEaten[slot];
+}
+
+const SnakeBodies& Arena::getFoods() const
+{
+    return this->mFoods;
+}
+
+const SnakeBodies& Arena::getNewFoods() const
+{
+    return this->mNewFoods;
+}
+
+// Start a mirror over from an empty board
+void Arena::resetMirror(uint32_t tick, int numSlots)
+{
+    for (int slot = 0; slot < this->getNumSlots(); slot ++)
+    {
+        this->clearSnake(slot);
+    }
+    while (!this->mFoods.empty())
+    {
+        SnakeBody food = this->mFoods.back();
+        this->eatFood(this->cellIndex(food.getX(), food.getY()));
+    }
+    this->ensureSlot(numSlots - 1);
+    this->mTick = tick;
+}
+
+void Arena::loadSnake(int slot, const SnakeBodies& body, Direction direction, int points)
+{
+    this->ensureSlot(slot);
+    this->clearSnake(slot);
+    this->mSnakes[slot].reset(new Snake(this->mGameBoardWidth, this->mGameBoardHeight, body.size(), body[0].getX(), body[0].getY()));
+    this->mSnakes[slot]->getSnake() = body;
+    this->mSnakes[slot]->setDirection(direction);
+    for (int i = 0; i < body.size(); i ++)
+    {
+        this->mGrid[this->cellIndex(body[i].getX(), body[i].getY())] = slot + 1;
+    }
+    this->mPoints[slot] = points;
+    this->mNumSnakes ++;
+}
+
+void Arena::clearSlot(int slot)
+{
+    this->ensureSlot(slot);
+    this->clearSnake(slot);
+}
+
+// Move a mirrored snake to its new head and trim it to the given length
+void Arena::advanceSnake(int slot, SnakeBody head, int length, int points)
+{
+    Snake& snake = *this->mSnakes[slot];
+    SnakeBodies& body = snake.getSnake();
+    int index = this->cellIndex(head.getX(), head.getY());
+    if (head.getX() != body[0].getX())
+    {
+        snake.setDirection(head.getX() < body[0].getX() ? Direction::Left : Direction::Right);
+    }
+    else
+    {
+        snake.setDirection(head.getY() < body[0].getY() ? Direction::Up : Direction::Down);
+    }
+    if (this->mGrid[index] == -1)
+    {
+        this->eatFood(index);
+    }
+    body.insert(body.begin(), head);
+    while (body.size() > length)
+    {
+        this->mGrid[this->cellIndex(body.back().getX(), body.back().getY())] = 0;
+        body.pop_back();
+    }
+    this->mGrid[index] = slot + 1;
+    this->mPoints[slot] = points;
+}
+
+void Arena::addFood(SnakeBody food)
+{
+    this->mFoods.push_back(food);
+    this->mGrid[this->cellIndex(food.getX(), food.getY())] = -1;
+}
+
+int Arena::getCell(int x, int y) const
+{
+    return this->mGrid[this->cellIndex(x, y)];
+}
+
+bool Arena::isBlocked(int x, int y) const
+{
+    return this->isWall(x, y) || this->getCell(x, y) > 0;
+}
+
+void Arena::setTick(uint32_t tick)
+{
+    this->mTick = tick;
+}
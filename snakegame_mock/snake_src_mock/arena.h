@@ -0,0 +1,95 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <cstdint>
+
+#include "snake.h"
+
+// Most cells an arena holds, its two grids take 8 bytes a cell
+const int MaxArenaCells = 1 << 24;
+
+// A board size the arena can be played with, the server's and the one a
+// client is told in the welcome: every cell has to fit in a SnakeBody and
+// the grids in MaxArenaCells
+bool isArenaSize(int width, int height);
+
+// Shared board for the multiplayer mode.
+// Every connected player owns one slot holding a Snake; food is shared.
+// The server runs the authoritative copy, clients keep a mirror that is
+// updated from the frames the server broadcasts.
+class Arena
+{
+public:
+    Arena(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength, unsigned int seed);
+
+    // Slot management, returns the new slot. Its snake enters the board on
+    // the first step that finds room for it
+    int addSnake();
+    void removeSnake(int slot);
+    void setInput(int slot, Direction direction);
+
+    // Advance the whole board by one tick
+    void step();
+
+    int getWidth() const;
+    int getHeight() const;
+    uint32_t getTick() const;
+    int getNumSlots() const;
+    int getNumSnakes() const;
+    bool isActive(int slot) const;
+    Snake& getSnake(int slot) const;
+    int getPoints(int slot) const;
+    bool isRespawned(int slot) const;
+    bool hasEaten(int slot) const;
+    const SnakeBodies& getFoods() const;
+    const SnakeBodies& getNewFoods() const;
+    // Occupancy: 0 empty, -1 food, otherwise slot + 1
+    int getCell(int x, int y) const;
+    // Wall or any snake
+    bool isBlocked(int x, int y) const;
+
+    // Mirror updates, used by clients decoding the server frames
+    void resetMirror(uint32_t tick, int numSlots);
+    void loadSnake(int slot, const SnakeBodies& body, Direction direction, int points);
+    void clearSlot(int slot);
+    void advanceSnake(int slot, SnakeBody head, int length, int points);
+    void addFood(SnakeBody food);
+    void setTick(uint32_t tick);
+
+private:
+    int cellIndex(int x, int y) const;
+    bool isWall(int x, int y) const;
+    bool spawnSnake(int slot);
+    void clearSnake(int slot);
+    void eatFood(int index);
+    bool createRamdonFood();
+    void ensureSlot(int slot);
+
+    const int mGameBoardWidth;
+    const int mGameBoardHeight;
+    const int mInitialSnakeLength;
+    // Occupancy of every cell: 0 empty, -1 food, otherwise slot + 1
+    std::vector<int> mGrid;
+    // Slot that claimed a cell as its next head during the current step
+    std::vector<int> mHeadClaim;
+    std::vector<std::unique_ptr<Snake>> mSnakes;
+    std::vector<int> mPoints;
+    std::vector<Direction> mInputs;
+    std::vector<char> mHasInput;
+    std::vector<char> mRespawned;
+    std::vector<char> mEaten;
+    std::vector<char> mPending;
+    std::vector<char> mDead;
+    SnakeBodies mNextHeads;
+    std::vector<int> mFreeSlots;
+    SnakeBodies mFoods;
+    SnakeBodies mNewFoods;
+    int mNumSnakes = 0;
+    uint32_t mTick = 0;
+    std::mt19937 mRandom;
+};
+
+#endif
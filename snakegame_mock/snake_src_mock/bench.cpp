@@ -0,0 +1,1692 @@
+// Headless benchmarks for the game core.
+//
+// Usage: snakebench [--repeat n] [--save-baseline file | --baseline file [--threshold percent]] [name ...]
+// Without names every benchmark runs. The throughputs measured, the best of
+// the repeats, can be saved as a baseline or checked against one: the exit
+// status is 1 if one of them is more than threshold percent (10) slower, or
+// if a benchmark's check of its results fails.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <dirent.h>
+
+#include "arena.h"
+#include "protocol.h"
+#include "engine.h"
+#include "bitboard.h"
+#include "tiles.h"
+#include "packedbody.h"
+#include "food.h"
+#include "level.h"
+#include "config.h"
+#include "game.h"
+#include "stats.h"
+#include "trace.h"
+#include "events.h"
+#include "net.h"
+#include "speed.h"
+#include "snapshot.h"
+#include "renderer.h"
+#include "ncrender.h"
+#include "ansi.h"
+#include "fuzz.h"
+
+namespace
+{
+
+// Steps or ticks per second by name, the best of the repeats, for the baseline
+std::vector<std::pair<std::string, double>> gMetrics;
+
+void reportMetric(const std::string& name, double perSecond)
+{
+    for (int i = 0; i < gMetrics.size(); i ++)
+    {
+        if (gMetrics[i].first == name)
+        {
+            gMetrics[i].second = std::max(gMetrics[i].second, perSecond);
+            return;
+        }
+    }
+    gMetrics.push_back(std::make_pair(name, perSecond));
+}
+
+// Set once a benchmark's own check comes out wrong, the exit status is 1 then
+bool gFailed = false;
+
+bool expect(bool passed)
+{
+    gFailed = gFailed || !passed;
+    return passed;
+}
+
+long long nowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<uint32_t> sortedCells(const Arena& arena, const SnakeBodies& cells)
+{
+    std::vector<uint32_t> indexes;
+    for (int i = 0; i < cells.size(); i ++)
+    {
+        indexes.push_back(cells[i].getY() * arena.getWidth() + cells[i].getX());
+    }
+    std::sort(indexes.begin(), indexes.end());
+    return indexes;
+}
+
+// The mirror must hold exactly the same snakes, points and food
+bool sameState(const Arena& expected, const Arena& actual)
+{
+    if (expected.getTick() != actual.getTick() || expected.getNumSlots() != actual.getNumSlots())
+    {
+        return false;
+    }
+    for (int slot = 0; slot < expected.getNumSlots(); slot ++)
+    {
+        if (expected.isActive(slot) != actual.isActive(slot))
+        {
+            return false;
+        }
+        if (!expected.isActive(slot))
+        {
+            continue;
+        }
+        Snake& a = expected.getSnake(slot);
+        Snake& b = actual.getSnake(slot);
+        if (a.getDirection() != b.getDirection() || a.getLength() != b.getLength() || expected.getPoints(slot) != actual.getPoints(slot))
+        {
+            return false;
+        }
+        for (int i = 0; i < a.getLength(); i ++)
+        {
+            if (a.getSnake()[i] != b.getSnake()[i])
+            {
+                return false;
+            }
+        }
+    }
+    return sortedCells(expected, expected.getFoods()) == sortedCells(actual, actual.getFoods());
+}
+
+void steer(Arena& arena, std::mt19937& random)
+{
+    for (int slot = 0; slot < arena.getNumSlots(); slot ++)
+    {
+        if (random() % 8 == 0)
+        {
+            arena.setInput(slot, static_cast<Direction>(random() % 4));
+        }
+    }
+}
+
+// Size the same tick would have had with the fixed width format of the first protocol
+long long fixedWidthBytes(const Arena& arena)
+{
+    long long bytes = 5 + 4 + 4 + 4 + 4 * arena.getNewFoods().size();
+    for (int slot = 0; slot < arena.getNumSlots(); slot ++)
+    {
+        bytes += 1;
+        if (arena.isActive(slot))
+        {
+            bytes += arena.isRespawned(slot) ? 9 + 4 * arena.getSnake(slot).getLength() : 12;
+        }
+    }
+    return bytes;
+}
+
+void benchCodecCase(int numSnakes, int width, int height, int ticks)
+{
+    Arena server(width, height, 2, 1);
+    for (int i = 0; i < numSnakes; i ++)
+    {
+        server.addSnake();
+    }
+    server.step();
+
+    std::vector<unsigned char> frame;
+    encodeKeyframe(frame, server);
+    Arena mirror(width, height, 2, 0);
+    MessageType type;
+    const unsigned char* payload;
+    size_t payloadSize;
+    readFrame(frame.data(), frame.size(), type, payload, payloadSize);
+    bool exact = decodeKeyframe(payload, payloadSize, mirror);
+
+    std::mt19937 random(7);
+    long long tickBytes = 0;
+    long long fixedBytes = 0;
+    long long keyframeBytes = 0;
+    int keyframes = 0;
+    long long encodeTime = 0;
+    long long decodeTime = 0;
+    for (int tick = 0; tick < ticks && exact; tick ++)
+    {
+        steer(server, random);
+        server.step();
+
+        long long start = nowNanoseconds();
+        frame.clear();
+        encodeTick(frame, server);
+        long long encoded = nowNanoseconds();
+        readFrame(frame.data(), frame.size(), type, payload, payloadSize);
+        exact = decodeTick(payload, payloadSize, mirror);
+        long long decoded = nowNanoseconds();
+
+        encodeTime += encoded - start;
+        decodeTime += decoded - encoded;
+        tickBytes += frame.size();
+        fixedBytes += fixedWidthBytes(server);
+        if (tick % 100 == 0)
+        {
+            frame.clear();
+            encodeKeyframe(frame, server);
+            keyframeBytes += frame.size();
+            keyframes ++;
+        }
+    }
+    exact = exact && sameState(server, mirror);
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "codec " << numSnakes << " snakes on " << width << "x" << height
+              << " | " << (double) tickBytes / ticks << " bytes/tick"
+              << " (fixed width " << (double) fixedBytes / ticks << ")"
+              << " | keyframe " << keyframeBytes / std::max(1, keyframes) << " bytes"
+              << " | encode " << (double) encodeTime / ticks << " ns/tick"
+              << " | decode " << (double) decodeTime / ticks << " ns/tick"
+              << " | " << (expect(exact) ? "exact" : "MISMATCH") << std::endl;
+}
+
+void benchCodec()
+{
+    benchCodecCase(1, 80, 24, 20000);
+    benchCodecCase(1000, 1000, 1000, 2000);
+}
+
+// SnakeBody as it was before cells were packed: two ints, compared through the getters
+class WideCell
+{
+public:
+    WideCell(int x, int y): mX(x), mY(y)
+    {
+    }
+    int getX() const
+    {
+        return this->mX;
+    }
+    int getY() const
+    {
+        return this->mY;
+    }
+    bool operator == (const WideCell& cell) const
+    {
+        return this->getX() == cell.getX() && this->getY() == cell.getY();
+    }
+private:
+    int mX;
+    int mY;
+};
+
+// Whole board filled row by row in a zigzag, head at the top left corner
+std::vector<SnakeBody> fillBoard(int width, int height)
+{
+    std::vector<SnakeBody> cells;
+    for (int y = 1; y < height - 1; y ++)
+    {
+        for (int i = 1; i < width - 1; i ++)
+        {
+            cells.push_back(SnakeBody(y % 2 == 1 ? i : width - 1 - i, y));
+        }
+    }
+    return cells;
+}
+
+// A tick at full length: look for the next head in the body, grow a head, drop the tail.
+// The snake heads up off the board so every lookup scans the whole body.
+void benchCellsCase(int width, int height, int ticks)
+{
+    std::vector<SnakeBody> cells = fillBoard(width, height);
+    Snake snake(width, height, 1, 1, 1);
+    snake.getSnake().assign(cells.begin(), cells.end());
+    snake.setDirection(Direction::Up);
+    int hits = 0;
+    long long start = nowNanoseconds();
+    for (int tick = 0; tick < ticks; tick ++)
+    {
+        SnakeBody head = snake.nextHead();
+        hits += snake.isPartOfSnake(head.getX(), head.getY());
+        snake.createNewHead();
+        snake.getSnake().pop_back();
+    }
+    long long packedTime = nowNanoseconds() - start;
+
+    std::vector<WideCell> wide;
+    for (int i = 0; i < cells.size(); i ++)
+    {
+        wide.push_back(WideCell(cells[i].getX(), cells[i].getY()));
+    }
+    start = nowNanoseconds();
+    for (int tick = 0; tick < ticks; tick ++)
+    {
+        WideCell head(wide[0].getX(), wide[0].getY() - 1);
+        for (int i = 0; i < wide.size(); i ++)
+        {
+            if (wide[i] == head)
+            {
+                hits ++;
+                break;
+            }
+        }
+        wide.insert(wide.begin(), head);
+        wide.pop_back();
+    }
+    long long wideTime = nowNanoseconds() - start;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "cells " << width << "x" << height << " at length " << cells.size()
+              << " | packed " << sizeof(SnakeBody) << " B/segment, " << cells.size() * sizeof(SnakeBody) / 1024.0 << " KB, "
+              << ticks * 1e9 / packedTime << " ticks/s"
+              << " | two ints " << sizeof(WideCell) << " B/segment, " << cells.size() * sizeof(WideCell) / 1024.0 << " KB, "
+              << ticks * 1e9 / wideTime << " ticks/s"
+              << (expect(hits == 0) ? "" : " | UNEXPECTED HIT") << std::endl;
+}
+
+void benchCells()
+{
+    benchCellsCase(80, 24, 20000);
+    benchCellsCase(1000, 1000, 20);
+}
+
+SnakeBody cellAfter(SnakeBody cell, Direction direction)
+{
+    switch (direction)
+    {
+        case Direction::Up:
+            return SnakeBody(cell.getX(), cell.getY() - 1);
+        case Direction::Down:
+            return SnakeBody(cell.getX(), cell.getY() + 1);
+        case Direction::Left:
+            return SnakeBody(cell.getX() - 1, cell.getY());
+        case Direction::Right:
+            return SnakeBody(cell.getX() + 1, cell.getY());
+    }
+    return cell;
+}
+
+// Wanders with the odd random turn and swerves from whatever is straight ahead
+template <typename Engine>
+Direction chooseTurn(const Engine& engine, std::mt19937& random)
+{
+    Direction ahead = engine.getDirection();
+    bool vertical = ahead == Direction::Up || ahead == Direction::Down;
+    Direction turns[2] = {vertical ? Direction::Left : Direction::Up, vertical ? Direction::Right : Direction::Down};
+    if (random() % 8 == 0)
+    {
+        return turns[random() % 2];
+    }
+    SnakeBody head = engine.getSegment(0);
+    for (int i = 0; i < 2 && engine.isBlocked(cellAfter(head, ahead)); i ++)
+    {
+        if (!engine.isBlocked(cellAfter(head, turns[i])))
+        {
+            return turns[i];
+        }
+    }
+    return ahead;
+}
+
+struct EngineRun
+{
+    double stepsPerSecond;
+    long long deaths;
+    long long points;
+};
+
+template <typename Engine>
+EngineRun runEngine(Engine& engine, long long steps)
+{
+    std::mt19937 random(11);
+    EngineRun run = {0, 0, 0};
+    long long start = nowNanoseconds();
+    for (long long i = 0; i < steps; i ++)
+    {
+        engine.changeDirection(chooseTurn(engine, random));
+        if (engine.step() == StepResult::Died)
+        {
+            run.deaths ++;
+            run.points += engine.getPoints();
+            engine.reset();
+        }
+    }
+    run.stepsPerSecond = steps * 1e9 / (nowNanoseconds() - start);
+    return run;
+}
+
+// Same seeds on both engines, so the games have to come out the same
+void benchBoardsCase(int width, int height, long long steps)
+{
+    EngineRun specialized;
+    withBoardEngine(width, height, 2, 5, false, [&](auto& engine)
+    {
+        specialized = runEngine(engine, steps);
+    });
+    BoardEngine<> dynamic(width, height, 2, 5);
+    EngineRun general = runEngine(dynamic, steps);
+    bool same = specialized.deaths == general.deaths && specialized.points == general.points;
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "boards " << width << "x" << height
+              << " | specialized " << specialized.stepsPerSecond << " steps/s"
+              << " | dynamic " << general.stepsPerSecond << " steps/s"
+              << std::setprecision(2) << " | x" << specialized.stepsPerSecond / general.stepsPerSecond
+              << " | " << general.deaths << " games"
+              << " | " << (expect(same) ? "same" : "MISMATCH") << std::endl;
+    reportMetric("boards_" + std::to_string(width) + "x" + std::to_string(height), specialized.stepsPerSecond);
+}
+
+void benchBoards()
+{
+    benchBoardsCase(16, 16, 5000000);
+    benchBoardsCase(32, 32, 5000000);
+    benchBoardsCase(80, 24, 5000000);
+    benchBoardsCase(200, 60, 5000000);
+}
+
+template <typename Engine>
+bool sameGame(Engine& engine, Snake& snake, SnakeBody food, bool hasFood, int points)
+{
+    if (engine.getLength() != snake.getLength() || engine.getDirection() != snake.getDirection() || engine.getPoints() != points || engine.hasFood() != hasFood || (hasFood && engine.getFood() != food))
+    {
+        return false;
+    }
+    for (int i = 0; i < snake.getLength(); i ++)
+    {
+        if (engine.getSegment(i) != snake.getSnake()[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Engine, typename Other>
+bool sameEngines(const Engine& engine, const Other& other)
+{
+    if (engine.getLength() != other.getLength() || engine.getPoints() != other.getPoints() || engine.isDead() != other.isDead()
+        || engine.getDirection() != other.getDirection() || engine.hasFood() != other.hasFood() || engine.getFood() != other.getFood())
+    {
+        return false;
+    }
+    for (int i = 0; i < engine.getLength(); i ++)
+    {
+        if (engine.getSegment(i) != other.getSegment(i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Plays random games on the bitboard engine and on BoardEngine, seeded the
+// same, side by side: the food comes from BoardEngine's own draws, so the
+// two have to agree on every step. Returns the steps checked, -1 on a mismatch.
+template <int Width, int Height>
+long long checkBitboard(long long steps)
+{
+    std::mt19937 random(3);
+    BitboardEngine<Width, Height> engine(2, 9);
+    BoardEngine<Width, Height> grid(Width, Height, 2, 9);
+    for (long long i = 0; i < steps; i ++)
+    {
+        if (!sameEngines(engine, grid))
+        {
+            return -1;
+        }
+        Direction turn = chooseTurn(grid, random);
+        if (engine.changeDirection(turn) != grid.changeDirection(turn))
+        {
+            return -1;
+        }
+        StepResult result = engine.step();
+        if (result != grid.step())
+        {
+            return -1;
+        }
+        if (result == StepResult::Died)
+        {
+            engine.reset();
+            grid.reset();
+        }
+    }
+    return steps;
+}
+
+template <int Width, int Height>
+void benchBitboardCase(long long steps)
+{
+    long long checked = checkBitboard<Width, Height>(1000000);
+    BitboardEngine<Width, Height> bitboard(2, 5);
+    EngineRun bits = runEngine(bitboard, steps);
+    BoardEngine<Width, Height> grid(Width, Height, 2, 5);
+    EngineRun bytes = runEngine(grid, steps);
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "bitboard " << Width << "x" << Height
+              << " | " << bits.stepsPerSecond << " steps/s"
+              << " | grid engine " << bytes.stepsPerSecond << " steps/s"
+              << std::setprecision(2) << " | x" << bits.stepsPerSecond / bytes.stepsPerSecond
+              << " | " << (!expect(checked >= 0) ? "MISMATCH with the grid engine" : "matches the grid engine over " + std::to_string(checked) + " steps")
+              << std::endl;
+    reportMetric("bitboard_" + std::to_string(Width) + "x" + std::to_string(Height), bits.stepsPerSecond);
+}
+
+void benchBitboard()
+{
+    benchBitboardCase<8, 8>(5000000);
+    benchBitboardCase<16, 16>(5000000);
+}
+
+// Random games on a wrapping Snake and a wrapping engine side by side, the
+// engine picks the food and Snake is told about it. Returns the steps checked,
+// -1 on a mismatch; seams counts the steps that went over an edge.
+template <int Width, int Height>
+long long checkWrap(int games, long long& seams)
+{
+    std::mt19937 random(3);
+    BoardEngine<Width, Height> engine(Width, Height, 2, 9, true);
+    long long steps = 0;
+    for (int game = 0; game < games; game ++)
+    {
+        if (game > 0)
+        {
+            engine.reset();
+        }
+        Snake snake(Width, Height, 2);
+        snake.setWrap(true);
+        while (true)
+        {
+            snake.senseFood(engine.getFood());
+            if (!sameGame(engine, snake, engine.getFood(), engine.hasFood(), snake.getLength() - 2))
+            {
+                return -1;
+            }
+            Direction turn = chooseTurn(engine, random);
+            if (snake.changeDirection(turn) != engine.changeDirection(turn))
+            {
+                return -1;
+            }
+            SnakeBody head = snake.getSnake()[0];
+            bool dead = snake.checkCollision();
+            StepResult result = engine.step();
+            if (dead != (result == StepResult::Died))
+            {
+                return -1;
+            }
+            if (dead || (!engine.hasFood() && result == StepResult::Ate))
+            {
+                break;
+            }
+            bool ate = snake.touchFood();
+            if (ate != (result == StepResult::Ate))
+            {
+                return -1;
+            }
+            if (!ate)
+            {
+                snake.getSnake().pop_back();
+            }
+            SnakeBody newHead = snake.getSnake()[0];
+            seams += std::abs(newHead.getX() - head.getX()) + std::abs(newHead.getY() - head.getY()) > 1;
+            steps ++;
+        }
+    }
+    return steps;
+}
+
+// Wrapping games have to play out like Snake's, and cost no more than walls
+template <int Width, int Height>
+void benchWrapCase(long long steps)
+{
+    long long seams = 0;
+    long long checked = checkWrap<Width, Height>(2000, seams);
+    BoardEngine<Width, Height> walls(Width, Height, 2, 5);
+    EngineRun bounded = runEngine(walls, steps);
+    BoardEngine<Width, Height> wrapping(Width, Height, 2, 5, true);
+    EngineRun wrapped = runEngine(wrapping, steps);
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "wrap " << Width << "x" << Height
+              << " | walls " << bounded.stepsPerSecond << " steps/s"
+              << " | wrap " << wrapped.stepsPerSecond << " steps/s"
+              << std::setprecision(2) << " | x" << wrapped.stepsPerSecond / bounded.stepsPerSecond
+              << " | " << (!expect(checked >= 0) ? "MISMATCH with Snake" : "matches Snake over " + std::to_string(checked) + " steps, " + std::to_string(seams) + " over the edge")
+              << std::endl;
+    reportMetric("wrap_" + std::to_string(Width) + "x" + std::to_string(Height), wrapped.stepsPerSecond);
+}
+
+void benchWrap()
+{
+    benchWrapCase<16, 16>(5000000);
+    benchWrapCase<80, 24>(5000000);
+}
+
+// Cell i of a zigzag band, 200 cells wide, in the middle of a big world
+SnakeBody bandCell(long long i)
+{
+    int row = i / 200;
+    int column = i % 200;
+    return SnakeBody(16000 + (row % 2 == 0 ? column : 199 - column), 1000 + row);
+}
+
+// Occupancy of a big world: memory has to follow the length, not the area
+void benchTilesCase(int length, int ticks)
+{
+    const long long world = 32767;
+    TileMap tiles;
+    for (int i = 0; i < length; i ++)
+    {
+        SnakeBody cell = bandCell(i);
+        tiles.set(cell.getX(), cell.getY());
+    }
+    size_t numTiles = tiles.getNumTiles();
+    size_t memory = tiles.getMemoryUsage();
+
+    // The snake crawls on along the band: look up the head, set it, clear the tail
+    int hits = 0;
+    long long start = nowNanoseconds();
+    for (int tick = 0; tick < ticks; tick ++)
+    {
+        SnakeBody head = bandCell(length + tick);
+        SnakeBody tail = bandCell(tick);
+        hits += tiles.test(head.getX(), head.getY());
+        tiles.set(head.getX(), head.getY());
+        tiles.clear(tail.getX(), tail.getY());
+    }
+    long long tickTime = nowNanoseconds() - start;
+
+    // An 78x22 view on the head, like the game draws it
+    SnakeBody head = bandCell(length + ticks - 1);
+    int drawn = 0;
+    start = nowNanoseconds();
+    for (int frame = 0; frame < 1000; frame ++)
+    {
+        tiles.forEachIn(head.getX() - 39, head.getY() - 11, head.getX() + 39, head.getY() + 11, [&](int x, int y)
+        {
+            drawn ++;
+        });
+    }
+    long long viewTime = nowNanoseconds() - start;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "tiles length " << length << " in " << world << "x" << world
+              << " | " << numTiles << " tiles, " << memory / 1024.0 << " KB"
+              << " (dense bitmap " << world * world / 8 / 1024 / 1024 << " MB)"
+              << " | " << (double) tickTime / ticks << " ns/tick"
+              << " | view " << (double) viewTime / 1000 << " ns, " << drawn / 1000 << " cells"
+              << (expect(hits == 0) ? "" : " | UNEXPECTED HIT") << std::endl;
+}
+
+void benchTiles()
+{
+    benchTilesCase(100, 100000);
+    benchTilesCase(10000, 100000);
+    benchTilesCase(1000000, 100000);
+}
+
+// A body crawling along the band, once as the Snake keeps it (a vector,
+// head first, the new head inserted in front) and once packed. Each tick
+// moves the head on and the tail after it and asks if the new head is part of
+// the body: a scan of the vector, the occupancy tiles for the packed body.
+void benchBodyCase(int length, int vectorTicks, int packedTicks)
+{
+    std::vector<SnakeBody> vector;
+    for (int i = length - 1; i >= 0; i --)
+    {
+        vector.push_back(bandCell(i));
+    }
+    int hits = 0;
+    long long start = nowNanoseconds();
+    for (int tick = 0; tick < vectorTicks; tick ++)
+    {
+        SnakeBody head = bandCell(length + tick);
+        hits += std::find(vector.begin(), vector.end(), head) != vector.end();
+        vector.insert(vector.begin(), head);
+        vector.pop_back();
+    }
+    long long vectorTime = nowNanoseconds() - start;
+    size_t vectorMemory = vector.capacity() * sizeof(SnakeBody);
+
+    PackedBody body;
+    TileMap tiles;
+    body.reset(bandCell(0));
+    tiles.set(bandCell(0).getX(), bandCell(0).getY());
+    for (int i = 1; i < length; i ++)
+    {
+        body.pushHead(bandCell(i));
+        tiles.set(bandCell(i).getX(), bandCell(i).getY());
+    }
+    start = nowNanoseconds();
+    for (int tick = 0; tick < packedTicks; tick ++)
+    {
+        SnakeBody head = bandCell(length + tick);
+        hits += tiles.test(head.getX(), head.getY());
+        body.pushHead(head);
+        tiles.set(head.getX(), head.getY());
+        SnakeBody tail = body.popTail();
+        tiles.clear(tail.getX(), tail.getY());
+    }
+    long long packedTime = nowNanoseconds() - start;
+    size_t packedMemory = body.getMemoryUsage();
+
+    // Walking the packed body head to tail has to give the cells back
+    bool same = body.getLength() == length && body.getTail() == bandCell(packedTicks);
+    int i = length + packedTicks - 1;
+    start = nowNanoseconds();
+    body.forEach([&](SnakeBody cell)
+    {
+        same = same && cell == bandCell(i);
+        i --;
+    });
+    long long walkTime = nowNanoseconds() - start;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "body length " << length
+              << " | vector " << vectorMemory / 1024.0 << " KB, " << (double) vectorTime / vectorTicks << " ns/tick"
+              << " | packed " << packedMemory / 1024.0 << " KB + tiles " << tiles.getMemoryUsage() / 1024.0 << " KB, "
+              << (double) packedTime / packedTicks << " ns/tick, walk " << walkTime / 1e6 << " ms"
+              << " | " << (expect(same) ? "cells match" : "cells MISMATCH")
+              << (expect(hits == 0) ? "" : " | UNEXPECTED HIT") << std::endl;
+}
+
+void benchBody()
+{
+    benchBodyCase(100, 100000, 100000);
+    benchBodyCase(10000, 10000, 100000);
+    benchBodyCase(1000000, 200, 100000);
+}
+
+// Nearest food the slow way, by steps
+int linearNearest(const std::vector<SnakeBody>& foods, SnakeBody from)
+{
+    int best = -1;
+    for (int i = 0; i < foods.size(); i ++)
+    {
+        int steps = std::abs(foods[i].getX() - from.getX()) + std::abs(foods[i].getY() - from.getY());
+        if (best == -1 || steps < best)
+        {
+            best = steps;
+        }
+    }
+    return best;
+}
+
+// numFoods foods with random values and lifetimes on a size x size world.
+// Every tick the wheel takes off what expired and as much new food is dropped,
+// and the field is asked about random cells: is there food on it, where is
+// the nearest. The nearest food is checked against a scan of all of them.
+void benchFoodCase(int numFoods, int size, int ticks)
+{
+    std::mt19937 random(11);
+    FoodField field;
+    field.reset(size, size);
+    field.reserve(numFoods);
+    uint32_t tick = 0;
+    auto drop = [&]()
+    {
+        while (!field.add(SnakeBody(1 + random() % (size - 2), 1 + random() % (size - 2)), 1 + random() % 9, tick + 1 + random() % 1000))
+        {
+        }
+    };
+    for (int i = 0; i < numFoods; i ++)
+    {
+        drop();
+    }
+
+    long long expired = 0;
+    long long hits = 0;
+    long long expireTime = 0;
+    long long containsTime = 0;
+    long long nearestTime = 0;
+    bool same = true;
+    SnakeBody nearest;
+    for (tick = 1; tick <= ticks; tick ++)
+    {
+        long long start = nowNanoseconds();
+        int gone = field.expire(tick);
+        for (int i = 0; i < gone; i ++)
+        {
+            drop();
+        }
+        expireTime += nowNanoseconds() - start;
+        expired += gone;
+
+        SnakeBody cell(1 + random() % (size - 2), 1 + random() % (size - 2));
+        start = nowNanoseconds();
+        hits += field.contains(cell);
+        containsTime += nowNanoseconds() - start;
+        start = nowNanoseconds();
+        bool found = field.findNearest(cell, nearest);
+        nearestTime += nowNanoseconds() - start;
+        if (tick % 100 == 0)
+        {
+            std::vector<SnakeBody> foods;
+            field.forEach([&foods](const FoodItem& item)
+            {
+                foods.push_back(item.cell);
+            });
+            int steps = std::abs(nearest.getX() - cell.getX()) + std::abs(nearest.getY() - cell.getY());
+            same = same && found && field.size() == numFoods && steps == linearNearest(foods, cell);
+        }
+    }
+
+    std::vector<SnakeBody> foods;
+    field.forEach([&foods](const FoodItem& item)
+    {
+        foods.push_back(item.cell);
+    });
+    long long start = nowNanoseconds();
+    for (int i = 0; i < 100; i ++)
+    {
+        linearNearest(foods, SnakeBody(1 + random() % (size - 2), 1 + random() % (size - 2)));
+    }
+    long long linearTime = nowNanoseconds() - start;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "food " << numFoods << " on " << size << "x" << size << ", " << field.getBucketSize() << " cell buckets"
+              << " | " << field.getMemoryUsage() / 1024.0 << " KB"
+              << " | expire " << (double) expireTime / ticks << " ns/tick, " << (double) expired / ticks << " gone/tick"
+              << " | on food " << (double) containsTime / ticks << " ns"
+              << " | nearest " << (double) nearestTime / ticks << " ns, scan " << linearTime / 100.0 << " ns"
+              << " | " << (expect(same) ? "nearest matches" : "nearest MISMATCH") << std::endl;
+}
+
+void benchFood()
+{
+    benchFoodCase(100, 80, 10000);
+    benchFoodCase(10000, 1000, 10000);
+    benchFoodCase(10000, 30000, 10000);
+}
+
+// A size x size level of random 3x3 pillars and a walled room in the corner
+// nothing can get into, loaded from a file. Every free cell outside the room
+// has to be one step further from the start than one of its neighbours, the
+// room and the pillars can't be reached at all.
+void benchLevelCase(int size, int queries)
+{
+    std::mt19937 random(5);
+    std::string text;
+    std::vector<std::string> rows(size, std::string(size, '.'));
+    for (int i = 0; i < size * size / 60; i ++)
+    {
+        int x = random() % (size - 3);
+        int y = random() % (size - 3);
+        for (int j = 0; j < 9; j ++)
+        {
+            rows[y + j / 3][x + j % 3] = '#';
+        }
+    }
+    for (int i = 0; i < 10; i ++)
+    {
+        rows[0][i] = rows[9][i] = rows[i][0] = rows[i][9] = '#';
+    }
+    rows[size / 2][size / 2] = 'S';
+    rows[size / 2 + 1][size / 2] = '.';
+    for (int i = 0; i < size; i ++)
+    {
+        text += rows[i] + "\n";
+    }
+    char path[] = "/tmp/snakelevelXXXXXX";
+    int fd = mkstemp(path);
+    write(fd, text.data(), text.size());
+    close(fd);
+
+    Level level;
+    long long start = nowNanoseconds();
+    bool loaded = level.load(path);
+    long long loadTime = nowNanoseconds() - start;
+    unlink(path);
+
+    // The room's inside is world (2..9, 2..9)
+    bool same = loaded && level.getWidth() == size + 2 && !level.isReachable(5, 5) && level.isWall(1, 1);
+    int walls = 0;
+    int pockets = 0;
+    for (int y = 1; loaded && y < level.getHeight() - 1; y ++)
+    {
+        for (int x = 1; x < level.getWidth() - 1; x ++)
+        {
+            int distance = level.getDistance(x, y);
+            walls += level.isWall(x, y);
+            pockets += !level.isWall(x, y) && distance < 0;
+            if (distance > 0)
+            {
+                bool closer = false;
+                for (int i = 0; i < 4; i ++)
+                {
+                    SnakeBody neighbour = stepCell(SnakeBody(x, y), static_cast<Direction>(i));
+                    closer = closer || level.getDistance(neighbour.getX(), neighbour.getY()) == distance - 1;
+                }
+                same = same && closer;
+            }
+        }
+    }
+
+    long long reachable = 0;
+    start = nowNanoseconds();
+    for (int i = 0; i < queries; i ++)
+    {
+        int x = random() % (size + 2);
+        int y = random() % (size + 2);
+        reachable += !level.isWall(x, y) && level.isReachable(x, y);
+    }
+    long long queryTime = nowNanoseconds() - start;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "level " << size << "x" << size << " | " << text.size() / 1024.0 << " KB file, " << level.getMemoryUsage() / 1024.0 << " KB loaded"
+              << " | " << walls << " walls, " << pockets << " cells in pockets"
+              << " | load and distances " << loadTime / 1e6 << " ms"
+              << " | wall and reach " << (double) queryTime / queries << " ns"
+              << " | " << (expect(same) ? "distances check out" : "distances WRONG") << std::endl;
+}
+
+void benchLevel()
+{
+    benchLevelCase(60, 1000000);
+    benchLevelCase(2000, 1000000);
+}
+
+// A config with every option, the way the game reads it at startup, which
+// has to stay well under the 5 ms a player would notice
+void benchConfigCase(int loads)
+{
+    char levelPath[] = "/tmp/snakelevelXXXXXX";
+    int fd = mkstemp(levelPath);
+    std::string level = std::string(60, '.') + "\n";
+    for (int i = 0; i < 14; i ++)
+    {
+        level += i == 7 ? std::string(30, '.') + "S" + std::string(29, '.') + "\n" : "..##" + std::string(56, '.') + "\n";
+    }
+    write(fd, level.data(), level.size());
+    close(fd);
+    std::string text = std::string("# Everything there is\n")
+        + "renderer ansi\nboard 60x20\nworld 200x100\nlength 4\nfood 5:3:100  # five at a time\n"
+        + "level " + levelPath + "\nwrap\nleaders 5\nleader-board scores.dat\nsave game.save\n"
+        + "event-log events.txt\nseed 42\nheadless\ngames 10\n";
+    char configPath[] = "/tmp/snakeconfigXXXXXX";
+    fd = mkstemp(configPath);
+    write(fd, text.data(), text.size());
+    close(fd);
+
+    GameConfig config;
+    std::string error;
+    bool loaded = true;
+    long long start = nowNanoseconds();
+    for (int i = 0; i < loads; i ++)
+    {
+        config = GameConfig();
+        loaded = loadConfig(configPath, config, error) && loaded;
+    }
+    long long time = nowNanoseconds() - start;
+    bool same = loaded && config.renderer == "ansi" && config.boardWidth == 60 && config.worldHeight == 100 && config.initialSnakeLength == 4
+        && config.food.count == 5 && config.food.lifetime == 100 && config.level.getWidth() == 62 && config.wrap && config.numLeaders == 5
+        && config.leaderBoardPath == "scores.dat" && config.seed == 42 && config.headless && config.games == 10;
+
+    // Command line options go on top, bad ones are turned down
+    bool overridden = applyOption("seed", "7", config, error) && config.seed == 7 && !applyOption("board", "60", config, error)
+        && !applyOption("food", "0", config, error) && !applyOption("colour", "red", config, error);
+    fd = open(configPath, O_WRONLY | O_APPEND);
+    write(fd, "leaders\n", 8);
+    close(fd);
+    bool rejected = !loadConfig(configPath, config, error);
+    unlink(configPath);
+    unlink(levelPath);
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "config " << std::count(text.begin(), text.end(), '\n') - 1 << " options and a 60x16 level"
+              << " | load " << (double) time / loads / 1000 << " us"
+              << " | " << (expect(same) ? "values check out" : "values WRONG")
+              << " | " << (expect(overridden && rejected) ? "overrides and bad options work" : "overrides or bad options WRONG") << std::endl;
+}
+
+void benchConfig()
+{
+    benchConfigCase(1000);
+}
+
+// What a tick adds to the counters and the clock reads that time it, games on
+// several threads at once while the text is formatted over and over, then a
+// scrape over HTTP. The totals have to come out exact.
+void benchStatsCase(int numThreads, int games, int ticksPerGame)
+{
+    StatsCounters& own = threadStats();
+    long long start = nowNanoseconds();
+    for (int i = 0; i < ticksPerGame; i ++)
+    {
+        own.countTick(i);
+    }
+    long long counterTime = nowNanoseconds() - start;
+    start = nowNanoseconds();
+    for (int i = 0; i < ticksPerGame; i ++)
+    {
+        long long tickStart = nowNanoseconds();
+        own.countTick(nowNanoseconds() - tickStart);
+    }
+    long long clockTime = nowNanoseconds() - start;
+
+    std::atomic<int> running(numThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i ++)
+    {
+        threads.emplace_back([games, ticksPerGame, &running]()
+        {
+            StatsCounters& counters = threadStats();
+            for (int game = 0; game < games; game ++)
+            {
+                counters.startSession(2);
+                for (int tick = 0; tick < ticksPerGame; tick ++)
+                {
+                    counters.countTick(1);
+                    if (tick % 4 == 0)
+                    {
+                        counters.countInput();
+                    }
+                }
+                counters.setPoints(game);
+                counters.endSession();
+            }
+            running --;
+        });
+    }
+    std::vector<char> text(64 * 1024);
+    int scrapes = 0;
+    while (running > 0)
+    {
+        formatStats(text.data(), text.size());
+        scrapes ++;
+    }
+    for (int i = 0; i < threads.size(); i ++)
+    {
+        threads[i].join();
+    }
+    size_t size = formatStats(text.data(), text.size() - 1);
+    text[size] = '\0';
+    long long ticks = (long long) numThreads * games * ticksPerGame + 2 * ticksPerGame;
+    std::string expected = "snake_games_total " + std::to_string(numThreads * games) + "\n"
+        + "snake_ticks_total " + std::to_string(ticks) + "\n";
+    std::string inputs = "snake_inputs_total " + std::to_string((long long) numThreads * games * ((ticksPerGame + 3) / 4)) + "\n";
+    std::string best = "snake_best_points " + std::to_string(games - 1) + "\n";
+    bool exact = std::strstr(text.data(), expected.substr(0, expected.find('\n') + 1).c_str()) && std::strstr(text.data(), expected.substr(expected.find('\n') + 1).c_str())
+        && std::strstr(text.data(), inputs.c_str()) && std::strstr(text.data(), best.c_str());
+
+    // A scrape the way a dashboard does it
+    std::string served = "no server";
+    StatsServer server;
+    if (server.start(19477))
+    {
+        int fd = connectTcp("127.0.0.1", 19477);
+        const char request[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        std::string response;
+        if (fd >= 0 && send(fd, request, sizeof(request) - 1, MSG_NOSIGNAL) == sizeof(request) - 1)
+        {
+            char buffer[4096];
+            pollfd reader = {fd, POLLIN, 0};
+            while (poll(&reader, 1, 1000) > 0)
+            {
+                ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+                if (got <= 0)
+                {
+                    break;
+                }
+                response.append(buffer, got);
+            }
+        }
+        closeSocket(fd);
+        server.stop();
+        bool answered = response.compare(0, 15, "HTTP/1.1 200 OK") == 0 && response.find(std::string(text.data(), size)) != std::string::npos;
+        served = expect(answered) ? "served" : "served WRONG";
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "stats " << numThreads << " threads x " << games << " games x " << ticksPerGame << " ticks"
+              << " | counters " << (double) counterTime / ticksPerGame << " ns/tick"
+              << " | timed " << (double) clockTime / ticksPerGame << " ns/tick"
+              << " | " << scrapes << " scrapes while playing"
+              << " | " << (expect(exact) ? "totals exact" : "totals WRONG")
+              << " | " << served << std::endl;
+}
+
+void benchStats()
+{
+    benchStatsCase(4, 100, 10000);
+}
+
+// Spans and events the way a game records them, a burst at a time with the
+// writer catching up in between, on two threads, then one burst too big for
+// the ring. The JSON has to hold every record or say it was dropped.
+void benchTraceCase(int bursts, int burstSize, int overflow)
+{
+    long long start = nowNanoseconds();
+    for (int i = 0; i < burstSize; i ++)
+    {
+        traceInstant(TraceEvent::GameEvent, i, 0, i, 0, 0);
+    }
+    long long offTime = nowNanoseconds() - start;
+
+    char path[] = "/tmp/snaketraceXXXXXX";
+    close(mkstemp(path));
+    TraceWriter writer;
+    writer.start(path);
+    std::thread other([bursts, burstSize]()
+    {
+        for (int i = 0; i < bursts; i ++)
+        {
+            for (int j = 0; j < burstSize; j ++)
+            {
+                traceInstant(TraceEvent::GameEvent, j, static_cast<int>(GameEventType::FoodEaten), j, 1, 2);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        }
+    });
+    long long recordTime = 0;
+    for (int i = 0; i < bursts; i ++)
+    {
+        start = nowNanoseconds();
+        for (int j = 0; j < burstSize / 2; j ++)
+        {
+            TraceSpan span(TraceEvent::Tick, j);
+        }
+        recordTime += nowNanoseconds() - start;
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    }
+    other.join();
+    for (int i = 0; i < overflow; i ++)
+    {
+        traceInstant(TraceEvent::GameEvent, i, static_cast<int>(GameEventType::ScoreChanged), i, 0, 0);
+    }
+    writer.stop();
+
+    std::ostringstream json;
+    std::string error;
+    bool converted = writeChromeTrace(path, json, error);
+    unlink(path);
+    std::string text = json.str();
+    std::function<long long(const std::string&)> count = [&text](const std::string& needle)
+    {
+        long long found = 0;
+        for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1))
+        {
+            found ++;
+        }
+        return found;
+    };
+    long long dropped = 0;
+    for (size_t at = text.find("\"records\":"); at != std::string::npos; at = text.find("\"records\":", at + 1))
+    {
+        dropped += std::atoll(text.c_str() + at + 10);
+    }
+    bool complete = converted && count("\"name\":\"Tick\",\"ph\":\"B\"") == (long long) bursts * (burstSize / 2)
+        && count("\"name\":\"Tick\",\"ph\":\"E\"") == (long long) bursts * (burstSize / 2)
+        && count("\"name\":\"FoodEaten\"") == (long long) bursts * burstSize
+        && count("\"name\":\"ScoreChanged\"") + dropped == overflow && dropped > 0;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "trace " << bursts << " bursts of " << burstSize << " records on 2 threads"
+              << " | off " << (double) offTime / burstSize << " ns/event"
+              << " | on " << (double) recordTime / (bursts * (burstSize / 2) * 2) << " ns/event"
+              << " | " << text.size() / 1024 << " KB of JSON"
+              << " | " << (expect(complete) ? "every record accounted for" : "records WRONG " + error)
+              << " (" << dropped << " of " << overflow << " dropped when the ring was full)" << std::endl;
+}
+
+void benchTrace()
+{
+    benchTraceCase(10, 2000, 10000);
+}
+
+// The whole game the way --headless plays it, the autopilot on the null
+// renderer, with the ticks counted by the game's own statistics
+void benchHeadlessCase(const std::string& name, GameConfig config, int games)
+{
+    config.seed = 1;
+    Game game(createRenderer("null"), config);
+    StatsCounters& stats = threadStats();
+    long long ticks = stats.get(Stat::Ticks);
+    long long start = nowNanoseconds();
+    std::vector<int> points = game.playHeadless(games);
+    long long time = nowNanoseconds() - start;
+    ticks = stats.get(Stat::Ticks) - ticks;
+    long long total = 0;
+    for (int i = 0; i < points.size(); i ++)
+    {
+        total += points[i];
+    }
+    double ticksPerSecond = ticks * 1e9 / time;
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "headless " << name << " | " << games << " games, " << ticks << " ticks"
+              << " | " << ticksPerSecond << " ticks/s"
+              << std::setprecision(1) << " | " << double(total) / games << " points a game" << std::endl;
+    reportMetric("headless_" + name, ticksPerSecond);
+}
+
+void benchHeadless()
+{
+    GameConfig board;
+    benchHeadlessCase("board", board, 200);
+    GameConfig world;
+    world.worldWidth = 200;
+    world.worldHeight = 100;
+    world.food.count = 50;
+    benchHeadlessCase("world", world, 50);
+    GameConfig wrap;
+    wrap.wrap = true;
+    benchHeadlessCase("wrap", wrap, 200);
+}
+
+// The inputs the fuzzers kept in fuzz/<name>, run through their harnesses: odd
+// boards, files cut short anywhere and games that fill the board, which a
+// change can make slower without the other benchmarks noticing
+void benchFuzzCase(const std::string& name, int (*harness)(const uint8_t*, size_t), int rounds)
+{
+    std::string path = "fuzz/" + name;
+    std::vector<std::string> files;
+    DIR* directory = opendir(path.c_str());
+    while (directory)
+    {
+        dirent* entry = readdir(directory);
+        if (!entry)
+        {
+            closedir(directory);
+            break;
+        }
+        if (entry->d_name[0] != '.')
+        {
+            files.push_back(path + "/" + entry->d_name);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    std::vector<std::vector<uint8_t>> inputs(files.size());
+    size_t bytes = 0;
+    for (int i = 0; i < files.size(); i ++)
+    {
+        std::ifstream file(files[i], std::ios::binary);
+        inputs[i].assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        bytes += inputs[i].size();
+    }
+    if (inputs.empty())
+    {
+        std::cout << "fuzz " << name << " | no inputs in " << path << std::endl;
+        return;
+    }
+
+    long long start = nowNanoseconds();
+    for (int round = 0; round < rounds; round ++)
+    {
+        for (int i = 0; i < inputs.size(); i ++)
+        {
+            harness(inputs[i].data(), inputs[i].size());
+        }
+    }
+    double inputsPerSecond = double(rounds) * inputs.size() * 1e9 / (nowNanoseconds() - start);
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "fuzz " << name << " | " << inputs.size() << " inputs, " << bytes << " bytes"
+              << " | " << inputsPerSecond << " inputs/s" << std::endl;
+    reportMetric("fuzz_" + name, inputsPerSecond);
+}
+
+void benchFuzz()
+{
+    benchFuzzCase("save", fuzzSnapshot, 50);
+    benchFuzzCase("leaders", fuzzLeaderBoard, 1000000);
+    benchFuzzCase("level", fuzzLevel, 3000);
+    benchFuzzCase("engine", fuzzEngine, 1500);
+    benchFuzzCase("game", fuzzGameLoad, 50);
+}
+
+// "name value" lines, # starts a comment
+bool readBaseline(const std::string& path, std::vector<std::pair<std::string, double>>& baseline)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string name;
+        double value;
+        if (words >> name >> value)
+        {
+            baseline.push_back(std::make_pair(name, value));
+        }
+    }
+    return true;
+}
+
+bool writeBaseline(const std::string& path)
+{
+    std::ofstream file(path);
+    file << "# Steps or ticks per second, the best of the repeats, written by snakebench --save-baseline\n";
+    for (int i = 0; i < gMetrics.size(); i ++)
+    {
+        file << gMetrics[i].first << " " << std::fixed << std::setprecision(0) << gMetrics[i].second << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+// Every baseline throughput that was measured again, false if one got slower by more than threshold percent
+bool checkBaseline(const std::vector<std::pair<std::string, double>>& baseline, double threshold)
+{
+    bool passed = true;
+    for (int i = 0; i < baseline.size(); i ++)
+    {
+        int measured = -1;
+        for (int j = 0; j < gMetrics.size(); j ++)
+        {
+            measured = gMetrics[j].first == baseline[i].first ? j : measured;
+        }
+        if (measured < 0)
+        {
+            continue;
+        }
+        double change = (gMetrics[measured].second / baseline[i].second - 1) * 100;
+        bool slower = change < -threshold;
+        passed = passed && !slower;
+        std::cout << std::fixed << std::setprecision(0)
+                  << "perf " << baseline[i].first << " | baseline " << baseline[i].second << " | now " << gMetrics[measured].second
+                  << std::showpos << std::setprecision(1) << " | " << change << "%" << std::noshowpos
+                  << (slower ? " | SLOWER" : "") << std::endl;
+    }
+    return passed;
+}
+
+// The delays the game always had, 100 * 0.75^level cut to whole
+// milliseconds, then the 10 ms floor from level 9 on. Returns the first
+// level where the default schedule differs, -1 if none.
+int checkDefaultSpeed(int levels)
+{
+    static const int Expected[] = {100, 75, 56, 42, 31, 23, 17, 13, 10};
+    const int numExpected = sizeof(Expected) / sizeof(Expected[0]);
+    SpeedSchedule schedule;
+    for (int level = 0; level < levels; level ++)
+    {
+        if (schedule.getDelay(level) != (level < numExpected ? Expected[level] : 10))
+        {
+            return level;
+        }
+    }
+    return -1;
+}
+
+// Past the last level the schedule keeps that level's delay. A line falling
+// 10 ms a level from 1000 is still above its floor there, at 370 ms.
+bool checkSpeedClamp()
+{
+    SpeedCurve curve;
+    curve.shape = "linear";
+    curve.baseDelay = 1000;
+    curve.factor = 10;
+    curve.minDelay = 0;
+    SpeedSchedule schedule(curve);
+    const int last = SpeedSchedule::NumLevels - 1;
+    return schedule.getDelay(last - 1) == 380 && schedule.getDelay(last) == 370
+        && schedule.getDelay(last + 1) == 370 && schedule.getDelay(100) == 370 && schedule.getDelay(100000) == 370;
+}
+
+// Delays at levels 0, 1, 3 and 20 of the curve in text, empty if it doesn't load
+std::vector<int> loadedDelays(const std::string& text)
+{
+    char path[] = "/tmp/snakespeedXXXXXX";
+    int fd = mkstemp(path);
+    write(fd, text.data(), text.size());
+    close(fd);
+    SpeedCurve curve;
+    bool loaded = loadSpeedCurve(path, curve);
+    unlink(path);
+    if (!loaded)
+    {
+        return {};
+    }
+    SpeedSchedule schedule(curve);
+    return {schedule.getDelay(0), schedule.getDelay(1), schedule.getDelay(3), schedule.getDelay(20)};
+}
+
+// The curves a config file can ask for, and files that must not load
+bool checkSpeedFiles()
+{
+    return loadedDelays("curve linear\nbase 100\nfactor 5\nfloor 20\n") == std::vector<int>{100, 95, 85, 20}
+        && loadedDelays("curve stepped  # slower steps\nfactor 0.5\nstep 2\nfloor 1\n") == std::vector<int>{100, 100, 50, 1}
+        && loadedDelays("curve table\ndelays 90 70 60 50\n") == std::vector<int>{90, 70, 50, 50}
+        && loadedDelays("# all defaults\n\n") == std::vector<int>{100, 75, 42, 10}
+        && loadedDelays("curve spiral\n").empty()
+        && loadedDelays("curve table\n").empty()
+        && loadedDelays("base fast\n").empty()
+        && loadedDelays("step 0\n").empty()
+        && loadedDelays("speed 3\n").empty();
+}
+
+void benchSpeed()
+{
+    const int levels = 100;
+    int mismatch = checkDefaultSpeed(levels);
+    bool clamped = checkSpeedClamp();
+    bool files = checkSpeedFiles();
+
+    // What adjustDelay paid before, pow on every call, against a lookup
+    const long long calls = 10000000;
+    SpeedSchedule schedule;
+    volatile int sink = 0;
+    long long start = nowNanoseconds();
+    for (long long i = 0; i < calls; i ++)
+    {
+        sink = 100 * std::pow(0.75, static_cast<int>(i % 40));
+    }
+    long long powTime = nowNanoseconds() - start;
+    start = nowNanoseconds();
+    for (long long i = 0; i < calls; i ++)
+    {
+        sink = schedule.getDelay(i % 40);
+    }
+    long long tableTime = nowNanoseconds() - start;
+    // Only there so the loops can't be left out
+    (void) sink;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "speed | " << (expect(mismatch < 0) ? "default delays as expected at levels 0 to " + std::to_string(levels - 1) : "MISMATCH at level " + std::to_string(mismatch))
+              << " | " << (expect(clamped) ? "levels past " + std::to_string(SpeedSchedule::NumLevels) + " keep the last delay" : "clamp WRONG")
+              << " | " << (expect(files) ? "curve files load" : "curve files FAILED")
+              << " | pow " << double(powTime) / calls << " ns, table " << double(tableTime) / calls << " ns"
+              << std::endl;
+}
+
+// A snake filling the whole inside of a width x height world, row by row
+// back and forth, saved and loaded again
+void benchSnapshotCase(int width, int height)
+{
+    GameSnapshot snapshot;
+    snapshot.worldWidth = width;
+    snapshot.worldHeight = height;
+    snapshot.largeWorld = true;
+    snapshot.points = 12345;
+    snapshot.difficulty = 2469;
+    snapshot.direction = Direction::Left;
+    for (int i = 0; i < 3; i ++)
+    {
+        SavedFood food;
+        food.cell = SnakeBody(1 + i, 1);
+        food.value = 1 + 4 * i;
+        food.ticksLeft = i * 500;
+        snapshot.foods.push_back(food);
+    }
+    for (int y = height - 2; y >= 1; y --)
+    {
+        for (int i = 0; i < width - 2; i ++)
+        {
+            snapshot.body.push_back(SnakeBody(y % 2 == 0 ? 1 + i : width - 2 - i, y));
+        }
+    }
+    snapshot.random.seed(7);
+    snapshot.random.discard(1000);
+
+    std::vector<unsigned char> data;
+    long long start = nowNanoseconds();
+    encodeSnapshot(data, snapshot);
+    long long encodeTime = nowNanoseconds() - start;
+    GameSnapshot loaded;
+    start = nowNanoseconds();
+    bool decoded = decodeSnapshot(data.data(), data.size(), loaded);
+    long long decodeTime = nowNanoseconds() - start;
+    bool same = decoded && loaded.worldWidth == width && loaded.worldHeight == height && loaded.largeWorld
+        && loaded.points == snapshot.points && loaded.difficulty == snapshot.difficulty && loaded.direction == snapshot.direction
+        && loaded.foods.size() == snapshot.foods.size() && loaded.body == snapshot.body && loaded.random == snapshot.random;
+    for (int i = 0; same && i < snapshot.foods.size(); i ++)
+    {
+        same = loaded.foods[i].cell == snapshot.foods[i].cell && loaded.foods[i].value == snapshot.foods[i].value
+            && loaded.foods[i].ticksLeft == snapshot.foods[i].ticksLeft;
+    }
+    // Cut short or with a wrong step, it must not load
+    bool rejects = !decodeSnapshot(data.data(), data.size() - 1, loaded) && !decodeSnapshot(data.data(), 12, loaded);
+    std::vector<unsigned char> broken = data;
+    broken[broken.size() / 2] ^= 0x55;
+    rejects = rejects && !decodeSnapshot(broken.data(), broken.size(), loaded);
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "snapshot " << width << "x" << height << " " << snapshot.body.size() << " segments"
+              << " | " << data.size() / 1024.0 << " KB, " << snapshot.body.size() * sizeof(SnakeBody) / 1024.0 << " KB in memory"
+              << " | save " << encodeTime / 1e6 << " ms, load " << decodeTime / 1e6 << " ms"
+              << " | " << (expect(same) ? "round trip matches" : "round trip MISMATCH") << ", " << (expect(rejects) ? "bad data rejected" : "bad data ACCEPTED")
+              << std::endl;
+}
+
+void benchSnapshot()
+{
+    benchSnapshotCase(80, 24);
+    benchSnapshotCase(1002, 1002);
+}
+
+// Cell i of the ring just inside the box of a board
+void ringCell(int width, int height, int i, int& x, int& y)
+{
+    int across = width - 3;
+    int down = height - 3;
+    i %= 2 * (across + down);
+    if (i < across)
+    {
+        x = 1 + i;
+        y = 1;
+    }
+    else if (i < across + down)
+    {
+        x = width - 2;
+        y = 1 + i - across;
+    }
+    else if (i < 2 * across + down)
+    {
+        x = width - 2 - (i - across - down);
+        y = height - 2;
+    }
+    else
+    {
+        x = 1;
+        y = height - 2 - (i - 2 * across - down);
+    }
+}
+
+// One tick of the single player game as runGame draws it: all boards
+// erased and drawn again, a snake a quarter of the ring long one step further
+void drawGameFrame(Renderer& renderer, const int windows[], int boardWidth, int boardHeight, int frame)
+{
+    for (int i = 0; i < 3; i ++)
+    {
+        renderer.eraseWindow(windows[i]);
+        renderer.drawBox(windows[i]);
+    }
+    renderer.drawText(windows[0], 1, 1, "Welcome to The Snake Game!");
+    renderer.drawText(windows[2], 1, 1, "Manual");
+    renderer.drawText(windows[2], 1, 11, "Points");
+    char points[12];
+    std::snprintf(points, sizeof(points), "%d", frame / 10);
+    renderer.drawText(windows[2], 1, 12, points);
+    int length = (boardWidth + boardHeight) / 2;
+    for (int i = 0; i < length; i ++)
+    {
+        int x, y;
+        ringCell(boardWidth, boardHeight, frame + length - i, x, y);
+        renderer.drawChar(windows[1], x, y, '@');
+    }
+    renderer.drawChar(windows[1], boardWidth / 2, boardHeight / 2, '#');
+    for (int i = 0; i < 3; i ++)
+    {
+        renderer.stageWindow(windows[i]);
+    }
+    renderer.present();
+}
+
+// Frame cost of a backend drawing into a file as if it were the terminal
+void benchRenderCase(const std::string& name, int width, int height, int frames)
+{
+    FILE* output = std::tmpfile();
+    int fd = fileno(output);
+    std::unique_ptr<Renderer> renderer;
+    if (name == "ncurses")
+    {
+        renderer.reset(new NcursesRenderer(fd, width, height));
+    }
+    else if (name == "ansi")
+    {
+        renderer.reset(new AnsiRenderer(fd, width, height));
+    }
+    else
+    {
+        renderer.reset(new NullRenderer(width, height));
+    }
+    // The boards of Game
+    int boardWidth = width - 18;
+    int boardHeight = height - 6;
+    int windows[3];
+    windows[0] = renderer->createWindow(0, 0, width, 6);
+    windows[1] = renderer->createWindow(0, 6, boardWidth, boardHeight);
+    windows[2] = renderer->createWindow(boardWidth, 6, 18, boardHeight);
+
+    // The first frame draws everything, after that only the changes go out
+    drawGameFrame(*renderer, windows, boardWidth, boardHeight, 0);
+    off_t startBytes = lseek(fd, 0, SEEK_END);
+    long long start = nowNanoseconds();
+    for (int frame = 1; frame <= frames; frame ++)
+    {
+        drawGameFrame(*renderer, windows, boardWidth, boardHeight, frame);
+    }
+    long long time = nowNanoseconds() - start;
+    renderer.reset();
+    off_t bytes = lseek(fd, 0, SEEK_END) - startBytes;
+    std::fclose(output);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "render " << std::setw(7) << std::left << name << std::right << " " << width << "x" << height
+              << " | " << (double) time / frames / 1000 << " us/frame"
+              << " | " << (double) bytes / frames << " bytes/frame" << std::endl;
+}
+
+void benchRender()
+{
+    const char* const names[] = {"null", "ansi", "ncurses"};
+    for (int i = 0; i < 3; i ++)
+    {
+        benchRenderCase(names[i], 80, 24, 5000);
+        benchRenderCase(names[i], 300, 100, 1000);
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::pair<std::string, std::function<void()>>> benchmarks = {
+        {"codec", benchCodec},
+        {"cells", benchCells},
+        {"boards", benchBoards},
+        {"bitboard", benchBitboard},
+        {"wrap", benchWrap},
+        {"tiles", benchTiles},
+        {"body", benchBody},
+        {"food", benchFood},
+        {"level", benchLevel},
+        {"config", benchConfig},
+        {"stats", benchStats},
+        {"trace", benchTrace},
+        {"headless", benchHeadless},
+        {"fuzz", benchFuzz},
+        {"render", benchRender},
+        {"speed", benchSpeed},
+        {"snapshot", benchSnapshot},
+    };
+    int repeats = 1;
+    std::string savePath;
+    std::string baselinePath;
+    double threshold = 10;
+    int first = 1;
+    while (first + 1 < argc && std::string(argv[first]).compare(0, 2, "--") == 0)
+    {
+        std::string option = argv[first];
+        if (option == "--repeat")
+        {
+            repeats = std::max(std::atoi(argv[first + 1]), 1);
+        }
+        else if (option == "--save-baseline")
+        {
+            savePath = argv[first + 1];
+        }
+        else if (option == "--baseline")
+        {
+            baselinePath = argv[first + 1];
+        }
+        else if (option == "--threshold")
+        {
+            threshold = std::atof(argv[first + 1]);
+        }
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 2;
+        }
+        first += 2;
+    }
+    std::vector<std::pair<std::string, double>> baseline;
+    if (!baselinePath.empty() && !readBaseline(baselinePath, baseline))
+    {
+        std::cerr << "Cannot read " << baselinePath << std::endl;
+        return 2;
+    }
+
+    for (int repeat = 0; repeat < repeats; repeat ++)
+    {
+        for (int i = 0; i < benchmarks.size(); i ++)
+        {
+            bool selected = argc == first;
+            for (int j = first; j < argc; j ++)
+            {
+                selected = selected || benchmarks[i].first == argv[j];
+            }
+            if (selected)
+            {
+                benchmarks[i].second();
+            }
+        }
+    }
+    if (!savePath.empty() && !writeBaseline(savePath))
+    {
+        std::cerr << "Cannot write " << savePath << std::endl;
+        return 2;
+    }
+    if (!baselinePath.empty() && !checkBaseline(baseline, threshold))
+    {
+        std::cerr << "Slower than " << baselinePath << " by more than " << threshold << "%" << std::endl;
+        return 1;
+    }
+    if (gFailed)
+    {
+        std::cerr << "A benchmark's check failed, see MISMATCH or WRONG above" << std::endl;
+        return 1;
+    }
+    return 0;
+}
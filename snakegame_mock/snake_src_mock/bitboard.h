@@ -0,0 +1,284 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <array>
+#include <random>
+#include <cstdint>
+
+#include "snake.h"
+#include "engine.h"
+
+// BoardEngine for training boards of up to 256 cells (8x8, 16x16).
+// Walls and body are one bitboard of one to four words, so a collision is
+// one bit test on the word holding the next head, and the cell ahead is the
+// head's index plus a constant for the direction: the wall ring keeps it on
+// the board. Food is drawn the way BoardEngine and Game::createRamdonFood
+// draw it, random cells until one misses the snake, so with the same seed
+// the games come out the same; snakebench bitboard plays both side by side.
+template <int Width, int Height>
+class BitboardEngine
+{
+public:
+    BitboardEngine(int initialSnakeLength, unsigned seed);
+
+    void reset();
+    bool changeDirection(Direction newDirection);
+    void setDirection(Direction direction);
+    StepResult step();
+
+    int getWidth() const;
+    int getHeight() const;
+    int getLength() const;
+    int getPoints() const;
+    bool isDead() const;
+    Direction getDirection() const;
+    SnakeBody getSegment(int i) const;
+    SnakeBody nextHead() const;
+    SnakeBody getFood() const;
+    bool hasFood() const;
+    bool isBlocked(SnakeBody cell) const;
+
+private:
+    static const int Cells = Width * Height;
+    static const int Words = (Cells + 63) / 64;
+    static_assert(Words <= 4, "bitboards are meant for boards of up to 256 cells");
+    // The body ring wraps with a mask
+    static_assert((Cells & (Cells - 1)) == 0, "the board has to be a power of two cells");
+
+    typedef std::array<uint64_t, Words> Bitboard;
+
+    static bool testBit(const Bitboard& board, int index);
+    static void setBit(Bitboard& board, int index);
+    static void clearBit(Bitboard& board, int index);
+    static int stepIndex(int index, Direction direction);
+
+    void pushHead(int index);
+    void popTail();
+    void createRamdonFood();
+
+    const int mInitialSnakeLength;
+    std::mt19937 mRandom;
+    // The outer ring, and that plus the snake's cells: what the head can't go into
+    Bitboard mWalls;
+    Bitboard mBlocked;
+    // Ring of cell indexes, mRing[mHead] is the head
+    std::array<uint16_t, Cells> mRing;
+    unsigned mHead;
+    int mLength;
+    int mFood;
+    int mPoints;
+    bool mDead;
+    Direction mDirection;
+};
+
+template <int Width, int Height>
+BitboardEngine<Width, Height>::BitboardEngine(int initialSnakeLength, unsigned seed): mInitialSnakeLength(initialSnakeLength), mRandom(seed)
+{
+    this->mWalls.fill(0);
+    for (int index = 0; index < Cells; index ++)
+    {
+        int x = index % Width;
+        int y = index / Width;
+        if (x == 0 || y == 0 || x == Width - 1 || y == Height - 1)
+        {
+            setBit(this->mWalls, index);
+        }
+    }
+    this->reset();
+}
+
+template <int Width, int Height>
+void BitboardEngine<Width, Height>::reset()
+{
+    this->mBlocked = this->mWalls;
+    this->mHead = Cells - 1;
+    this->mLength = 0;
+    this->mPoints = 0;
+    this->mDead = false;
+    this->mDirection = Direction::Up;
+    for (int i = this->mInitialSnakeLength - 1; i >= 0; i --)
+    {
+        this->pushHead((Height / 2 + i) * Width + Width / 2);
+    }
+    this->createRamdonFood();
+}
+
+template <int Width, int Height>
+bool BitboardEngine<Width, Height>::changeDirection(Direction newDirection)
+{
+    bool vertical = this->mDirection == Direction::Up || this->mDirection == Direction::Down;
+    bool turnsVertical = newDirection == Direction::Up || newDirection == Direction::Down;
+    if (vertical == turnsVertical)
+    {
+        return false;
+    }
+    this->mDirection = newDirection;
+    return true;
+}
+
+template <int Width, int Height>
+void BitboardEngine<Width, Height>::setDirection(Direction direction)
+{
+    this->mDirection = direction;
+}
+
+template <int Width, int Height>
+StepResult BitboardEngine<Width, Height>::step()
+{
+    if (this->mDead)
+    {
+        return StepResult::Died;
+    }
+    int index = stepIndex(this->mRing[this->mHead], this->mDirection);
+    if (testBit(this->mBlocked, index))
+    {
+        this->mDead = true;
+        return StepResult::Died;
+    }
+    if (index == this->mFood)
+    {
+        this->pushHead(index);
+        this->mPoints ++;
+        this->createRamdonFood();
+        return StepResult::Ate;
+    }
+    this->popTail();
+    this->pushHead(index);
+    return StepResult::Moved;
+}
+
+template <int Width, int Height>
+int BitboardEngine<Width, Height>::getWidth() const
+{
+    return Width;
+}
+
+template <int Width, int Height>
+int BitboardEngine<Width, Height>::getHeight() const
+{
+    return Height;
+}
+
+template <int Width, int Height>
+int BitboardEngine<Width, Height>::getLength() const
+{
+    return this->mLength;
+}
+
+template <int Width, int Height>
+int BitboardEngine<Width, Height>::getPoints() const
+{
+    return this->mPoints;
+}
+
+template <int Width, int Height>
+bool BitboardEngine<Width, Height>::isDead() const
+{
+    return this->mDead;
+}
+
+template <int Width, int Height>
+Direction BitboardEngine<Width, Height>::getDirection() const
+{
+    return this->mDirection;
+}
+
+template <int Width, int Height>
+SnakeBody BitboardEngine<Width, Height>::getSegment(int i) const
+{
+    int index = this->mRing[(this->mHead - i) & (Cells - 1)];
+    return SnakeBody(index % Width, index / Width);
+}
+
+template <int Width, int Height>
+SnakeBody BitboardEngine<Width, Height>::nextHead() const
+{
+    int index = stepIndex(this->mRing[this->mHead], this->mDirection);
+    return SnakeBody(index % Width, index / Width);
+}
+
+template <int Width, int Height>
+SnakeBody BitboardEngine<Width, Height>::getFood() const
+{
+    return this->mFood < 0 ? SnakeBody(0, 0) : SnakeBody(this->mFood % Width, this->mFood / Width);
+}
+
+template <int Width, int Height>
+bool BitboardEngine<Width, Height>::hasFood() const
+{
+    return this->mFood >= 0;
+}
+
+template <int Width, int Height>
+bool BitboardEngine<Width, Height>::isBlocked(SnakeBody cell) const
+{
+    if (cell.getX() < 0 || cell.getY() < 0 || cell.getX() >= Width || cell.getY() >= Height)
+    {
+        return true;
+    }
+    return testBit(this->mBlocked, cell.getY() * Width + cell.getX());
+}
+
+template <int Width, int Height>
+bool BitboardEngine<Width, Height>::testBit(const Bitboard& board, int index)
+{
+    return (board[index / 64] >> (index % 64)) & 1;
+}
+
+template <int Width, int Height>
+void BitboardEngine<Width, Height>::setBit(Bitboard& board, int index)
+{
+    board[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+template <int Width, int Height>
+void BitboardEngine<Width, Height>::clearBit(Bitboard& board, int index)
+{
+    board[index / 64] &= ~(uint64_t(1) << (index % 64));
+}
+
+// The head is never on the wall ring, so the cell next to it is always on the board
+template <int Width, int Height>
+int BitboardEngine<Width, Height>::stepIndex(int index, Direction direction)
+{
+    static const int Offsets[4] = {-Width, Width, -1, 1};
+    return index + Offsets[static_cast<int>(direction)];
+}
+
+template <int Width, int Height>
+void BitboardEngine<Width, Height>::pushHead(int index)
+{
+    this->mHead = (this->mHead + 1) & (Cells - 1);
+    this->mRing[this->mHead] = index;
+    setBit(this->mBlocked, index);
+    this->mLength ++;
+}
+
+template <int Width, int Height>
+void BitboardEngine<Width, Height>::popTail()
+{
+    clearBit(this->mBlocked, this->mRing[(this->mHead - this->mLength + 1) & (Cells - 1)]);
+    this->mLength --;
+}
+
+// Like BoardEngine::createRamdonFood, the same draws from the same generator
+template <int Width, int Height>
+void BitboardEngine<Width, Height>::createRamdonFood()
+{
+    if (this->mLength >= (Width - 2) * (Height - 2))
+    {
+        this->mFood = -1;
+        return;
+    }
+    int index;
+    do
+    {
+        int foodX = this->mRandom() % (Width - 2) + 1;
+        int foodY = this->mRandom() % (Height - 2) + 1;
+        index = foodY * Width + foodX;
+    }
+    while (testBit(this->mBlocked, index));
+    this->mFood = index;
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Bit packed output, least significant bit first.
+// Varints are 7 bit groups with a continuation bit, so small numbers
+// such as deltas and counts take a single byte.
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<unsigned char>& out): mOut(out)
+    {
+    }
+
+    // Up to 32 bits at a time
+    void writeBits(uint32_t value, int count)
+    {
+        this->mAccumulator |= (value & ((1ull << count) - 1)) << this->mCount;
+        this->mCount += count;
+        while (this->mCount >= 8)
+        {
+            this->mOut.push_back(this->mAccumulator & 0xff);
+            this->mAccumulator >>= 8;
+            this->mCount -= 8;
+        }
+    }
+
+    void writeVarint(uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            this->writeBits((value & 0x7f) | 0x80, 8);
+            value >>= 7;
+        }
+        this->writeBits(value, 8);
+    }
+
+    // Pad the last byte with zeros, call once when done
+    void flush()
+    {
+        if (this->mCount > 0)
+        {
+            this->mOut.push_back(this->mAccumulator & 0xff);
+        }
+        this->mAccumulator = 0;
+        this->mCount = 0;
+    }
+
+private:
+    std::vector<unsigned char>& mOut;
+    uint64_t mAccumulator = 0;
+    int mCount = 0;
+};
+
+// Reads what BitWriter wrote; running past the end clears ok()
+class BitReader
+{
+public:
+    BitReader(const unsigned char* data, size_t size): mData(data), mSize(size)
+    {
+    }
+
+    uint32_t readBits(int count)
+    {
+        while (this->mCount < count)
+        {
+            if (this->mByte >= this->mSize)
+            {
+                this->mOk = false;
+                return 0;
+            }
+            this->mAccumulator |= static_cast<uint64_t>(this->mData[this->mByte]) << this->mCount;
+            this->mByte ++;
+            this->mCount += 8;
+        }
+        uint32_t value = this->mAccumulator & ((1ull << count) - 1);
+        this->mAccumulator >>= count;
+        this->mCount -= count;
+        return value;
+    }
+
+    uint32_t readVarint()
+    {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            uint32_t group = this->readBits(8);
+            value |= (group & 0x7f) << shift;
+            if (!(group & 0x80))
+            {
+                return value;
+            }
+        }
+        this->mOk = false;
+        return 0;
+    }
+
+    bool ok() const
+    {
+        return this->mOk;
+    }
+
+    // Not read yet, so a count read from the data can be checked against
+    // what is left before anything that big is made
+    size_t bitsLeft() const
+    {
+        return (this->mSize - this->mByte) * 8 + this->mCount;
+    }
+
+    // Everything consumed, up to the padding of the last byte
+    bool done() const
+    {
+        return this->mOk && this->mByte == this->mSize && this->mCount < 8;
+    }
+
+private:
+    const unsigned char* mData;
+    size_t mSize;
+    size_t mByte = 0;
+    uint64_t mAccumulator = 0;
+    int mCount = 0;
+    bool mOk = true;
+};
+
+#endif
@@ -0,0 +1,187 @@
+// Load generator for the arena server.
+// Opens one connection per bot, turns at random and reads every frame
+// like a real client would. The first bot also decodes the frames into
+// a mirror Arena and runs the client side prediction, reporting how long
+// a turn takes to show up with and without it. Put snakeproxy between
+// the bots and the server to add latency.
+//
+// Usage: snakebots [bots] [port] [seconds]
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <cerrno>
+#include <cstdlib>
+
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "net.h"
+#include "protocol.h"
+#include "predict.h"
+
+namespace
+{
+
+struct Bot
+{
+    int fd;
+    std::vector<unsigned char> buffer;
+    long long frames;
+    uint16_t sequence;
+};
+
+long long nowMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    int numBots = argc > 1 ? std::atoi(argv[1]) : 1000;
+    int port = argc > 2 ? std::atoi(argv[2]) : DefaultArenaPort;
+    int seconds = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    raiseFileLimit();
+    std::vector<Bot> bots;
+    for (int i = 0; i < numBots; i ++)
+    {
+        int fd = connectTcp("127.0.0.1", port);
+        if (fd < 0)
+        {
+            std::cerr << "Connection " << i << " failed" << std::endl;
+            break;
+        }
+        bots.push_back(Bot{fd, {}, 0, 1});
+    }
+    std::cout << bots.size() << " bots connected" << std::endl;
+
+    std::mt19937 random(12345);
+    std::unique_ptr<Arena> mirror;
+    std::unique_ptr<Predictor> predictor;
+    int mirrorSlot = -1;
+    bool mirrorOk = true;
+    long long bytes = 0;
+    long long frames = 0;
+    std::vector<pollfd> fds(bots.size());
+    for (int i = 0; i < bots.size(); i ++)
+    {
+        fds[i].fd = bots[i].fd;
+        fds[i].events = POLLIN;
+    }
+    unsigned char chunk[65536];
+    long long start = nowMicroseconds();
+    long long lastReport = start;
+    while (nowMicroseconds() - start < seconds * 1000000LL)
+    {
+        int ready = poll(fds.data(), fds.size(), 5);
+        long long now = nowMicroseconds();
+        if (predictor && mirror)
+        {
+            predictor->predict(*mirror, mirrorSlot, now);
+        }
+        if (ready <= 0)
+        {
+            continue;
+        }
+        for (int i = 0; i < bots.size(); i ++)
+        {
+            if (!fds[i].revents)
+            {
+                continue;
+            }
+            Bot& bot = bots[i];
+            ssize_t received;
+            while ((received = recv(bot.fd, chunk, sizeof(chunk), 0)) > 0)
+            {
+                bytes += received;
+                bot.buffer.insert(bot.buffer.end(), chunk, chunk + received);
+            }
+            size_t offset = 0;
+            while (true)
+            {
+                MessageType type;
+                const unsigned char* payload;
+                size_t payloadSize;
+                int frameSize = readFrame(bot.buffer.data() + offset, bot.buffer.size() - offset, type, payload, payloadSize);
+                if (frameSize <= 0)
+                {
+                    break;
+                }
+                offset += frameSize;
+                if (type != MessageType::Ack)
+                {
+                    bot.frames ++;
+                    frames ++;
+                }
+                if (i == 0)
+                {
+                    int width, height, ticksPerSecond;
+                    uint32_t tick;
+                    uint16_t sequence;
+                    if (type == MessageType::Welcome && decodeWelcome(payload, payloadSize, mirrorSlot, width, height, ticksPerSecond))
+                    {
+                        mirror.reset(new Arena(width, height, 2, 0));
+                        predictor.reset(new Predictor(ticksPerSecond));
+                    }
+                    else if (type == MessageType::Ack && predictor && decodeAck(payload, payloadSize, tick, sequence))
+                    {
+                        predictor->onAck(*mirror, mirrorSlot, tick, sequence, now);
+                    }
+                    else if (type == MessageType::Keyframe && mirror)
+                    {
+                        mirrorOk = decodeKeyframe(payload, payloadSize, *mirror) && mirrorOk;
+                    }
+                    else if (type == MessageType::Tick && mirror)
+                    {
+                        mirrorOk = decodeTick(payload, payloadSize, *mirror) && mirrorOk;
+                    }
+                }
+                // Turn now and then, like a distracted player
+                if (type == MessageType::Tick && random() % 8 == 0)
+                {
+                    Direction turn = static_cast<Direction>(random() % 4);
+                    uint16_t sequence = bot.sequence ++;
+                    if (i == 0 && predictor)
+                    {
+                        sequence = predictor->addTurn(turn, now);
+                    }
+                    unsigned char message[InputMessageSize];
+                    encodeInput(message, turn, sequence);
+                    send(bot.fd, message, sizeof(message), MSG_NOSIGNAL);
+                }
+            }
+            bot.buffer.erase(bot.buffer.begin(), bot.buffer.begin() + offset);
+        }
+
+        if (now - lastReport >= 1000000)
+        {
+            double elapsed = (now - lastReport) / 1e6;
+            std::cout << frames / elapsed / bots.size() << " frames/s per bot | "
+                      << bytes / elapsed / 1e6 << " MB/s | mirror tick "
+                      << (mirror ? mirror->getTick() : 0) << " snakes "
+                      << (mirror ? mirror->getNumSnakes() : 0);
+            if (predictor)
+            {
+                std::cout << " | turn latency predicted " << predictor->getPredictedLatency()
+                          << " ms, server " << predictor->getServerLatency()
+                          << " ms | lead " << predictor->getLeadTicks()
+                          << " ticks | mispredicted " << predictor->getMispredictions();
+            }
+            std::cout << (mirrorOk ? "" : " | DECODE ERROR") << std::endl;
+            frames = 0;
+            bytes = 0;
+            lastReport = now;
+        }
+    }
+    for (int i = 0; i < bots.size(); i ++)
+    {
+        closeSocket(bots[i].fd);
+    }
+    return mirrorOk ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+
+#include "cells.h"
+
+CellRenderer::CellRenderer(int width, int height): mScreen(width * height), mWidth(width), mHeight(height)
+{
+}
+
+int CellRenderer::getWidth() const
+{
+    return this->mWidth;
+}
+
+int CellRenderer::getHeight() const
+{
+    return this->mHeight;
+}
+
+int CellRenderer::createWindow(int x, int y, int width, int height)
+{
+    Window window;
+    window.x = x;
+    window.y = y;
+    window.width = std::max(width, 0);
+    window.height = std::max(height, 0);
+    window.cells.resize(window.width * window.height);
+    this->mWindows.push_back(window);
+    return this->mWindows.size() - 1;
+}
+
+void CellRenderer::placeWindow(int window, int x, int y, int width, int height)
+{
+    Window& target = this->mWindows[window];
+    width = std::max(width, 0);
+    height = std::max(height, 0);
+    if (x == target.x && y == target.y && width == target.width && height == target.height)
+    {
+        return;
+    }
+    target.x = x;
+    target.y = y;
+    target.width = width;
+    target.height = height;
+    target.cells.assign(width * height, Cell());
+}
+
+void CellRenderer::eraseWindow(int window)
+{
+    std::fill(this->mWindows[window].cells.begin(), this->mWindows[window].cells.end(), Cell());
+}
+
+void CellRenderer::drawBox(int window)
+{
+    int right = this->mWindows[window].width - 1;
+    int bottom = this->mWindows[window].height - 1;
+    for (int x = 1; x < right; x ++)
+    {
+        this->putCell(window, x, 0, 'q', LineStyle);
+        this->putCell(window, x, bottom, 'q', LineStyle);
+    }
+    for (int y = 1; y < bottom; y ++)
+    {
+        this->putCell(window, 0, y, 'x', LineStyle);
+        this->putCell(window, right, y, 'x', LineStyle);
+    }
+    this->putCell(window, 0, 0, 'l', LineStyle);
+    this->putCell(window, right, 0, 'k', LineStyle);
+    this->putCell(window, 0, bottom, 'm', LineStyle);
+    this->putCell(window, right, bottom, 'j', LineStyle);
+}
+
+void CellRenderer::drawChar(int window, int x, int y, char symbol)
+{
+    this->putCell(window, x, y, symbol, 0);
+}
+
+void CellRenderer::drawText(int window, int x, int y, const char* text, bool standout)
+{
+    for (int i = 0; text[i] != '\0' && x + i < this->mWindows[window].width; i ++)
+    {
+        this->putCell(window, x + i, y, text[i], standout ? StandoutStyle : 0);
+    }
+}
+
+void CellRenderer::stageWindow(int window)
+{
+    const Window& source = this->mWindows[window];
+    int left = std::max(source.x, 0);
+    int right = std::min(source.x + source.width, this->mWidth);
+    int top = std::max(source.y, 0);
+    int bottom = std::min(source.y + source.height, this->mHeight);
+    if (left >= right)
+    {
+        return;
+    }
+    for (int y = top; y < bottom; y ++)
+    {
+        const Cell* row = &source.cells[(y - source.y) * source.width + left - source.x];
+        std::copy(row, row + right - left, &this->mScreen[y * this->mWidth + left]);
+    }
+}
+
+void CellRenderer::resizeScreen(int width, int height)
+{
+    this->mWidth = width;
+    this->mHeight = height;
+    this->mScreen.assign(width * height, Cell());
+}
+
+const Cell& CellRenderer::getCell(int x, int y) const
+{
+    return this->mScreen[y * this->mWidth + x];
+}
+
+void CellRenderer::putCell(int window, int x, int y, char symbol, unsigned char style)
+{
+    Window& target = this->mWindows[window];
+    if (x < 0 || x >= target.width || y < 0 || y >= target.height)
+    {
+        return;
+    }
+    Cell& cell = target.cells[y * target.width + x];
+    cell.symbol = symbol;
+    cell.style = style;
+}
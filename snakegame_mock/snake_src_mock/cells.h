@@ -0,0 +1,71 @@
+#ifndef CELLS_H
+#define CELLS_H
+
+#include <vector>
+
+#include "renderer.h"
+
+// Style bits of a cell. Lines use the DEC line drawing letters:
+// l k m j for the corners, q across and x down.
+const unsigned char StandoutStyle = 1;
+const unsigned char LineStyle = 2;
+
+struct Cell
+{
+    char symbol = ' ';
+    unsigned char style = 0;
+
+    bool operator == (const Cell& other) const
+    {
+        return this->symbol == other.symbol && this->style == other.style;
+    }
+    bool operator != (const Cell& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Windows and the screen they are staged onto, all kept as cells in memory.
+// A backend on top of this only has to get the screen out in present.
+class CellRenderer : public Renderer
+{
+public:
+    CellRenderer(int width, int height);
+
+    int getWidth() const override;
+    int getHeight() const override;
+    int createWindow(int x, int y, int width, int height) override;
+    void placeWindow(int window, int x, int y, int width, int height) override;
+    void eraseWindow(int window) override;
+    void drawBox(int window) override;
+    void drawChar(int window, int x, int y, char symbol) override;
+    void drawText(int window, int x, int y, const char* text, bool standout) override;
+    void stageWindow(int window) override;
+
+    const Cell& getCell(int x, int y) const;
+
+protected:
+    // The terminal is another size now, the screen starts out empty
+    void resizeScreen(int width, int height);
+
+    // What present has to show, row by row
+    std::vector<Cell> mScreen;
+
+private:
+    struct Window
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+        std::vector<Cell> cells;
+    };
+
+    void putCell(int window, int x, int y, char symbol, unsigned char style);
+
+    int mWidth;
+    int mHeight;
+    std::vector<Window> mWindows;
+};
+
+#endif
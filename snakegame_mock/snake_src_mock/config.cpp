@@ -0,0 +1,244 @@
+#include <fstream>
+#include <sstream>
+
+#include "config.h"
+#include "snake.h"
+
+// The whole of text as one number, nothing before or after it
+static bool parseInteger(const std::string& text, long long& value)
+{
+    std::istringstream words(text);
+    std::string rest;
+    return (words >> value) && !(words >> rest);
+}
+
+bool parseInteger(const std::string& text, int low, int high, int& value)
+{
+    long long parsed;
+    if (!parseInteger(text, parsed) || parsed < low || parsed > high)
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+namespace
+{
+
+struct Option
+{
+    const char* name;
+    bool takesValue;
+};
+
+const Option Options[] = {
+    {"renderer", true},
+    {"board", true},
+    {"world", true},
+    {"length", true},
+    {"speed", true},
+    {"food", true},
+    {"level", true},
+    {"wrap", false},
+    {"leaders", true},
+    {"leader-board", true},
+    {"save", true},
+    {"event-log", true},
+    {"stats-file", true},
+    {"stats-port", true},
+    {"trace", true},
+    {"seed", true},
+    {"headless", false},
+    {"games", true},
+};
+
+// WIDTHxHEIGHT
+bool parseSize(const std::string& text, int low, int& width, int& height)
+{
+    size_t x = text.find('x');
+    int parsedWidth;
+    int parsedHeight;
+    if (x == std::string::npos || !parseInteger(text.substr(0, x), low, MaxBoardSize, parsedWidth) || !parseInteger(text.substr(x + 1), low, MaxBoardSize, parsedHeight))
+    {
+        return false;
+    }
+    width = parsedWidth;
+    height = parsedHeight;
+    return true;
+}
+
+bool parseFoodRules(const std::string& text, FoodRules& rules)
+{
+    FoodRules parsed;
+    int* fields[3] = {&parsed.count, &parsed.maxValue, &parsed.lifetime};
+    std::istringstream words(text);
+    for (int i = 0; i < 3; i ++)
+    {
+        char separator;
+        if (!(words >> *fields[i]))
+        {
+            return false;
+        }
+        if (!(words >> separator))
+        {
+            break;
+        }
+        if (separator != ':' || i == 2)
+        {
+            return false;
+        }
+    }
+    if (parsed.count < 1 || parsed.maxValue < 1 || parsed.maxValue > 9 || parsed.lifetime < 0)
+    {
+        return false;
+    }
+    rules = parsed;
+    return true;
+}
+
+}
+
+bool isOption(const std::string& key, bool& takesValue)
+{
+    for (int i = 0; i < sizeof(Options) / sizeof(Options[0]); i ++)
+    {
+        if (key == Options[i].name)
+        {
+            takesValue = Options[i].takesValue;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool applyOption(const std::string& key, const std::string& value, GameConfig& config, std::string& error)
+{
+    bool ok = true;
+    if (key == "renderer")
+    {
+        ok = value == "ncurses" || value == "ansi" || value == "null";
+        config.renderer = value;
+    }
+    else if (key == "board")
+    {
+        ok = parseSize(value, 8, config.boardWidth, config.boardHeight);
+    }
+    else if (key == "world")
+    {
+        ok = parseSize(value, 8, config.worldWidth, config.worldHeight);
+    }
+    else if (key == "length")
+    {
+        ok = parseInteger(value, 1, 64, config.initialSnakeLength);
+    }
+    else if (key == "speed")
+    {
+        ok = loadSpeedCurve(value, config.speed);
+    }
+    else if (key == "food")
+    {
+        ok = parseFoodRules(value, config.food);
+    }
+    else if (key == "level")
+    {
+        ok = config.level.load(value);
+    }
+    else if (key == "wrap")
+    {
+        config.wrap = true;
+    }
+    else if (key == "leaders")
+    {
+        ok = parseInteger(value, 1, 100, config.numLeaders);
+    }
+    else if (key == "leader-board")
+    {
+        config.leaderBoardPath = value;
+    }
+    else if (key == "save")
+    {
+        config.savePath = value;
+    }
+    else if (key == "event-log")
+    {
+        config.eventLog = value;
+    }
+    else if (key == "stats-file")
+    {
+        config.statsFile = value;
+    }
+    else if (key == "stats-port")
+    {
+        ok = parseInteger(value, 1, 65535, config.statsPort);
+    }
+    else if (key == "trace")
+    {
+        config.trace = value;
+    }
+    else if (key == "seed")
+    {
+        long long seed;
+        ok = parseInteger(value, seed) && seed >= 0 && seed <= 0xffffffffLL;
+        config.seed = ok ? seed : 0;
+    }
+    else if (key == "headless")
+    {
+        config.headless = true;
+    }
+    else if (key == "games")
+    {
+        ok = parseInteger(value, 0, 1000000, config.games);
+    }
+    else
+    {
+        error = "unknown option " + key;
+        return false;
+    }
+    if (!ok)
+    {
+        error = "bad " + key + " " + value;
+    }
+    return ok;
+}
+
+bool loadConfig(const std::string& path, GameConfig& config, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot read " + path;
+        return false;
+    }
+    GameConfig loaded = config;
+    std::string line;
+    for (int number = 1; std::getline(file, line); number ++)
+    {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string key;
+        std::string value;
+        std::string rest;
+        if (!(words >> key))
+        {
+            continue;
+        }
+        bool takesValue;
+        bool valid = isOption(key, takesValue);
+        if (valid && takesValue)
+        {
+            valid = static_cast<bool>(words >> value);
+        }
+        if (!valid || words >> rest)
+        {
+            error = path + ":" + std::to_string(number) + ": bad line " + line;
+            return false;
+        }
+        if (!applyOption(key, value, loaded, error))
+        {
+            error = path + ":" + std::to_string(number) + ": " + error;
+            return false;
+        }
+    }
+    config = loaded;
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+
+#include "speed.h"
+#include "food.h"
+#include "level.h"
+
+// Everything a single player game can be set up with. It is filled once at
+// startup, from a file and then the command line, and the game copies what
+// it needs into members of its own: nothing looks an option up by name later.
+struct GameConfig
+{
+    // ncurses, ansi or null
+    std::string renderer = "ncurses";
+    // The most of the terminal the board takes, 0 for all of it
+    int boardWidth = 0;
+    int boardHeight = 0;
+    // A world bigger than the screen, 0 to play on the board
+    int worldWidth = 0;
+    int worldHeight = 0;
+    int initialSnakeLength = 2;
+    SpeedCurve speed;
+    FoodRules food;
+    // Loaded when the option is read, so a bad file stops the startup
+    Level level;
+    bool wrap = false;
+    int numLeaders = 3;
+    std::string leaderBoardPath = "record.dat";
+    std::string savePath = "snake.save";
+    // Empty for no event log
+    std::string eventLog;
+    // Prometheus text written after every game, empty for none
+    std::string statsFile;
+    // The same served on 127.0.0.1, 0 for no server
+    int statsPort = 0;
+    // Binary trace of ticks, rendering and leader board I/O, empty for none
+    std::string trace;
+    // 0 seeds from the clock
+    unsigned int seed = 0;
+    // No terminal: the autopilot plays games games as fast as it can
+    bool headless = false;
+    int games = 1;
+};
+
+// A config file has a "key value" line per option, # starts a comment. The
+// keys are the command line options without the dashes, see applyOption.
+// false with the reason in error if the file can't be read or is wrong.
+bool loadConfig(const std::string& path, GameConfig& config, std::string& error);
+
+// One option by name: renderer, board WxH, world WxH, length, speed file,
+// food count[:value[:lifetime]], level file, wrap, leaders, leader-board file,
+// save file, event-log file, stats-file file, stats-port port, trace file, seed, headless
+// and games. wrap and headless take no value. false with the reason in error.
+bool applyOption(const std::string& key, const std::string& value, GameConfig& config, std::string& error);
+// If key is an option and whether it is followed by a value
+bool isOption(const std::string& key, bool& takesValue);
+// The whole of text as one number from low to high, for the arguments of the modes
+bool parseInteger(const std::string& text, int low, int high, int& value);
+
+#endif
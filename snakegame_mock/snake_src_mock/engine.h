@@ -0,0 +1,388 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <array>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include "snake.h"
+
+// Template argument for a board whose size is only known at run time
+const int DynamicBoard = 0;
+
+enum class StepResult
+{
+    Moved,
+    Ate,
+    Died,
+};
+
+// Headless single snake game with the rules of Snake and Game: walls on the
+// outer ring, the snake starts in the middle heading up with its body below,
+// one food at a time and the snake dies running into its own tail. A
+// wrapping engine has no walls, the snake goes off one edge of the inside
+// and comes back in at the other.
+// With the board size as template arguments every bounds check and index
+// stride is a constant and the grid lives inside the object;
+// BoardEngine<> takes the size at run time. Cells are looked up in an
+// occupancy grid, so a step costs the same at any length, and the cell
+// ahead comes from a table of every cell's neighbours, so wrapping around
+// costs nothing either.
+template <int Width = DynamicBoard, int Height = DynamicBoard>
+class BoardEngine
+{
+public:
+    BoardEngine(int width, int height, int initialSnakeLength, unsigned seed, bool wrap = false);
+
+    // New snake, no points, fresh food; the random generator carries on
+    void reset();
+    // Same turns Snake::changeDirection accepts
+    bool changeDirection(Direction newDirection);
+    void setDirection(Direction direction);
+    StepResult step();
+
+    int getWidth() const;
+    int getHeight() const;
+    int getLength() const;
+    int getPoints() const;
+    bool isDead() const;
+    Direction getDirection() const;
+    // i-th segment counted from the head
+    SnakeBody getSegment(int i) const;
+    SnakeBody nextHead() const;
+    SnakeBody getFood() const;
+    bool hasFood() const;
+    // Wall or snake, a cell off the edge of a wrapping board is the one it comes back in at
+    bool isBlocked(SnakeBody cell) const;
+
+private:
+    enum Cell : uint8_t
+    {
+        Empty = 0,
+        Body = 1,
+        Food = 2,
+        Wall = 3,
+    };
+
+    static const bool IsStatic = Width != DynamicBoard && Height != DynamicBoard;
+    template <typename T>
+    using Storage = typename std::conditional<IsStatic, std::array<T, IsStatic ? Width * Height : 1>, std::vector<T>>::type;
+    using NeighbourStorage = typename std::conditional<IsStatic, std::array<uint32_t, IsStatic ? Width * Height * 4 : 1>, std::vector<uint32_t>>::type;
+
+    static void resizeStorage(std::vector<uint8_t>& grid, int size, uint8_t value);
+    static void resizeStorage(std::vector<uint32_t>& body, int size, uint32_t value);
+    template <typename T, size_t Size>
+    static void resizeStorage(std::array<T, Size>& storage, int size, T value);
+
+    int cellIndex(SnakeBody cell) const;
+    SnakeBody cellAt(int index) const;
+    bool isWall(int x, int y) const;
+    void createNeighbours();
+    void pushHead(int index);
+    void popTail();
+    void createRamdonFood();
+
+    const int mWidth;
+    const int mHeight;
+    const int mInitialSnakeLength;
+    const bool mWrap;
+    std::mt19937 mRandom;
+    Storage<uint8_t> mGrid;
+    // Cell index of the cell next to cell i in direction d at i * 4 + d
+    NeighbourStorage mNeighbours;
+    // Ring of cell indexes, mHead is the newest
+    Storage<uint32_t> mBody;
+    int mHead;
+    int mLength;
+    int mFood;
+    int mPoints;
+    bool mDead;
+    Direction mDirection;
+};
+
+// Runs function on an engine specialized for the common board sizes,
+// or on BoardEngine<> for any other size
+template <typename Function>
+void withBoardEngine(int width, int height, int initialSnakeLength, unsigned seed, bool wrap, Function function)
+{
+    if (width == 16 && height == 16)
+    {
+        BoardEngine<16, 16> engine(width, height, initialSnakeLength, seed, wrap);
+        function(engine);
+    }
+    else if (width == 32 && height == 32)
+    {
+        BoardEngine<32, 32> engine(width, height, initialSnakeLength, seed, wrap);
+        function(engine);
+    }
+    else if (width == 80 && height == 24)
+    {
+        BoardEngine<80, 24> engine(width, height, initialSnakeLength, seed, wrap);
+        function(engine);
+    }
+    else if (width == 200 && height == 60)
+    {
+        BoardEngine<200, 60> engine(width, height, initialSnakeLength, seed, wrap);
+        function(engine);
+    }
+    else
+    {
+        BoardEngine<> engine(width, height, initialSnakeLength, seed, wrap);
+        function(engine);
+    }
+}
+
+template <int Width, int Height>
+BoardEngine<Width, Height>::BoardEngine(int width, int height, int initialSnakeLength, unsigned seed, bool wrap): mWidth(IsStatic ? Width : width), mHeight(IsStatic ? Height : height), mInitialSnakeLength(initialSnakeLength), mWrap(wrap), mRandom(seed)
+{
+    resizeStorage(this->mBody, this->getWidth() * this->getHeight(), 0u);
+    this->createNeighbours();
+    this->reset();
+}
+
+template <int Width, int Height>
+void BoardEngine<Width, Height>::reset()
+{
+    resizeStorage(this->mGrid, this->getWidth() * this->getHeight(), static_cast<uint8_t>(Empty));
+    // The outer ring is marked so a step only looks at the grid
+    for (int x = 0; x < this->getWidth() && !this->mWrap; x ++)
+    {
+        this->mGrid[this->cellIndex(SnakeBody(x, 0))] = Wall;
+        this->mGrid[this->cellIndex(SnakeBody(x, this->getHeight() - 1))] = Wall;
+    }
+    for (int y = 0; y < this->getHeight() && !this->mWrap; y ++)
+    {
+        this->mGrid[this->cellIndex(SnakeBody(0, y))] = Wall;
+        this->mGrid[this->cellIndex(SnakeBody(this->getWidth() - 1, y))] = Wall;
+    }
+    this->mHead = this->getWidth() * this->getHeight() - 1;
+    this->mLength = 0;
+    this->mPoints = 0;
+    this->mDead = false;
+    this->mDirection = Direction::Up;
+    // Tail first, so the head ends up in the middle
+    for (int i = this->mInitialSnakeLength - 1; i >= 0; i --)
+    {
+        this->pushHead(this->cellIndex(SnakeBody(this->getWidth() / 2, this->getHeight() / 2 + i)));
+    }
+    this->createRamdonFood();
+}
+
+template <int Width, int Height>
+bool BoardEngine<Width, Height>::changeDirection(Direction newDirection)
+{
+    bool vertical = this->mDirection == Direction::Up || this->mDirection == Direction::Down;
+    bool turnsVertical = newDirection == Direction::Up || newDirection == Direction::Down;
+    if (vertical == turnsVertical)
+    {
+        return false;
+    }
+    this->mDirection = newDirection;
+    return true;
+}
+
+template <int Width, int Height>
+void BoardEngine<Width, Height>::setDirection(Direction direction)
+{
+    this->mDirection = direction;
+}
+
+template <int Width, int Height>
+StepResult BoardEngine<Width, Height>::step()
+{
+    if (this->mDead)
+    {
+        return StepResult::Died;
+    }
+    int index = this->mNeighbours[this->mBody[this->mHead] * 4 + static_cast<int>(this->mDirection)];
+    if (this->mGrid[index] == Body || this->mGrid[index] == Wall)
+    {
+        this->mDead = true;
+        return StepResult::Died;
+    }
+    if (this->mGrid[index] == Food)
+    {
+        this->pushHead(index);
+        this->mPoints ++;
+        this->createRamdonFood();
+        return StepResult::Ate;
+    }
+    this->popTail();
+    this->pushHead(index);
+    return StepResult::Moved;
+}
+
+template <int Width, int Height>
+int BoardEngine<Width, Height>::getWidth() const
+{
+    return IsStatic ? Width : this->mWidth;
+}
+
+template <int Width, int Height>
+int BoardEngine<Width, Height>::getHeight() const
+{
+    return IsStatic ? Height : this->mHeight;
+}
+
+template <int Width, int Height>
+int BoardEngine<Width, Height>::getLength() const
+{
+    return this->mLength;
+}
+
+template <int Width, int Height>
+int BoardEngine<Width, Height>::getPoints() const
+{
+    return this->mPoints;
+}
+
+template <int Width, int Height>
+bool BoardEngine<Width, Height>::isDead() const
+{
+    return this->mDead;
+}
+
+template <int Width, int Height>
+Direction BoardEngine<Width, Height>::getDirection() const
+{
+    return this->mDirection;
+}
+
+template <int Width, int Height>
+SnakeBody BoardEngine<Width, Height>::getSegment(int i) const
+{
+    int capacity = this->getWidth() * this->getHeight();
+    return this->cellAt(this->mBody[(this->mHead - i + capacity) % capacity]);
+}
+
+template <int Width, int Height>
+SnakeBody BoardEngine<Width, Height>::nextHead() const
+{
+    return this->cellAt(this->mNeighbours[this->mBody[this->mHead] * 4 + static_cast<int>(this->mDirection)]);
+}
+
+template <int Width, int Height>
+SnakeBody BoardEngine<Width, Height>::getFood() const
+{
+    return this->cellAt(std::max(this->mFood, 0));
+}
+
+template <int Width, int Height>
+bool BoardEngine<Width, Height>::hasFood() const
+{
+    return this->mFood >= 0;
+}
+
+template <int Width, int Height>
+bool BoardEngine<Width, Height>::isBlocked(SnakeBody cell) const
+{
+    if (this->mWrap)
+    {
+        cell = wrapCell(cell, this->getWidth(), this->getHeight());
+    }
+    return this->isWall(cell.getX(), cell.getY()) || this->mGrid[this->cellIndex(cell)] == Body;
+}
+
+template <int Width, int Height>
+void BoardEngine<Width, Height>::resizeStorage(std::vector<uint8_t>& grid, int size, uint8_t value)
+{
+    grid.assign(size, value);
+}
+
+template <int Width, int Height>
+void BoardEngine<Width, Height>::resizeStorage(std::vector<uint32_t>& body, int size, uint32_t value)
+{
+    body.assign(size, value);
+}
+
+template <int Width, int Height>
+template <typename T, size_t Size>
+void BoardEngine<Width, Height>::resizeStorage(std::array<T, Size>& storage, int size, T value)
+{
+    storage.fill(value);
+}
+
+template <int Width, int Height>
+int BoardEngine<Width, Height>::cellIndex(SnakeBody cell) const
+{
+    return cell.getY() * this->getWidth() + cell.getX();
+}
+
+template <int Width, int Height>
+SnakeBody BoardEngine<Width, Height>::cellAt(int index) const
+{
+    return SnakeBody(index % this->getWidth(), index / this->getWidth());
+}
+
+template <int Width, int Height>
+bool BoardEngine<Width, Height>::isWall(int x, int y) const
+{
+    return x <= 0 || y <= 0 || x >= this->getWidth() - 1 || y >= this->getHeight() - 1;
+}
+
+// Worked out once, so a step never has to check an edge. The outer ring's
+// own neighbours are never looked up and point back at themselves.
+template <int Width, int Height>
+void BoardEngine<Width, Height>::createNeighbours()
+{
+    resizeStorage(this->mNeighbours, this->getWidth() * this->getHeight() * 4, 0u);
+    for (int i = 0; i < this->getWidth() * this->getHeight(); i ++)
+    {
+        SnakeBody cell = this->cellAt(i);
+        for (int d = 0; d < 4; d ++)
+        {
+            SnakeBody next = stepCell(cell, static_cast<Direction>(d));
+            if (this->mWrap && !this->isWall(cell.getX(), cell.getY()))
+            {
+                next = wrapCell(next, this->getWidth(), this->getHeight());
+            }
+            bool outside = next.getX() < 0 || next.getY() < 0 || next.getX() >= this->getWidth() || next.getY() >= this->getHeight();
+            this->mNeighbours[i * 4 + d] = outside ? i : this->cellIndex(next);
+        }
+    }
+}
+
+template <int Width, int Height>
+void BoardEngine<Width, Height>::pushHead(int index)
+{
+    int capacity = this->getWidth() * this->getHeight();
+    this->mHead = (this->mHead + 1) % capacity;
+    this->mBody[this->mHead] = index;
+    this->mGrid[index] = Body;
+    this->mLength ++;
+}
+
+template <int Width, int Height>
+void BoardEngine<Width, Height>::popTail()
+{
+    int capacity = this->getWidth() * this->getHeight();
+    int tail = (this->mHead - this->mLength + 1 + capacity) % capacity;
+    this->mGrid[this->mBody[tail]] = Empty;
+    this->mLength --;
+}
+
+// Like Game::createRamdonFood, retried until it misses the snake
+template <int Width, int Height>
+void BoardEngine<Width, Height>::createRamdonFood()
+{
+    if (this->mLength >= (this->getWidth() - 2) * (this->getHeight() - 2))
+    {
+        this->mFood = -1;
+        return;
+    }
+    int index;
+    do
+    {
+        int foodX = this->mRandom() % (this->getWidth() - 2) + 1;
+        int foodY = this->mRandom() % (this->getHeight() - 2) + 1;
+        index = foodY * this->getWidth() + foodX;
+    }
+    while (this->mGrid[index] != Empty);
+    this->mFood = index;
+    this->mGrid[index] = Food;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "events.h"
+
+const char* getEventName(GameEventType type)
+{
+    switch (type)
+    {
+        case GameEventType::FoodEaten:
+            return "FoodEaten";
+        case GameEventType::ScoreChanged:
+            return "ScoreChanged";
+        case GameEventType::DifficultyChanged:
+            return "DifficultyChanged";
+        case GameEventType::SnakeDied:
+            return "SnakeDied";
+        case GameEventType::DirectionChanged:
+            return "DirectionChanged";
+    }
+    return "Unknown";
+}
+
+void EventBus::subscribe(GameEventType type, const Subscriber& subscriber)
+{
+    this->mSubscribers[static_cast<int>(type)].push_back(subscriber);
+}
+
+void EventBus::subscribeAll(const Subscriber& subscriber)
+{
+    for (int i = 0; i < NumGameEventTypes; i ++)
+    {
+        this->mSubscribers[i].push_back(subscriber);
+    }
+}
+
+bool EventBus::emit(GameEventType type, int value, int x, int y)
+{
+    if (this->mCount == QueueSize)
+    {
+        this->mNumDropped ++;
+        return false;
+    }
+    GameEvent& event = this->mQueue[(this->mFirst + this->mCount) % QueueSize];
+    event.type = type;
+    event.value = value;
+    event.x = x;
+    event.y = y;
+    this->mCount ++;
+    return true;
+}
+
+void EventBus::dispatch()
+{
+    while (this->mCount > 0)
+    {
+        // Copied out, a subscriber may emit into the slot
+        GameEvent event = this->mQueue[this->mFirst];
+        this->mFirst = (this->mFirst + 1) % QueueSize;
+        this->mCount --;
+        const std::vector<Subscriber>& subscribers = this->mSubscribers[static_cast<int>(event.type)];
+        for (int i = 0; i < subscribers.size(); i ++)
+        {
+            subscribers[i](event);
+        }
+    }
+}
+
+void EventBus::clear()
+{
+    this->mFirst = 0;
+    this->mCount = 0;
+}
+
+long long EventBus::getNumDropped() const
+{
+    return this->mNumDropped;
+}
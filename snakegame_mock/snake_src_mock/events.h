@@ -0,0 +1,57 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <functional>
+#include <vector>
+
+// What the game core reports, for whoever needs to react to it
+enum class GameEventType
+{
+    FoodEaten,
+    ScoreChanged,
+    DifficultyChanged,
+    SnakeDied,
+    DirectionChanged,
+};
+const int NumGameEventTypes = 5;
+
+const char* getEventName(GameEventType type);
+
+// value is the new points, difficulty or Direction, or the points a dead snake had.
+// x and y are the cell of the food eaten or of the head that died.
+struct GameEvent
+{
+    GameEventType type;
+    int value;
+    int x;
+    int y;
+};
+
+// Events wait in a fixed ring until dispatch hands each of them, in order,
+// to the subscribers of its type. Nothing is allocated after subscribing,
+// so a tick can emit and dispatch as much as it likes.
+class EventBus
+{
+public:
+    typedef std::function<void(const GameEvent&)> Subscriber;
+    static const int QueueSize = 64;
+
+    void subscribe(GameEventType type, const Subscriber& subscriber);
+    void subscribeAll(const Subscriber& subscriber);
+
+    // false if the queue was full and the event is lost
+    bool emit(GameEventType type, int value, int x = 0, int y = 0);
+    // Events the subscribers emit are dispatched too before this returns
+    void dispatch();
+    void clear();
+    long long getNumDropped() const;
+
+private:
+    std::vector<Subscriber> mSubscribers[NumGameEventTypes];
+    GameEvent mQueue[QueueSize];
+    int mFirst = 0;
+    int mCount = 0;
+    long long mNumDropped = 0;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include <cstdlib>
+
+#include "food.h"
+
+namespace
+{
+
+// Buckets are 8 cells a side or more, never more than this many of them
+const int MaxBuckets = 65536;
+
+int distance(SnakeBody a, SnakeBody b)
+{
+    return std::abs(a.getX() - b.getX()) + std::abs(a.getY() - b.getY());
+}
+
+}
+
+void FoodField::reset(int width, int height)
+{
+    this->mBucketShift = 3;
+    while (((width >> this->mBucketShift) + 1) * ((height >> this->mBucketShift) + 1) > MaxBuckets)
+    {
+        this->mBucketShift ++;
+    }
+    this->mBucketsAcross = (width >> this->mBucketShift) + 1;
+    this->mBucketsDown = (height >> this->mBucketShift) + 1;
+    this->mBuckets.assign(this->mBucketsAcross * this->mBucketsDown, -1);
+    std::fill(this->mWheel, this->mWheel + WheelSize, -1);
+    this->mItems.clear();
+    this->mFree = -1;
+    this->mSize = 0;
+}
+
+void FoodField::reserve(size_t count)
+{
+    this->mItems.reserve(count);
+}
+
+bool FoodField::add(SnakeBody cell, int value, uint32_t expires)
+{
+    if (this->contains(cell))
+    {
+        return false;
+    }
+    int index = this->mFree;
+    if (index == -1)
+    {
+        index = this->mItems.size();
+        this->mItems.push_back(FoodItem());
+    }
+    else
+    {
+        this->mFree = this->mItems[index].nextInBucket;
+    }
+    FoodItem& item = this->mItems[index];
+    item.cell = cell;
+    item.value = value;
+    item.expires = expires;
+
+    int& bucket = this->mBuckets[this->bucketOf(cell)];
+    item.previousInBucket = -1;
+    item.nextInBucket = bucket;
+    if (bucket != -1)
+    {
+        this->mItems[bucket].previousInBucket = index;
+    }
+    bucket = index;
+
+    item.previousInWheel = -1;
+    item.nextInWheel = -1;
+    if (expires != 0)
+    {
+        int& slot = this->mWheel[expires % WheelSize];
+        item.nextInWheel = slot;
+        if (slot != -1)
+        {
+            this->mItems[slot].previousInWheel = index;
+        }
+        slot = index;
+    }
+    this->mSize ++;
+    return true;
+}
+
+int FoodField::take(SnakeBody cell)
+{
+    int index = this->findItem(cell);
+    if (index == -1)
+    {
+        return 0;
+    }
+    int value = this->mItems[index].value;
+    this->remove(index);
+    return value;
+}
+
+bool FoodField::contains(SnakeBody cell) const
+{
+    return this->findItem(cell) != -1;
+}
+
+// Rings of buckets around the one of from, until no food further out can be closer
+bool FoodField::findNearest(SnakeBody from, SnakeBody& food) const
+{
+    int bucketSize = this->getBucketSize();
+    int centerX = from.getX() >> this->mBucketShift;
+    int centerY = from.getY() >> this->mBucketShift;
+    int maxRing = std::max(this->mBucketsAcross, this->mBucketsDown);
+    int best = -1;
+    for (int ring = 0; ring <= maxRing && this->mSize > 0; ring ++)
+    {
+        // Food in this ring is at least this far away
+        if (best != -1 && best <= (ring - 1) * bucketSize + 1)
+        {
+            break;
+        }
+        for (int bucketY = centerY - ring; bucketY <= centerY + ring; bucketY ++)
+        {
+            if (bucketY < 0 || bucketY >= this->mBucketsDown)
+            {
+                continue;
+            }
+            bool edge = bucketY == centerY - ring || bucketY == centerY + ring;
+            for (int bucketX = centerX - ring; bucketX <= centerX + ring; bucketX += edge ? 1 : 2 * ring)
+            {
+                if (bucketX >= 0 && bucketX < this->mBucketsAcross)
+                {
+                    for (int i = this->mBuckets[bucketY * this->mBucketsAcross + bucketX]; i != -1; i = this->mItems[i].nextInBucket)
+                    {
+                        int steps = distance(from, this->mItems[i].cell);
+                        if (best == -1 || steps < best)
+                        {
+                            best = steps;
+                            food = this->mItems[i].cell;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return best != -1;
+}
+
+int FoodField::expire(uint32_t tick)
+{
+    int expired = 0;
+    int index = this->mWheel[tick % WheelSize];
+    while (index != -1)
+    {
+        int next = this->mItems[index].nextInWheel;
+        // The rest are a turn of the wheel or more away
+        if (this->mItems[index].expires <= tick)
+        {
+            this->remove(index);
+            expired ++;
+        }
+        index = next;
+    }
+    return expired;
+}
+
+size_t FoodField::size() const
+{
+    return this->mSize;
+}
+
+int FoodField::getBucketSize() const
+{
+    return 1 << this->mBucketShift;
+}
+
+size_t FoodField::getMemoryUsage() const
+{
+    return sizeof(FoodField) + this->mBuckets.capacity() * sizeof(int) + this->mItems.capacity() * sizeof(FoodItem);
+}
+
+int FoodField::bucketOf(SnakeBody cell) const
+{
+    return (cell.getY() >> this->mBucketShift) * this->mBucketsAcross + (cell.getX() >> this->mBucketShift);
+}
+
+int FoodField::findItem(SnakeBody cell) const
+{
+    for (int i = this->mBuckets[this->bucketOf(cell)]; i != -1; i = this->mItems[i].nextInBucket)
+    {
+        if (this->mItems[i].cell == cell)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FoodField::remove(int index)
+{
+    FoodItem& item = this->mItems[index];
+    if (item.previousInBucket != -1)
+    {
+        this->mItems[item.previousInBucket].nextInBucket = item.nextInBucket;
+    }
+    else
+    {
+        this->mBuckets[this->bucketOf(item.cell)] = item.nextInBucket;
+    }
+    if (item.nextInBucket != -1)
+    {
+        this->mItems[item.nextInBucket].previousInBucket = item.previousInBucket;
+    }
+    if (item.expires != 0)
+    {
+        if (item.previousInWheel != -1)
+        {
+            this->mItems[item.previousInWheel].nextInWheel = item.nextInWheel;
+        }
+        else
+        {
+            this->mWheel[item.expires % WheelSize] = item.nextInWheel;
+        }
+        if (item.nextInWheel != -1)
+        {
+            this->mItems[item.nextInWheel].previousInWheel = item.previousInWheel;
+        }
+    }
+    item.value = 0;
+    item.nextInBucket = this->mFree;
+    this->mFree = index;
+    this->mSize --;
+}
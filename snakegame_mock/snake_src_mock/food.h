@@ -0,0 +1,119 @@
+#ifndef FOOD_H
+#define FOOD_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "snake.h"
+
+// How much food a game keeps on the board. Each food is worth 1 to maxValue
+// points and goes away lifetime ticks after it was dropped, 0 is for good.
+struct FoodRules
+{
+    int count = 1;
+    int maxValue = 1;
+    int lifetime = 0;
+};
+
+struct FoodItem
+{
+    SnakeBody cell;
+    // 0 for a free slot
+    int value = 0;
+    // The tick it goes away on, 0 for never
+    uint32_t expires = 0;
+    // Lists of the items in a bucket and in a wheel slot, -1 ends them
+    int nextInBucket = -1;
+    int previousInBucket = -1;
+    int nextInWheel = -1;
+    int previousInWheel = -1;
+};
+
+// Food on a board, any number of it. The board is cut into square buckets
+// that each keep a list of their food, so finding the food on a cell only
+// looks at one bucket and the nearest food is searched a ring of buckets at
+// a time. Food that goes away waits in a timing wheel by the tick it
+// expires on, a tick only looks at the food of its own slot. Nothing is
+// allocated after reset and reserve.
+class FoodField
+{
+public:
+    static const int WheelSize = 256;
+
+    // An empty field for a width x height board
+    void reset(int width, int height);
+    void reserve(size_t count);
+    // false if the cell has food already
+    bool add(SnakeBody cell, int value, uint32_t expires);
+    // Takes the food off the cell and returns its value, 0 if there was none
+    int take(SnakeBody cell);
+    bool contains(SnakeBody cell) const;
+    // The food closest to from, by steps; false if there is none
+    bool findNearest(SnakeBody from, SnakeBody& food) const;
+    // Takes off the food that expires on tick or before it, returns how many
+    int expire(uint32_t tick);
+    size_t size() const;
+    int getBucketSize() const;
+    size_t getMemoryUsage() const;
+
+    // Calls function(item) for every food with x0 <= x < x1 and y0 <= y < y1,
+    // looking only at the buckets in that rectangle
+    template <typename Function>
+    void forEachIn(int x0, int y0, int x1, int y1, Function function) const;
+    template <typename Function>
+    void forEach(Function function) const;
+
+private:
+    int bucketOf(SnakeBody cell) const;
+    int findItem(SnakeBody cell) const;
+    void remove(int index);
+
+    int mBucketShift = 0;
+    int mBucketsAcross = 0;
+    int mBucketsDown = 0;
+    std::vector<int> mBuckets;
+    int mWheel[WheelSize];
+    std::vector<FoodItem> mItems;
+    // Free slots in mItems, linked through nextInBucket
+    int mFree = -1;
+    size_t mSize = 0;
+};
+
+template <typename Function>
+void FoodField::forEachIn(int x0, int y0, int x1, int y1, Function function) const
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    int right = std::min((x1 - 1) >> this->mBucketShift, this->mBucketsAcross - 1);
+    int bottom = std::min((y1 - 1) >> this->mBucketShift, this->mBucketsDown - 1);
+    for (int bucketY = y0 >> this->mBucketShift; bucketY <= bottom; bucketY ++)
+    {
+        for (int bucketX = x0 >> this->mBucketShift; bucketX <= right; bucketX ++)
+        {
+            for (int i = this->mBuckets[bucketY * this->mBucketsAcross + bucketX]; i != -1; i = this->mItems[i].nextInBucket)
+            {
+                const FoodItem& item = this->mItems[i];
+                if (item.cell.getX() >= x0 && item.cell.getX() < x1 && item.cell.getY() >= y0 && item.cell.getY() < y1)
+                {
+                    function(item);
+                }
+            }
+        }
+    }
+}
+
+template <typename Function>
+void FoodField::forEach(Function function) const
+{
+    for (int i = 0; i < this->mItems.size(); i ++)
+    {
+        if (this->mItems[i].value > 0)
+        {
+            function(this->mItems[i]);
+        }
+    }
+}
+
+#endif
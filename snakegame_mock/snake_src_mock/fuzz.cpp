@@ -0,0 +1,261 @@
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+#include "fuzz.h"
+#include "engine.h"
+#include "snapshot.h"
+#include "leaderboard.h"
+#include "level.h"
+
+namespace
+{
+
+const int NumLeaders = 10;
+const unsigned EngineSeed = 5;
+
+// The checksum a save file header carries, see snapshot.cpp
+uint32_t checksum(const unsigned char* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i ++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void checkRoundTrip(const GameSnapshot& snapshot)
+{
+    std::vector<unsigned char> encoded;
+    encodeSnapshot(encoded, snapshot);
+    GameSnapshot decoded;
+    [[maybe_unused]] bool ok = decodeSnapshot(encoded.data(), encoded.size(), decoded);
+    assert(ok && "a snapshot that decoded has to decode again");
+    std::vector<unsigned char> again;
+    encodeSnapshot(again, decoded);
+    assert(again == encoded && "a snapshot has to come out of a round trip the same");
+}
+
+// Cells inside the walls, where the snake and the food have to stay
+[[maybe_unused]] bool isInside(SnakeBody cell, int width, int height)
+{
+    return cell.getX() >= 1 && cell.getY() >= 1 && cell.getX() <= width - 2 && cell.getY() <= height - 2;
+}
+
+// Next to each other, or on both edges of a wrapping board
+[[maybe_unused]] bool isNextTo(SnakeBody from, SnakeBody to, int width, int height, bool wrap)
+{
+    for (int d = 0; d < 4; d ++)
+    {
+        SnakeBody next = stepCell(from, static_cast<Direction>(d));
+        if ((wrap ? wrapCell(next, width, height) : next) == to)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Everything the engine says about the board has to fit together
+void checkBoard(const BoardEngine<>& engine, int initialSnakeLength, bool wrap, std::vector<uint8_t>& seen)
+{
+    int width = engine.getWidth();
+    int height = engine.getHeight();
+    assert(engine.getLength() == initialSnakeLength + engine.getPoints());
+    seen.assign(width * height, 0);
+    for (int i = 0; i < engine.getLength(); i ++)
+    {
+        SnakeBody segment = engine.getSegment(i);
+        assert(isInside(segment, width, height));
+        assert(!seen[segment.getY() * width + segment.getX()] && "the snake runs over itself");
+        assert(engine.isBlocked(segment));
+        assert(i == 0 || isNextTo(engine.getSegment(i - 1), segment, width, height, wrap));
+        seen[segment.getY() * width + segment.getX()] = 1;
+    }
+    [[maybe_unused]] bool full = engine.getLength() == (width - 2) * (height - 2);
+    assert(engine.hasFood() != full);
+    if (engine.hasFood())
+    {
+        [[maybe_unused]] SnakeBody food = engine.getFood();
+        assert(isInside(food, width, height));
+        assert(!seen[food.getY() * width + food.getX()]);
+    }
+}
+
+template <typename Engine>
+bool sameGame(const BoardEngine<>& engine, const Engine& other)
+{
+    if (engine.getLength() != other.getLength() || engine.getPoints() != other.getPoints() || engine.isDead() != other.isDead()
+        || engine.getDirection() != other.getDirection() || engine.hasFood() != other.hasFood() || engine.getFood() != other.getFood())
+    {
+        return false;
+    }
+    for (int i = 0; i < engine.getLength(); i ++)
+    {
+        if (engine.getSegment(i) != other.getSegment(i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Each key turns the snake and steps it one to four times. The other engine,
+// if there is one, is given the same keys and has to play the same game.
+template <typename Engine>
+void playKeys(BoardEngine<>& engine, Engine* other, int initialSnakeLength, bool wrap, const uint8_t* keys, size_t numKeys)
+{
+    std::vector<uint8_t> seen;
+    for (size_t i = 0; i < numKeys; i ++)
+    {
+        Direction direction = static_cast<Direction>(keys[i] & 3);
+        [[maybe_unused]] bool turned = engine.changeDirection(direction);
+        assert(!other || other->changeDirection(direction) == turned);
+        int steps = 1 + (keys[i] >> 2) % 4;
+        for (int j = 0; j < steps; j ++)
+        {
+            [[maybe_unused]] int points = engine.getPoints();
+            StepResult result = engine.step();
+            assert(!other || other->step() == result);
+            assert(engine.getPoints() == points + (result == StepResult::Ate));
+            if (result == StepResult::Died)
+            {
+                checkBoard(engine, initialSnakeLength, wrap, seen);
+                assert(!other || sameGame(engine, *other));
+                engine.reset();
+                if (other)
+                {
+                    other->reset();
+                }
+            }
+        }
+    }
+    checkBoard(engine, initialSnakeLength, wrap, seen);
+    assert(!other || sameGame(engine, *other));
+}
+
+}
+
+int fuzzSnapshot(const uint8_t* data, size_t size)
+{
+    GameSnapshot snapshot;
+    if (decodeSnapshot(data, size, snapshot))
+    {
+        checkRoundTrip(snapshot);
+    }
+    if (size == 0)
+    {
+        return 0;
+    }
+    std::vector<unsigned char> sealed = sealSnapshot(data, size);
+    if (decodeSnapshot(sealed.data(), sealed.size(), snapshot))
+    {
+        checkRoundTrip(snapshot);
+    }
+    return 0;
+}
+
+std::vector<unsigned char> sealSnapshot(const uint8_t* data, size_t size)
+{
+    // Magic, version, payload size and checksum, then the rest of the input
+    const size_t headerSize = 13;
+    uint32_t payloadSize = size - 1;
+    std::vector<unsigned char> sealed;
+    sealed.reserve(headerSize + payloadSize);
+    const char magic[] = "SNKS";
+    sealed.insert(sealed.end(), magic, magic + 4);
+    sealed.push_back(1 + data[0] % SnapshotVersion);
+    sealed.resize(headerSize, 0);
+    sealed.insert(sealed.end(), data + 1, data + size);
+    uint32_t hash = checksum(sealed.data() + headerSize, payloadSize);
+    for (int i = 0; i < 4; i ++)
+    {
+        sealed[5 + i] = (payloadSize >> (8 * i)) & 0xff;
+        sealed[9 + i] = (hash >> (8 * i)) & 0xff;
+    }
+    return sealed;
+}
+
+int fuzzLeaderBoard(const uint8_t* data, size_t size)
+{
+    std::vector<int> leaders(NumLeaders, 7);
+    [[maybe_unused]] int count = decodeLeaderBoard(reinterpret_cast<const char*>(data), size, leaders);
+    assert(count == std::min<size_t>(NumLeaders, size / sizeof(int)));
+    assert(static_cast<int>(leaders.size()) == NumLeaders);
+    for (int i = 0; i < NumLeaders; i ++)
+    {
+        assert(i < count ? leaders[i] >= 0 : leaders[i] == 7);
+    }
+    return 0;
+}
+
+int fuzzLevel(const uint8_t* data, size_t size)
+{
+    Level level;
+    if (!level.parse(reinterpret_cast<const char*>(data), size))
+    {
+        assert(!level.isLoaded());
+        return 0;
+    }
+    assert(level.isLoaded());
+    int width = level.getWidth();
+    int height = level.getHeight();
+    assert(width >= 3 && height >= 3 && width <= Level::MaxSize && height <= Level::MaxSize);
+    [[maybe_unused]] SnakeBody start = level.getStart();
+    assert(isInside(start, width, height));
+    assert(!level.isWall(start.getX(), start.getY()) && !level.isWall(start.getX(), start.getY() + 1));
+    assert(level.getDistance(start.getX(), start.getY()) == 0);
+    for (int x = 0; x < width; x ++)
+    {
+        assert(level.isWall(x, 0) && level.isWall(x, height - 1));
+    }
+    for (int y = 0; y < height; y ++)
+    {
+        assert(level.isWall(0, y) && level.isWall(width - 1, y));
+    }
+    return 0;
+}
+
+int fuzzEngine(const uint8_t* data, size_t size)
+{
+    if (size < 3)
+    {
+        return 0;
+    }
+    // Small boards, so the snake fills them and wraps around often enough
+    bool specialized = data[0] & 0x80;
+    int width = specialized ? 16 : 5 + data[0] % 8;
+    int height = specialized ? 16 : 5 + data[1] % 8;
+    bool wrap = data[2] & 1;
+    // Room for the body below the head in the middle
+    int length = std::min(1 + (data[2] >> 1) % 4, height - height / 2 - 1);
+
+    // Seeding the random generator costs more than most games, so every
+    // shape of board is made once and copied. The food falls the same way
+    // for the same keys, it is the keys that are fuzzed.
+    static std::map<int, BoardEngine<>> boards;
+    static std::map<int, BoardEngine<16, 16>> specializedBoards;
+    int shape = ((width * 64 + height) * 2 + wrap) * 8 + length;
+    if (boards.find(shape) == boards.end())
+    {
+        boards.emplace(shape, BoardEngine<>(width, height, length, EngineSeed, wrap));
+    }
+    BoardEngine<> engine(boards.find(shape)->second);
+    if (specialized)
+    {
+        if (specializedBoards.find(shape) == specializedBoards.end())
+        {
+            specializedBoards.emplace(shape, BoardEngine<16, 16>(width, height, length, EngineSeed, wrap));
+        }
+        BoardEngine<16, 16> other(specializedBoards.find(shape)->second);
+        playKeys(engine, &other, length, wrap, data + 3, size - 3);
+    }
+    else
+    {
+        playKeys<BoardEngine<>>(engine, nullptr, length, wrap, data + 3, size - 3);
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// What the fuzzers feed with made up bytes. Each takes any input at all and
+// aborts, through assert, if the code it drives breaks a rule it has to keep;
+// the sanitizers the fuzzers are built with catch the rest. fuzzentry.cpp
+// makes one of them a fuzzer, snakebench replays the corpora in fuzz/
+// through them as a workload.
+
+// A save file as it is, and the same bytes behind a header that checks out.
+// Whatever decodes has to encode and decode to the same thing again.
+int fuzzSnapshot(const uint8_t* data, size_t size);
+// The same two files loaded by Game::loadGame on a null renderer, which
+// then plays until the snake dies or for 200 ticks. In fuzzgame.cpp, as the
+// only fuzzer that needs the whole game.
+int fuzzGameLoad(const uint8_t* data, size_t size);
+// A leader board file, into a board of ten
+int fuzzLeaderBoard(const uint8_t* data, size_t size);
+// A level file, a level that parses has to be one a game can start on
+int fuzzLevel(const uint8_t* data, size_t size);
+// Three bytes set up a board, every byte after that is a key and a few steps.
+// The board has to stay whole through the game. A 16x16 game is played on
+// BoardEngine<16, 16> side by side and has to come out the same on both.
+int fuzzEngine(const uint8_t* data, size_t size);
+
+// Made up bytes hardly ever get past a save file's checksum. The first byte
+// picks the version, the rest goes behind a header that checks out; size is
+// 1 or more.
+std::vector<unsigned char> sealSnapshot(const uint8_t* data, size_t size);
+
+#endif
@@ -0,0 +1,13 @@
+// One of the functions in fuzz.h as a fuzzer, built with -DFUZZ_TARGET set
+// to its name. The entry point is libFuzzer's, so clang's -fsanitize=fuzzer
+// links straight to it; with g++ fuzzmain.cpp drives it instead.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fuzz.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    return FUZZ_TARGET(data, size);
+}
@@ -0,0 +1,33 @@
+#include <memory>
+
+#include "fuzz.h"
+#include "game.h"
+#include "renderer.h"
+
+namespace
+{
+
+const int MaxTicks = 200;
+
+}
+
+int fuzzGameLoad(const uint8_t* data, size_t size)
+{
+    Game game(std::unique_ptr<Renderer>(new NullRenderer(80, 24)));
+    bool loaded = game.loadGame(data, size);
+    if (!loaded && size > 0)
+    {
+        std::vector<unsigned char> sealed = sealSnapshot(data, size);
+        loaded = game.loadGame(sealed.data(), sealed.size());
+    }
+    if (!loaded)
+    {
+        return 0;
+    }
+    // What startGame does with a loaded game, then the ticks runGame would play
+    game.renderBoards();
+    for (int tick = 0; tick < MaxTicks && game.playTick(); tick ++)
+    {
+    }
+    return 0;
+}
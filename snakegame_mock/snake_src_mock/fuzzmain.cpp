@@ -0,0 +1,452 @@
+// A small coverage guided fuzzer for g++, which has no libFuzzer. The code
+// under test is built with -fsanitize-coverage=trace-pc, so every block it
+// runs calls __sanitizer_cov_trace_pc below; consecutive blocks make an edge
+// and how often an edge ran, in powers of two, a feature. An input that shows
+// a feature no input before it did joins the corpus, and new inputs are
+// mutations of inputs in the corpus. This file itself is built without the
+// coverage calls. It takes the libFuzzer options the Makefile uses:
+//
+//   snakefuzz-x [-runs=N] [-max_total_time=S] [-max_len=N] [-seed=N] [dir...]
+//       inputs that show something new are written to the first dir
+//   snakefuzz-x -merge=1 out dir...
+//       the smallest inputs of the dirs that show everything they do, into out
+//   snakefuzz-x file...
+//       runs each file once, to reproduce a crash
+//
+// A crash, a failed assert or a sanitizer report leaves the input that
+// caused it in crash-<hash> in the working directory.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <csignal>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+// Only there in a sanitized build
+extern "C" __attribute__((weak)) void __sanitizer_set_death_callback(void (*callback)());
+
+namespace
+{
+
+const uint32_t MapSize = 1 << 18;
+
+// Times each edge ran during this input, and the edges that ran at all so
+// only they are looked at and cleared afterwards
+uint8_t gCounts[MapSize];
+uint32_t gTouched[MapSize];
+uint32_t gNumTouched = 0;
+uint32_t gPrevious = 0;
+// The hit count buckets every input so far showed for each edge, a bit each
+uint8_t gSeen[MapSize];
+long long gNumFeatures = 0;
+long long gNumEdges = 0;
+
+// The input being run, for the crash handlers
+const uint8_t* gCurrentData = nullptr;
+size_t gCurrentSize = 0;
+volatile sig_atomic_t gCrashed = 0;
+
+uint64_t hashBytes(const uint8_t* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i ++)
+    {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// 1, 2, 3, 4-7, 8-15, 16-31, 32-127 and 128 or more times, like AFL
+uint8_t countBucket(uint8_t count)
+{
+    return count == 1 ? 1 : count == 2 ? 2 : count == 3 ? 4 : count < 8 ? 8 : count < 16 ? 16 : count < 32 ? 32 : count < 128 ? 64 : 128;
+}
+
+// Runs data and returns how many features it showed that no input before it did
+int runInput(const uint8_t* data, size_t size)
+{
+    gPrevious = 0;
+    gCurrentData = data;
+    gCurrentSize = size;
+    LLVMFuzzerTestOneInput(data, size);
+    int features = 0;
+    for (uint32_t i = 0; i < gNumTouched; i ++)
+    {
+        uint32_t edge = gTouched[i];
+        uint8_t bucket = countBucket(gCounts[edge]);
+        if (!(gSeen[edge] & bucket))
+        {
+            gNumEdges += gSeen[edge] == 0;
+            gSeen[edge] |= bucket;
+            features ++;
+        }
+        gCounts[edge] = 0;
+    }
+    gNumTouched = 0;
+    gNumFeatures += features;
+    return features;
+}
+
+void writeCrash()
+{
+    if (gCrashed)
+    {
+        return;
+    }
+    gCrashed = 1;
+    std::ostringstream name;
+    name << "crash-" << std::hex << std::setw(16) << std::setfill('0') << hashBytes(gCurrentData, gCurrentSize);
+    int fd = open(name.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+    {
+        ssize_t written = write(fd, gCurrentData, gCurrentSize);
+        close(fd);
+        std::cerr << "==" << getpid() << "== " << gCurrentSize << " byte input written to " << name.str() << (written < 0 ? " (failed)" : "") << std::endl;
+    }
+}
+
+void onCrashSignal(int signal)
+{
+    writeCrash();
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+bool isDirectory(const std::string& path)
+{
+    struct stat status;
+    return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+bool readFile(const std::string& path, std::vector<uint8_t>& data)
+{
+    std::ifstream file(path, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+// The files in a directory, sorted so a run goes the same way every time
+std::vector<std::string> listFiles(const std::string& directory)
+{
+    std::vector<std::string> files;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        return files;
+    }
+    while (dirent* entry = readdir(dir))
+    {
+        std::string path = directory + "/" + entry->d_name;
+        if (entry->d_name[0] != '.' && !isDirectory(path))
+        {
+            files.push_back(path);
+        }
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Named after what is in it, so the same input is only ever written once
+void writeInput(const std::string& directory, const std::vector<uint8_t>& data)
+{
+    std::ostringstream name;
+    name << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hashBytes(data.data(), data.size());
+    std::ofstream file(name.str(), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+void mutate(std::vector<uint8_t>& data, const std::vector<std::vector<uint8_t>>& corpus, size_t maxLength, std::mt19937& random)
+{
+    static const uint8_t Interesting[] = {0, 1, 2, 3, 4, 7, 8, 15, 16, 31, 32, 63, 64, 127, 128, 255};
+    int mutations = 1 + random() % 4;
+    for (int i = 0; i < mutations; i ++)
+    {
+        size_t size = data.size();
+        switch (size == 0 ? 2 : random() % 8)
+        {
+            case 0:
+                data[random() % size] ^= 1 << (random() % 8);
+                break;
+            case 1:
+                data[random() % size] = random();
+                break;
+            case 2:
+            {
+                size_t at = random() % (size + 1);
+                int count = 1 + random() % 4;
+                for (int j = 0; j < count; j ++)
+                {
+                    data.insert(data.begin() + at, static_cast<uint8_t>(random()));
+                }
+                break;
+            }
+            case 3:
+            {
+                size_t at = random() % size;
+                size_t count = 1 + random() % std::min<size_t>(size - at, 8);
+                data.erase(data.begin() + at, data.begin() + at + count);
+                break;
+            }
+            case 4:
+                data[random() % size] += static_cast<int>(random() % 9) - 4;
+                break;
+            case 5:
+                data[random() % size] = Interesting[random() % sizeof(Interesting)];
+                break;
+            case 6:
+            {
+                // A piece of the input again somewhere else
+                size_t from = random() % size;
+                size_t count = 1 + random() % std::min<size_t>(size - from, 16);
+                std::vector<uint8_t> piece(data.begin() + from, data.begin() + from + count);
+                data.insert(data.begin() + random() % (size + 1), piece.begin(), piece.end());
+                break;
+            }
+            case 7:
+            {
+                // The start of this input and the rest of another
+                const std::vector<uint8_t>& other = corpus[random() % corpus.size()];
+                if (!other.empty())
+                {
+                    size_t keep = random() % (size + 1);
+                    size_t from = random() % other.size();
+                    data.resize(keep);
+                    data.insert(data.end(), other.begin() + from, other.end());
+                }
+                break;
+            }
+        }
+    }
+    if (data.size() > maxLength)
+    {
+        data.resize(maxLength);
+    }
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printStatus(const char* what, long long runs, size_t corpusSize, std::chrono::steady_clock::time_point start)
+{
+    double seconds = secondsSince(start);
+    std::cerr << "#" << runs << "\t" << what << " cov: " << gNumEdges << " ft: " << gNumFeatures << " corp: " << corpusSize
+              << " exec/s: " << static_cast<long long>(seconds > 0 ? runs / seconds : 0) << std::endl;
+}
+
+// The inputs of the dirs from the smallest up, each kept if it shows something new
+int merge(const std::string& out, const std::vector<std::string>& directories)
+{
+    std::vector<std::string> files = listFiles(out);
+    size_t numOld = files.size();
+    for (int i = 0; i < directories.size(); i ++)
+    {
+        std::vector<std::string> more = listFiles(directories[i]);
+        files.insert(files.end(), more.begin(), more.end());
+    }
+    std::vector<std::vector<uint8_t>> inputs(files.size());
+    std::vector<int> order;
+    for (int i = 0; i < files.size(); i ++)
+    {
+        readFile(files[i], inputs[i]);
+        if (i >= numOld)
+        {
+            order.push_back(i);
+        }
+    }
+    // What is in out already counts first
+    for (int i = 0; i < numOld; i ++)
+    {
+        runInput(inputs[i].data(), inputs[i].size());
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+    {
+        return inputs[a].size() < inputs[b].size();
+    });
+    int added = 0;
+    for (int i = 0; i < order.size(); i ++)
+    {
+        const std::vector<uint8_t>& input = inputs[order[i]];
+        if (runInput(input.data(), input.size()) > 0)
+        {
+            writeInput(out, input);
+            added ++;
+        }
+    }
+    std::cerr << "MERGE-OUTER: " << order.size() << " new files with " << gNumFeatures << " features, " << added << " added to " << out << std::endl;
+    return 0;
+}
+
+}
+
+extern "C" __attribute__((no_sanitize_coverage, no_sanitize("address", "undefined"))) void __sanitizer_cov_trace_pc()
+{
+    uintptr_t pc = reinterpret_cast<uintptr_t>(__builtin_return_address(0));
+    uint32_t location = static_cast<uint32_t>((pc ^ (pc >> 17)) * 2654435761u) & (MapSize - 1);
+    uint32_t edge = location ^ gPrevious;
+    gPrevious = location >> 1;
+    uint8_t& count = gCounts[edge];
+    if (count == 0)
+    {
+        gTouched[gNumTouched ++] = edge;
+    }
+    count += count < 255;
+}
+
+int main(int argc, char** argv)
+{
+    long long maxRuns = -1;
+    double maxSeconds = 0;
+    size_t maxLength = 4096;
+    unsigned seed = std::random_device()();
+    bool merging = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i ++)
+    {
+        std::string argument = argv[i];
+        size_t equals = argument.find('=');
+        std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+        if (argument.rfind("-runs=", 0) == 0)
+        {
+            maxRuns = std::atoll(value.c_str());
+        }
+        else if (argument.rfind("-max_total_time=", 0) == 0)
+        {
+            maxSeconds = std::atof(value.c_str());
+        }
+        else if (argument.rfind("-max_len=", 0) == 0)
+        {
+            maxLength = std::max(1, std::atoi(value.c_str()));
+        }
+        else if (argument.rfind("-seed=", 0) == 0)
+        {
+            seed = std::strtoul(value.c_str(), nullptr, 10);
+        }
+        else if (argument.rfind("-merge=", 0) == 0)
+        {
+            merging = value == "1";
+        }
+        else if (argument[0] == '-')
+        {
+            std::cerr << "Unknown option " << argument << std::endl;
+            return 2;
+        }
+        else
+        {
+            paths.push_back(argument);
+        }
+    }
+
+    if (__sanitizer_set_death_callback)
+    {
+        __sanitizer_set_death_callback(writeCrash);
+    }
+    std::signal(SIGABRT, onCrashSignal);
+    std::signal(SIGSEGV, onCrashSignal);
+    std::signal(SIGFPE, onCrashSignal);
+    std::signal(SIGILL, onCrashSignal);
+
+    if (merging)
+    {
+        if (paths.size() < 2)
+        {
+            std::cerr << "-merge=1 takes an out dir and the dirs to merge" << std::endl;
+            return 2;
+        }
+        return merge(paths[0], std::vector<std::string>(paths.begin() + 1, paths.end()));
+    }
+
+    if (!paths.empty() && !isDirectory(paths[0]))
+    {
+        for (int i = 0; i < paths.size(); i ++)
+        {
+            std::vector<uint8_t> data;
+            if (!readFile(paths[i], data))
+            {
+                std::cerr << "Cannot read " << paths[i] << std::endl;
+                return 1;
+            }
+            std::cerr << "Running: " << paths[i] << std::endl;
+            runInput(data.data(), data.size());
+            std::cerr << "Executed " << paths[i] << std::endl;
+        }
+        return 0;
+    }
+
+    std::cerr << "INFO: Seed: " << seed << std::endl;
+    std::mt19937 random(seed);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::vector<uint8_t>> corpus;
+    long long runs = 0;
+    for (int i = 0; i < paths.size(); i ++)
+    {
+        std::vector<std::string> files = listFiles(paths[i]);
+        for (int j = 0; j < files.size(); j ++)
+        {
+            std::vector<uint8_t> data;
+            readFile(files[j], data);
+            if (data.size() > maxLength)
+            {
+                data.resize(maxLength);
+            }
+            runInput(data.data(), data.size());
+            runs ++;
+            corpus.push_back(data);
+        }
+    }
+    if (corpus.empty())
+    {
+        corpus.push_back(std::vector<uint8_t>());
+        runInput(nullptr, 0);
+        runs ++;
+    }
+    printStatus("INITED", runs, corpus.size(), start);
+
+    std::vector<uint8_t> input;
+    long long nextPulse = 1;
+    while (maxRuns < 0 || runs < maxRuns)
+    {
+        if ((runs & 1023) == 0 && maxSeconds > 0 && secondsSince(start) >= maxSeconds)
+        {
+            break;
+        }
+        input = corpus[random() % corpus.size()];
+        mutate(input, corpus, maxLength, random);
+        int features = runInput(input.data(), input.size());
+        runs ++;
+        if (features > 0)
+        {
+            corpus.push_back(input);
+            if (!paths.empty())
+            {
+                writeInput(paths[0], input);
+            }
+            printStatus("NEW", runs, corpus.size(), start);
+        }
+        else if (runs >= nextPulse)
+        {
+            printStatus("pulse", runs, corpus.size(), start);
+        }
+        nextPulse = runs >= nextPulse ? nextPulse * 2 : nextPulse;
+    }
+    double seconds = secondsSince(start);
+    printStatus("DONE", runs, corpus.size(), start);
+    std::cerr << "Done " << runs << " runs in " << static_cast<long long>(seconds) << " second(s)" << std::endl;
+    return 0;
+}
@@ -8,42 +8,309 @@
 
 #include <fstream>
 #include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+#include <poll.h>
+#include <sys/socket.h>
 
 #include "game.h"
+#include "net.h"
+#include "protocol.h"
+#include "predict.h"
+#include "leaderboard.h"
+
+namespace
+{
+
+// Frames the game draws before it must stop allocating
+const int AllocationWarmupTicks = 2;
+
+// Segments reserved up front in a big world, longer snakes grow on the heap
+const int LargeWorldReservedLength = 4096;
+// The most tiles a snake of that length can be on at once, one every tile length
+// it goes and a few where it turns around corners
+const int LargeWorldReservedTiles = 2 * LargeWorldReservedLength / TileMap::TileSize + 4;
+// Random cells tried for a food before the board counts as full
+const int MaxFoodTries = 1000;
+// The board never gets smaller than this, however small the terminal
+const int MinBoardSize = 8;
+// A headless game that goes on this long is called off, the autopilot can go round in circles
+const long long MaxHeadlessTicks = 1000000;
+
+long long steadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// World cells from -> to of one axis are drawn shifted by shift. A view runs
+// over the edge of a wrapping world into a second span from its start.
+struct ViewSpan
+{
+    int from;
+    int to;
+    int shift;
+};
+
+// The spans a view of size cells from camera shows of a world that size, returns how many.
+// A world that fits the view isn't scrolled, wrapping or not.
+int viewSpans(int camera, int view, int world, bool wrap, ViewSpan (&spans)[2])
+{
+    spans[0] = {camera, camera + view, 1 - camera};
+    if (!wrap || view >= world - 2 || camera + view <= world - 1)
+    {
+        return 1;
+    }
+    spans[0].to = world - 1;
+    spans[1] = {1, 1 + camera + view - (world - 1), world - 1 - camera};
+    return 2;
+}
+
+// Decimal text of value in the caller's buffer, so drawing numbers needs no std::string
+const char* formatInteger(int value, char (&buffer)[12])
+{
+    char* text = buffer + sizeof(buffer) - 1;
+    *text = '\0';
+    unsigned int magnitude = value < 0 ? 0u - value : value;
+    do
+    {
+        *-- text = '0' + magnitude % 10;
+        magnitude /= 10;
+    }
+    while (magnitude > 0);
+    if (value < 0)
+    {
+        *-- text = '-';
+    }
+    return text;
+}
+
+}
+
+Game::Game(): Game(createRenderer("ncurses"))
+{
+}
+
+Game::Game(std::unique_ptr<Renderer> renderer): Game(std::move(renderer), GameConfig())
+{
+}
 
-Game::Game()
+Game::Game(std::unique_ptr<Renderer> renderer, const GameConfig& config): mMaxBoardWidth(config.boardWidth), mMaxBoardHeight(config.boardHeight), mRenderer(std::move(renderer)),
+    mInitialSnakeLength(config.initialSnakeLength), mStats(&threadStats()), mStatsFilePath(config.statsFile), mRecordBoardFilePath(config.leaderBoardPath),
+    mSaveFilePath(config.savePath), mNumLeaders(config.numLeaders)
 {
     // Separate the screen to three windows
     this->mWindows.resize(3);
-    initscr();
-    // If there wasn't any key pressed don't wait for keypress
-    nodelay(stdscr, true);
-    // Turn on keypad control
-    keypad(stdscr, true);
-    // No echo for the key pressed
-    noecho();
-    // No cursor show
-    curs_set(0);
+    this->mRandom.seed(std::time(nullptr));
     // Get screen and board parameters
-    getmaxyx(stdscr, this->mScreenHeight, this->mScreenWidth);
-    this->mGameBoardWidth = this->mScreenWidth - this->mInstructionWidth;
-    this->mGameBoardHeight = this->mScreenHeight - this->mInformationHeight;
+    this->fitGameBoard();
 
     this->createInformationBoard();
     this->createGameBoard();
     this->createInstructionBoard();
+    this->createRestartMenu();
+
+    this->mWorldWidth = this->mGameBoardWidth;
+    this->mWorldHeight = this->mGameBoardHeight;
+    this->createGameMemory();
 
     // Initialize the leader board to be all zeros
     this->mLeaderBoard.assign(this->mNumLeaders, 0);
+    this->subscribeEvents();
+    prepareTraceThread();
+
+    this->setSpeedCurve(config.speed);
+    this->setFoodRules(config.food);
+    this->setWrap(config.wrap);
+    if (config.seed != 0)
+    {
+        this->setSeed(config.seed);
+    }
+    if (config.level.isLoaded())
+    {
+        this->setLevel(config.level);
+    }
+    else if (config.worldWidth > 0)
+    {
+        this->setWorldSize(config.worldWidth, config.worldHeight);
+    }
+    if (!config.eventLog.empty())
+    {
+        this->enableEventLog(config.eventLog);
+    }
 }
 
-Game::~Game()
+// Who reacts to what playTick reports
+void Game::subscribeEvents()
 {
-    for (int i = 0; i < this->mWindows.size(); i ++)
+    // The panel only changes when the numbers on it do
+    this->mEvents.subscribe(GameEventType::ScoreChanged, [this](const GameEvent&)
+    {
+        this->adjustDelay();
+        this->renderPoints();
+        this->mStats->setPoints(this->mPoints);
+    });
+    this->mEvents.subscribe(GameEventType::FoodEaten, [this](const GameEvent&)
+    {
+        this->mStats->setLength(this->mLargeWorld ? this->mBody.getLength() : this->mPtrSnake->getLength());
+    });
+    this->mEvents.subscribe(GameEventType::DifficultyChanged, [this](const GameEvent&)
+    {
+        this->renderDifficulty();
+    });
+    // The leader board takes the score, startGame saves it
+    this->mEvents.subscribe(GameEventType::SnakeDied, [this](const GameEvent&)
+    {
+        this->updateLeaderBoard();
+    });
+    this->mEvents.subscribeAll([this](const GameEvent& event)
+    {
+        this->mEventCounts[static_cast<int>(event.type)] ++;
+        traceInstant(TraceEvent::GameEvent, this->mTick, static_cast<int>(event.type), event.value, event.x, event.y);
+        if (this->mEventLog)
+        {
+            *this->mEventLog << this->mTick << " " << getEventName(event.type) << " " << event.value << " " << event.x << " " << event.y << "\n";
+        }
+    });
+}
+
+// The game as it is now, see snapshot.h for the format
+bool Game::saveGame(const std::string& path) const
+{
+    GameSnapshot snapshot;
+    snapshot.worldWidth = this->mWorldWidth;
+    snapshot.worldHeight = this->mWorldHeight;
+    snapshot.largeWorld = this->mLargeWorld;
+    snapshot.wrap = this->mWrap;
+    snapshot.points = this->mPoints;
+    snapshot.difficulty = this->mDifficulty;
+    snapshot.direction = this->mPtrSnake->getDirection();
+    long long tick = this->mFoodTick;
+    this->mFoods.forEach([&snapshot, tick](const FoodItem& item)
+    {
+        SavedFood food;
+        food.cell = item.cell;
+        food.value = item.value;
+        food.ticksLeft = item.expires == 0 ? 0 : item.expires - tick;
+        snapshot.foods.push_back(food);
+    });
+    if (this->mLargeWorld)
+    {
+        this->mBody.forEach([&snapshot](SnakeBody cell)
+        {
+            snapshot.body.push_back(cell);
+        });
+    }
+    else
     {
-        delwin(this->mWindows[i]);
+        snapshot.body.assign(this->mPtrSnake->getSnake().begin(), this->mPtrSnake->getSnake().end());
     }
-    endwin();
+    snapshot.random = this->mRandom;
+    std::vector<unsigned char> data;
+    encodeSnapshot(data, snapshot);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(file);
+}
+
+// Sets up the next game from a save instead of a new one.
+// The file is read in one go and decoded in one pass.
+bool Game::loadGame(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<unsigned char> data(file.tellg());
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    return file && this->loadGame(data.data(), data.size());
+}
+
+bool Game::loadGame(const unsigned char* data, size_t size)
+{
+    GameSnapshot snapshot;
+    if (!decodeSnapshot(data, size, snapshot))
+    {
+        return false;
+    }
+
+    // A level game goes on with the same level
+    if (this->mLevel.isLoaded() && (!snapshot.largeWorld || snapshot.worldWidth != this->mLevel.getWidth() || snapshot.worldHeight != this->mLevel.getHeight()))
+    {
+        return false;
+    }
+    this->mLargeWorld = snapshot.largeWorld;
+    this->mWorldWidth = snapshot.worldWidth;
+    this->mWorldHeight = snapshot.worldHeight;
+    this->mWrap = snapshot.wrap;
+    this->createGameMemory();
+    this->mPtrSnake.reset(this->mGameMemory->create<Snake>(this->mWorldWidth, this->mWorldHeight, this->mInitialSnakeLength, this->mGameMemory->getResource(), this->mReservedLength));
+    this->mPtrSnake->setWrap(this->mWrap);
+    if (this->mLargeWorld)
+    {
+        this->packBody(snapshot.body);
+        this->mPtrSnake->getSnake().assign(1, snapshot.body[0]);
+    }
+    else
+    {
+        this->mPtrSnake->getSnake().assign(snapshot.body.begin(), snapshot.body.end());
+    }
+    this->mPtrSnake->setDirection(snapshot.direction);
+    // The clock starts again at 0, food keeps the ticks it had left
+    this->mFoods.reset(this->mWorldWidth, this->mWorldHeight);
+    this->mFoods.reserve(std::max<size_t>(this->mFoodRules.count, snapshot.foods.size()));
+    for (int i = 0; i < snapshot.foods.size(); i ++)
+    {
+        this->mFoods.add(snapshot.foods[i].cell, snapshot.foods[i].value, snapshot.foods[i].ticksLeft);
+    }
+    this->mPoints = snapshot.points;
+    this->mDifficulty = snapshot.difficulty;
+    this->adjustDelay();
+    this->mRandom = snapshot.random;
+    this->mTick = 0;
+    this->mFoodTick = 0;
+
+    this->layoutWindows();
+    this->updateCamera();
+    this->mRedrawAll = true;
+    this->mResumed = true;
+    return true;
+}
+
+bool Game::resumeGame()
+{
+    return this->loadGame(this->mSaveFilePath);
+}
+
+bool Game::enableEventLog(const std::string& path)
+{
+    this->mEventLog.reset(new std::ofstream(path));
+    if (!*this->mEventLog)
+    {
+        this->mEventLog.reset();
+        return false;
+    }
+    return true;
+}
+
+long long Game::getTickAllocations() const
+{
+    return this->mTickAllocations;
+}
+
+long long Game::getNumEvents(GameEventType type) const
+{
+    return this->mEventCounts[static_cast<int>(type)];
+}
+
+// The renderer gives the terminal back when it goes
+Game::~Game()
+{
 }
 
 //
@@ -51,17 +318,17 @@ void Game::createInformationBoard()
 {
     int startY = 0;
     int startX = 0;
-    this->mWindows[0] = newwin(this->mInformationHeight, this->mScreenWidth, startY, startX);
+    this->mWindows[0] = this->mRenderer->createWindow(startX, startY, this->mScreenWidth, this->mInformationHeight);
 }
 
 //ʾ
 void Game::renderInformationBoard() const
 {
-    mvwprintw(this->mWindows[0], 1, 1, "Welcome to The Snake Game!");
-    mvwprintw(this->mWindows[0], 2, 1, "This is a mock version.");
-    mvwprintw(this->mWindows[0], 3, 1, "Please fill in the blanks to make it work properly!!");
-    mvwprintw(this->mWindows[0], 4, 1, "Implemented using C++ and libncurses library.");
-    wrefresh(this->mWindows[0]);
+    this->mRenderer->drawText(this->mWindows[0], 1, 1, "Welcome to The Snake Game!");
+    this->mRenderer->drawText(this->mWindows[0], 1, 2, "This is a mock version.");
+    this->mRenderer->drawText(this->mWindows[0], 1, 3, "Please fill in the blanks to make it work properly!!");
+    this->mRenderer->drawText(this->mWindows[0], 1, 4, "Implemented using C++ and libncurses library.");
+    this->mRenderer->stageWindow(this->mWindows[0]);
 }
 
 //Ϸ
@@ -69,124 +336,212 @@ void Game::createGameBoard()
 {
     int startY = this->mInformationHeight;
     int startX = 0;
-    this->mWindows[1] = newwin(this->mScreenHeight - this->mInformationHeight, this->mScreenWidth - this->mInstructionWidth, startY, startX);
+    this->mWindows[1] = this->mRenderer->createWindow(startX, startY, this->mGameBoardWidth, this->mGameBoardHeight);
 }
 
 //ʾϷ
 void Game::renderGameBoard() const
 {
-    wrefresh(this->mWindows[1]);
+    this->mRenderer->stageWindow(this->mWindows[1]);
 }
 
 //ʾ
 void Game::createInstructionBoard()
 {
     int startY = this->mInformationHeight;
-    int startX = this->mScreenWidth - this->mInstructionWidth;
-    this->mWindows[2] = newwin(this->mScreenHeight - this->mInformationHeight, this->mInstructionWidth, startY, startX);
+    int startX = this->mGameBoardWidth;
+    this->mWindows[2] = this->mRenderer->createWindow(startX, startY, this->mInstructionWidth, this->mGameBoardHeight);
 }
 
 //ʾʾ
 void Game::renderInstructionBoard() const
 {
-    mvwprintw(this->mWindows[2], 1, 1, "Manual");
+    this->mRenderer->drawText(this->mWindows[2], 1, 1, "Manual");
 
-    mvwprintw(this->mWindows[2], 3, 1, "Up: W");
-    mvwprintw(this->mWindows[2], 4, 1, "Down: S");
-    mvwprintw(this->mWindows[2], 5, 1, "Left: A");
-    mvwprintw(this->mWindows[2], 6, 1, "Right: D");
+    this->mRenderer->drawText(this->mWindows[2], 1, 3, "Up: W");
+    this->mRenderer->drawText(this->mWindows[2], 1, 4, "Down: S");
+    this->mRenderer->drawText(this->mWindows[2], 1, 5, "Left: A");
+    this->mRenderer->drawText(this->mWindows[2], 1, 6, "Right: D");
 
-    mvwprintw(this->mWindows[2], 8, 1, "Difficulty");
-    mvwprintw(this->mWindows[2], 11, 1, "Points");
+    this->mRenderer->drawText(this->mWindows[2], 1, 8, "Difficulty");
+    this->mRenderer->drawText(this->mWindows[2], 1, 11, "Points");
 
-    wrefresh(this->mWindows[2]);
+    this->mRenderer->stageWindow(this->mWindows[2]);
 }
 
 //ʾа
 void Game::renderLeaderBoard() const
 {
     // If there is not too much space, skip rendering the leader board
-    if (this->mScreenHeight - this->mInformationHeight - 14 - 2 < 3 * 2)
+    if (this->mGameBoardHeight - 14 - 2 < 3 * 2)
     {
         return;
     }
-    mvwprintw(this->mWindows[2], 14, 1, "Leader Board");
-    std::string pointString;
-    std::string rank;
-    for (int i = 0; i < std::min(this->mNumLeaders, this->mScreenHeight - this->mInformationHeight - 14 - 2); i ++)
+    this->mRenderer->drawText(this->mWindows[2], 1, 14, "Leader Board");
+    char buffer[12];
+    for (int i = 0; i < std::min(this->mNumLeaders, this->mGameBoardHeight - 14 - 2); i ++)
     {
-        pointString = std::to_string(this->mLeaderBoard[i]);
-        rank = "#" + std::to_string(i + 1) + ":";
-        mvwprintw(this->mWindows[2], 14 + (i + 1), 1, rank.c_str());
-        mvwprintw(this->mWindows[2], 14 + (i + 1), 5, pointString.c_str());
+        this->mRenderer->drawText(this->mWindows[2], 1, 14 + (i + 1), "#");
+        const char* rank = formatInteger(i + 1, buffer);
+        this->mRenderer->drawText(this->mWindows[2], 2, 14 + (i + 1), rank);
+        this->mRenderer->drawText(this->mWindows[2], 2 + std::strlen(rank), 14 + (i + 1), ":");
+        this->mRenderer->drawText(this->mWindows[2], 5, 14 + (i + 1), formatInteger(this->mLeaderBoard[i], buffer));
     }
-    wrefresh(this->mWindows[2]);
+    this->mRenderer->stageWindow(this->mWindows[2]);
 }
 
-//ϷڣѡRestartQuit
-bool Game::renderRestartMenu() const
+// Made once, the restart menu only redraws into it
+void Game::createRestartMenu()
 {
-    WINDOW * menu;
     int width = this->mGameBoardWidth * 0.5;
     int height = this->mGameBoardHeight * 0.5;
     int startX = this->mGameBoardWidth * 0.25;
     int startY = this->mGameBoardHeight * 0.25 + this->mInformationHeight;
+    this->mMenuWindow = this->mRenderer->createWindow(startX, startY, width, height);
+}
 
-    menu = newwin(height, width, startY, startX);
-    box(menu, 0, 0);
-    std::vector<std::string> menuItems = {"Restart", "Quit"};
-
-    int index = 0;
+// The whole menu with item index picked
+void Game::drawRestartMenu(int index) const
+{
+    static const char * const menuItems[] = {"Restart", "Quit"};
+    const int numMenuItems = 2;
+    int menu = this->mMenuWindow;
     int offset = 4;
-    mvwprintw(menu, 1, 1, "Your Final Score:");
-    std::string pointString = std::to_string(this->mPoints);
-    mvwprintw(menu, 2, 1, pointString.c_str());
-    wattron(menu, A_STANDOUT);
-    mvwprintw(menu, 0 + offset, 1, menuItems[0].c_str());
-    wattroff(menu, A_STANDOUT);
-    mvwprintw(menu, 1 + offset, 1, menuItems[1].c_str());
+    char buffer[12];
+    this->mRenderer->eraseWindow(menu);
+    this->mRenderer->drawBox(menu);
+    this->mRenderer->drawText(menu, 1, 1, "Your Final Score:");
+    this->mRenderer->drawText(menu, 1, 2, formatInteger(this->mPoints, buffer));
+    for (int i = 0; i < numMenuItems; i ++)
+    {
+        this->mRenderer->drawText(menu, 1, i + offset, menuItems[i], i == index);
+    }
+    this->mRenderer->stageWindow(menu);
+}
+
+// The board takes what the terminal has left after the panels. While a game
+// is on it keeps the size of its world, and the game pauses if that no longer fits.
+void Game::fitGameBoard()
+{
+    this->mScreenWidth = this->mRenderer->getWidth();
+    this->mScreenHeight = this->mRenderer->getHeight();
+    int width = std::max(this->mScreenWidth - this->mInstructionWidth, MinBoardSize);
+    int height = std::max(this->mScreenHeight - this->mInformationHeight, MinBoardSize);
+    if (this->mMaxBoardWidth > 0)
+    {
+        width = std::max(std::min(width, this->mMaxBoardWidth), MinBoardSize);
+        height = std::max(std::min(height, this->mMaxBoardHeight), MinBoardSize);
+    }
+    this->mPaused = false;
+    if (this->mPtrSnake && !this->mLargeWorld)
+    {
+        this->mPaused = width < this->mWorldWidth || height < this->mWorldHeight;
+        if (!this->mPaused)
+        {
+            width = this->mWorldWidth;
+            height = this->mWorldHeight;
+        }
+    }
+    this->mGameBoardWidth = width;
+    this->mGameBoardHeight = height;
+}
+
+// Same places as the create functions, windows already there are left alone
+void Game::layoutWindows()
+{
+    this->fitGameBoard();
+    this->mRenderer->placeWindow(this->mWindows[0], 0, 0, this->mScreenWidth, this->mInformationHeight);
+    this->mRenderer->placeWindow(this->mWindows[1], 0, this->mInformationHeight, this->mGameBoardWidth, this->mGameBoardHeight);
+    this->mRenderer->placeWindow(this->mWindows[2], this->mGameBoardWidth, this->mInformationHeight, this->mInstructionWidth, this->mGameBoardHeight);
+    int width = this->mGameBoardWidth * 0.5;
+    int height = this->mGameBoardHeight * 0.5;
+    int startX = this->mGameBoardWidth * 0.25;
+    int startY = this->mGameBoardHeight * 0.25 + this->mInformationHeight;
+    this->mRenderer->placeWindow(this->mMenuWindow, startX, startY, width, height);
+}
+
+// The renderer saw the terminal change size. The caller draws the next frame
+// as usual and presentFrame times how long it took to get there.
+void Game::handleResize()
+{
+    this->mResizeStart = steadyNanoseconds();
+    int width = this->mGameBoardWidth;
+    int height = this->mGameBoardHeight;
+    this->layoutWindows();
+    this->mRedrawAll = true;
+    // The view of a big world is what spectators get, and it changed size
+    bool viewChanged = width != this->mGameBoardWidth || height != this->mGameBoardHeight;
+    if (this->mPublisher && this->mLargeWorld && viewChanged && !this->mPublisher->reopen(this->mGameBoardWidth, this->mGameBoardHeight))
+    {
+        this->mPublisher.reset();
+    }
+}
 
-    wrefresh(menu);
+// Drawn over the information board instead of a game that doesn't fit
+void Game::renderPaused() const
+{
+    char message[128];
+    std::snprintf(message, sizeof(message), "Paused, the terminal needs to be at least %dx%d",
+                  this->mWorldWidth + this->mInstructionWidth, this->mWorldHeight + this->mInformationHeight);
+    this->mRenderer->drawText(this->mWindows[0], 1, 1, message, true);
+    this->mRenderer->stageWindow(this->mWindows[0]);
+}
+
+ResizeStats Game::getResizeStats() const
+{
+    return this->mResizeStats;
+}
+
+//ϷڣѡRestartQuit
+bool Game::renderRestartMenu()
+{
+    const int numMenuItems = 2;
+    int index = 0;
+    this->drawRestartMenu(index);
+    this->presentFrame();
 
     int key;
     while (true)
     {
-        key = getch();
+        key = this->mRenderer->readKey();
         switch(key)
         {
             case 'W':
             case 'w':
-            case KEY_UP:
+            case KeyUp:
             {
-                mvwprintw(menu, index + offset, 1, menuItems[index].c_str());
                 index --;
-                index = (index < 0) ? menuItems.size() - 1 : index;
-                wattron(menu, A_STANDOUT);
-                mvwprintw(menu, index + offset, 1, menuItems[index].c_str());
-                wattroff(menu, A_STANDOUT);
+                index = (index < 0) ? numMenuItems - 1 : index;
                 break;
             }
             case 'S':
             case 's':
-            case KEY_DOWN:
+            case KeyDown:
             {
-                mvwprintw(menu, index + offset, 1, menuItems[index].c_str());
                 index ++;
-                index = (index > menuItems.size() - 1) ? 0 : index;
-                wattron(menu, A_STANDOUT);
-                mvwprintw(menu, index + offset, 1, menuItems[index].c_str());
-                wattroff(menu, A_STANDOUT);
+                index = (index > numMenuItems - 1) ? 0 : index;
+                break;
+            }
+            case KeyResize:
+            {
+                // The last game goes back under the menu in the new layout
+                this->handleResize();
+                this->renderBoards();
+                this->renderSnake();
+                this->renderFood();
+                this->renderDifficulty();
+                this->renderPoints();
                 break;
             }
         }
-        wrefresh(menu);
+        this->drawRestartMenu(index);
+        this->presentFrame();
         if (key == ' ' || key == 10)
         {
             break;
         }
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
-    delwin(menu);
 
     if (index == 0)
     {
@@ -202,24 +557,59 @@ bool Game::renderRestartMenu() const
 //޸ķʾʾ
 void Game::renderPoints() const
 {
-    std::string pointString = std::to_string(this->mPoints);
-    mvwprintw(this->mWindows[2], 12, 1, pointString.c_str());
-    wrefresh(this->mWindows[2]);
+    char buffer[12];
+    this->mRenderer->drawText(this->mWindows[2], 1, 12, formatInteger(this->mPoints, buffer));
+    this->mRenderer->stageWindow(this->mWindows[2]);
 }
 
 //޸Ѷȣʾʾ
 void Game::renderDifficulty() const
 {
-    std::string difficultyString = std::to_string(this->mDifficulty);
-    mvwprintw(this->mWindows[2], 9, 1, difficultyString.c_str());
-    wrefresh(this->mWindows[2]);
+    char buffer[12];
+    this->mRenderer->drawText(this->mWindows[2], 1, 9, formatInteger(this->mDifficulty, buffer));
+    this->mRenderer->stageWindow(this->mWindows[2]);
 }
 
 //ʼϷ
 void Game::initializeGame()
 {
-    // allocate memory for a new snake
-    this->mPtrSnake.reset(new Snake(this->mGameBoardWidth, this->mGameBoardHeight, this->mInitialSnakeLength));
+    // The last game's snake goes back to the arena and the new one is carved from it
+    this->mPtrSnake.reset();
+    // A new game takes all the board the terminal has room for now
+    if (!this->mLargeWorld)
+    {
+        this->layoutWindows();
+        if (this->mWorldWidth != this->mGameBoardWidth || this->mWorldHeight != this->mGameBoardHeight)
+        {
+            this->mWorldWidth = this->mGameBoardWidth;
+            this->mWorldHeight = this->mGameBoardHeight;
+            this->createGameMemory();
+            // The ring's cells are numbered across the old board
+            if (this->mPublisher && !this->mPublisher->reopen(this->mWorldWidth, this->mWorldHeight))
+            {
+                this->mPublisher.reset();
+            }
+        }
+    }
+    this->mGameMemory->reset();
+    this->mPtrSnake.reset(this->mGameMemory->create<Snake>(this->mWorldWidth, this->mWorldHeight, this->getStartLength(), this->mGameMemory->getResource(), this->mReservedLength));
+    this->mPtrSnake->setWrap(this->mWrap);
+    if (this->mLevel.isLoaded())
+    {
+        // The head on the level's start, the tail below it
+        SnakeBodies& snake = this->mPtrSnake->getSnake();
+        SnakeBody start = this->mLevel.getStart();
+        for (int i = 0; i < snake.size(); i ++)
+        {
+            snake[i] = SnakeBody(start.getX(), start.getY() + i);
+        }
+    }
+    if (this->mLargeWorld)
+    {
+        this->packBody(this->mPtrSnake->getSnake());
+        this->mPtrSnake->getSnake().resize(1);
+    }
+    this->updateCamera();
 
     /* TODO
      * initialize the game pionts as zero
@@ -230,96 +620,201 @@ void Game::initializeGame()
 
     //ʼ
     this->mPoints = 0;
+    this->mTick = 0;
+    this->mFoodTick = 0;
+    this->mStats->startSession(this->getStartLength());
     this->renderPoints();
 
     //ʼѶ
     this->mDifficulty = 0;
+    this->adjustDelay();
     this->renderDifficulty();
 
-    //ʳ, Ѹ֪ʳ
-    this->createRamdonFood();
+    // The food the rules ask for, placed around the new snake
+    this->mFoods.reset(this->mWorldWidth, this->mWorldHeight);
+    this->mFoods.reserve(this->mFoodRules.count);
+    this->refillFood();
     this->renderFood();
 }
 
 //ʳ
-void Game::createRamdonFood()
+// false if no empty cell was found
+bool Game::createRamdonFood()
 {
     /* TODO
     * create a food at random places
     * make sure that the food doesn't overlap with the snake.
     */
     int foodX, foodY;
-    do {
-        foodX = (rand() % (this->mGameBoardWidth - 2)) + 1;
-        foodY = (rand() % (this->mGameBoardHeight - 2)) + 1;
+    int left = 1;
+    int top = 1;
+    int width = this->mWorldWidth - 2;
+    int height = this->mWorldHeight - 2;
+    // A big world drops the food within a screen of the head, or it would never be found
+    if (this->mLargeWorld)
+    {
+        SnakeBody head = this->mPtrSnake->getSnake()[0];
+        width = std::min(width, this->mGameBoardWidth - 2);
+        height = std::min(height, this->mGameBoardHeight - 2);
+        left = std::max(1, std::min(head.getX() - width / 2, this->mWorldWidth - 1 - width));
+        top = std::max(1, std::min(head.getY() - height / 2, this->mWorldHeight - 1 - height));
     }
-    while (this->mPtrSnake->isPartOfSnake(foodX, foodY));
+    for (int tries = 0; tries < MaxFoodTries; tries ++)
+    {
+        foodX = static_cast<int>(this->mRandom() % width) + left;
+        foodY = static_cast<int>(this->mRandom() % height) + top;
+        bool taken = this->mLargeWorld ? this->mOccupancy.test(foodX, foodY) : this->mPtrSnake->isPartOfSnake(foodX, foodY);
+        // Never in an obstacle or a pocket the snake can't get into
+        taken = taken || (this->mLevel.isLoaded() && !this->mLevel.isReachable(foodX, foodY));
+        if (!taken && !this->mFoods.contains(SnakeBody(foodX, foodY)))
+        {
+            int value = this->mFoodRules.maxValue > 1 ? 1 + static_cast<int>(this->mRandom() % this->mFoodRules.maxValue) : 1;
+            uint32_t expires = this->mFoodRules.lifetime > 0 ? this->mFoodTick + this->mFoodRules.lifetime : 0;
+            this->mStats->countFoodRetries(tries);
+            return this->mFoods.add(SnakeBody(foodX, foodY), value, expires);
+        }
+    }
+    this->mStats->countFoodRetries(MaxFoodTries);
+    return false;
+}
 
-    SnakeBody food(foodX, foodY);
-    this->mFood = food;
-    this->mPtrSnake->senseFood(food);
+// Tops the board up to the food the rules ask for
+void Game::refillFood()
+{
+    while (this->mFoods.size() < this->mFoodRules.count && this->createRamdonFood())
+    {
+    }
 }
 
 //ʾʳ
 void Game::renderFood() const
 {
-    mvwaddch(this->mWindows[1], this->mFood.getY(), this->mFood.getX(), this->mFoodSymbol);
-    wrefresh(this->mWindows[1]);
+    TraceSpan span(TraceEvent::RenderFood, this->mTick);
+    // Food worth more than a point shows its value
+    ViewSpan across[2];
+    ViewSpan down[2];
+    int numAcross = viewSpans(this->mCameraX, this->mGameBoardWidth - 2, this->mWorldWidth, this->mWrap, across);
+    int numDown = viewSpans(this->mCameraY, this->mGameBoardHeight - 2, this->mWorldHeight, this->mWrap, down);
+    for (int i = 0; i < numDown; i ++)
+    {
+        for (int j = 0; j < numAcross; j ++)
+        {
+            const ViewSpan& x = across[j];
+            const ViewSpan& y = down[i];
+            this->mFoods.forEachIn(x.from, y.from, x.to, y.to, [this, &x, &y](const FoodItem& food)
+            {
+                char symbol = food.value == 1 ? this->mFoodSymbol : '0' + std::min(food.value, 9);
+                this->mRenderer->drawChar(this->mWindows[1], food.cell.getX() + x.shift, food.cell.getY() + y.shift, symbol);
+            });
+        }
+    }
+    this->mRenderer->stageWindow(this->mWindows[1]);
 }
 
 //ʾ
 void Game::renderSnake() const
 {
+    TraceSpan span(TraceEvent::RenderSnake, this->mTick);
+    if (this->mLargeWorld)
+    {
+        // Only the tiles in view are looked at, however long the snake is
+        this->renderWalls();
+        ViewSpan across[2];
+        ViewSpan down[2];
+        int numAcross = viewSpans(this->mCameraX, this->mGameBoardWidth - 2, this->mWorldWidth, this->mWrap, across);
+        int numDown = viewSpans(this->mCameraY, this->mGameBoardHeight - 2, this->mWorldHeight, this->mWrap, down);
+        for (int i = 0; i < numDown; i ++)
+        {
+            for (int j = 0; j < numAcross; j ++)
+            {
+                const ViewSpan& x = across[j];
+                const ViewSpan& y = down[i];
+                this->mOccupancy.forEachIn(x.from, y.from, x.to, y.to, [this, &x, &y](int cellX, int cellY)
+                {
+                    this->mRenderer->drawChar(this->mWindows[1], cellX + x.shift, cellY + y.shift, this->mSnakeSymbol);
+                });
+            }
+        }
+        this->mRenderer->stageWindow(this->mWindows[1]);
+        return;
+    }
     int snakeLength = this->mPtrSnake->getLength();
-    std::vector<SnakeBody>& snake = this->mPtrSnake->getSnake();
+    SnakeBodies& snake = this->mPtrSnake->getSnake();
     for (int i = 0; i < snakeLength; i ++)
     {
-        mvwaddch(this->mWindows[1], snake[i].getY(), snake[i].getX(), this->mSnakeSymbol);
+        this->mRenderer->drawChar(this->mWindows[1], snake[i].getX(), snake[i].getY(), this->mSnakeSymbol);
     }
-    wrefresh(this->mWindows[1]);
+    this->mRenderer->stageWindow(this->mWindows[1]);
 }
 
 //ͨ̿ߵƶ
-void Game::controlSnake() const
+void Game::controlSnake()
 {
     int key;
-    key = getch();
+    key = this->mAutopilot ? this->autopilotKey() : this->mRenderer->readKey();
+    if (key != NoKey && key != KeyResize)
+    {
+        this->mStats->countInput();
+    }
     switch(key)
     {
+        case KeyResize:
+        {
+            this->handleResize();
+            break;
+        }
+        case 'Q':
+        case 'q':
+        {
+            this->mSaveRequested = true;
+            break;
+        }
         case 'W':
         case 'w':
-        case KEY_UP:
+        case KeyUp:
         {
             // TODO change the direction of the snake.
             if (this->mPtrSnake->getDirection() == Direction::Left || this->mPtrSnake->getDirection() == Direction::Right)
+            {
                 this->mPtrSnake->changeDirection(Direction::Up);
+                this->mEvents.emit(GameEventType::DirectionChanged, static_cast<int>(Direction::Up));
+            }
             break;
         }
         case 'S':
         case 's':
-        case KEY_DOWN:
+        case KeyDown:
         {
             // TODO change the direction of the snake.
             if (this->mPtrSnake->getDirection() == Direction::Left || this->mPtrSnake->getDirection() == Direction::Right)
+            {
                 this->mPtrSnake->changeDirection(Direction::Down);
+                this->mEvents.emit(GameEventType::DirectionChanged, static_cast<int>(Direction::Down));
+            }
             break;
         }
         case 'A':
         case 'a':
-        case KEY_LEFT:
+        case KeyLeft:
         {
             // TODO change the direction of the snake.
             if (this->mPtrSnake->getDirection() == Direction::Up || this->mPtrSnake->getDirection() == Direction::Down)
+            {
                 this->mPtrSnake->changeDirection(Direction::Left);
+                this->mEvents.emit(GameEventType::DirectionChanged, static_cast<int>(Direction::Left));
+            }
             break;
         }
         case 'D':
         case 'd':
-        case KEY_RIGHT:
+        case KeyRight:
         {
             // TODO change the direction of the snake.
             if (this->mPtrSnake->getDirection() == Direction::Up || this->mPtrSnake->getDirection() == Direction::Down)
+            {
                 this->mPtrSnake->changeDirection(Direction::Right);
+                this->mEvents.emit(GameEventType::DirectionChanged, static_cast<int>(Direction::Right));
+            }
             break;
         }
         default:
@@ -332,17 +827,18 @@ void Game::controlSnake() const
 //ˢ´ 
 void Game::renderBoards() const
 {
+    TraceSpan span(TraceEvent::RenderBoards, this->mTick);
     for (int i = 0; i < this->mWindows.size(); i ++)
     {
-        werase(this->mWindows[i]);
+        this->mRenderer->eraseWindow(this->mWindows[i]);
     }
     this->renderInformationBoard();
     this->renderGameBoard();
     this->renderInstructionBoard();
     for (int i = 0; i < this->mWindows.size(); i ++)
     {
-        box(this->mWindows[i], 0, 0);
-        wrefresh(this->mWindows[i]);
+        this->mRenderer->drawBox(this->mWindows[i]);
+        this->mRenderer->stageWindow(this->mWindows[i]);
     }
     this->renderLeaderBoard();
 }
@@ -350,76 +846,280 @@ void Game::renderBoards() const
 //ıϷѶȣÿ5Ѷ+15ʱϷ
 void Game::adjustDelay()
 {
-    this->mDifficulty = this->mPoints / 5;
-    if (mPoints % 5 == 0)
+    int difficulty = this->mPoints / 5;
+    this->mDelay = this->mSpeed.getDelay(difficulty);
+    if (difficulty != this->mDifficulty)
     {
-        this->mDelay = this->mBaseDelay * pow(0.75, this->mDifficulty);
+        this->mDifficulty = difficulty;
+        this->mEvents.emit(GameEventType::DifficultyChanged, difficulty);
     }
 }
 
+// Worked out into a table here, once, not on every tick
+void Game::setSpeedCurve(const SpeedCurve& curve)
+{
+    this->mSpeed = SpeedSchedule(curve);
+}
+
+// Takes effect with the next game
+void Game::setFoodRules(const FoodRules& rules)
+{
+    this->mFoodRules.count = std::max(rules.count, 1);
+    this->mFoodRules.maxValue = std::max(rules.maxValue, 1);
+    this->mFoodRules.lifetime = std::max(rules.lifetime, 0);
+}
+
 //Ϸ
 void Game::runGame()
 {
-    bool moveSuccess;
-    int key;
-    while (true)
+    // Only the assert reads these, a release build leaves it out
+    [[maybe_unused]] long long ticks = 0;
+    long long allocations = countHeapAllocations();
+    [[maybe_unused]] int resizes = this->mResizeStats.resizes;
+    while (this->playCountedTick())
     {
-        /* TODO
-        * this is the main control loop of the game.
-        * it keeps running a while loop, and does the following things:
-        * 	1. process your keyboard input
-        * 	2. clear the window
-        * 	3. move the current snake forward
-        * 	4. check if the snake has eaten the food after movement
-        * 	5. check if the snake dies after the movement
-        * 	6. make corresponding steps for the ``if conditions'' in 3 and 4.
-        *   7. render the position of the food and snake in the new frame of window.
-        *   8. update other game states and refresh the window
-        */
-        //Ӽ̶뷽
-        this->controlSnake();
-
-        //ĿǰѶߵƶ
-        this->adjustDelay();
+        traceBegin(TraceEvent::Sleep, this->mTick);
+        std::this_thread::sleep_for(std::chrono::milliseconds(this->mDelay));
+        traceEnd(TraceEvent::Sleep, this->mTick);
 
-        //ƶ
-        //ײǽҧԼ Ϸ
-        if (this->mPtrSnake->checkCollision()) break;
+        // Once warmed up a tick must not touch the heap, checked in the snakegame-alloc build.
+        // A resize makes windows again, so that tick may.
+        long long tickAllocations = countHeapAllocations() - allocations;
+        allocations += tickAllocations;
+        assert(ticks < AllocationWarmupTicks || tickAllocations == 0 || this->mResizeStats.resizes != resizes);
+        ticks ++;
+        resizes = this->mResizeStats.resizes;
+    }
+}
 
-        //ǰƶ
-        //δԵʳ
-        else if (!this->mPtrSnake->touchFood()) this->mPtrSnake->getSnake().pop_back();
-        //Եʳ ٴʳҷ+1
-        else {
-            this->createRamdonFood();
-            this->mPoints++;
+std::vector<int> Game::playHeadless(int games)
+{
+    this->mAutopilot = true;
+    std::vector<int> points;
+    for (int i = 0; i < games; i ++)
+    {
+        this->initializeGame();
+        for (long long tick = 0; tick < MaxHeadlessTicks; tick ++)
+        {
+            // The same rule as runGame, counted instead of asserted so --headless can fail on it
+            long long allocations = countHeapAllocations();
+            bool alive = this->playCountedTick();
+            if (tick >= AllocationWarmupTicks)
+            {
+                this->mTickAllocations += countHeapAllocations() - allocations;
+            }
+            if (!alive)
+            {
+                break;
+            }
         }
+        this->recordGame();
+        points.push_back(this->mPoints);
+    }
+    this->mAutopilot = false;
+    return points;
+}
 
-        //ӡߡʳѶ
-        this->renderSnake();
-        this->renderFood();
-        this->adjustDelay();
-        this->renderDifficulty();
-        this->renderPoints();
+// playTick with the time it took counted
+bool Game::playCountedTick()
+{
+    // playTick counts the tick it plays
+    TraceSpan span(TraceEvent::Tick, this->mTick + 1);
+    long long start = steadyNanoseconds();
+    bool alive = this->playTick();
+    this->mStats->countTick(steadyNanoseconds() - start);
+    return alive;
+}
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(this->mDelay));
+// The game that ended into the totals, and out to the stats file if there is one
+void Game::recordGame()
+{
+    this->mStats->endSession();
+    if (!this->mStatsFilePath.empty())
+    {
+        writeStatsFile(this->mStatsFilePath);
+    }
+}
+
+// Heads for the nearest food: straight on unless a turn gets closer or the way ahead is blocked
+int Game::autopilotKey() const
+{
+    const int keys[4] = {'w', 's', 'a', 'd'};
+    SnakeBody head = this->mPtrSnake->getSnake()[0];
+    int ahead = static_cast<int>(this->mPtrSnake->getDirection());
+    SnakeBody food;
+    bool hasFood = this->mFoods.findNearest(head, food);
+    int best = -1;
+    int bestDistance = 0;
+    for (int i = 0; i < 4; i ++)
+    {
+        // Straight on is tried first so it wins a tie, turning back is no move at all
+        int direction = (ahead + i) % 4;
+        SnakeBody cell = stepCell(head, static_cast<Direction>(direction));
+        if (this->mWrap)
+        {
+            cell = wrapCell(cell, this->mWorldWidth, this->mWorldHeight);
+        }
+        if (direction == (ahead ^ 1) || this->isBlocked(cell))
+        {
+            continue;
+        }
+        int distance = hasFood ? std::abs(food.getX() - cell.getX()) + std::abs(food.getY() - cell.getY()) : 0;
+        if (best == -1 || distance < bestDistance)
+        {
+            best = direction;
+            bestDistance = distance;
+        }
+    }
+    return best == -1 || best == ahead ? -1 : keys[best];
+}
+
+// The outer wall, an obstacle or the snake
+bool Game::isBlocked(SnakeBody cell) const
+{
+    int x = cell.getX();
+    int y = cell.getY();
+    if (x < 1 || y < 1 || x > this->mWorldWidth - 2 || y > this->mWorldHeight - 2 || (this->mLevel.isLoaded() && this->mLevel.isWall(x, y)))
+    {
+        return true;
+    }
+    return this->mLargeWorld ? this->mOccupancy.test(x, y) : this->mPtrSnake->isPartOfSnake(x, y);
+}
+
+// The length asked for, shorter if the body trailing below the start would run into a wall
+int Game::getStartLength() const
+{
+    SnakeBody start = this->mLevel.isLoaded() ? this->mLevel.getStart() : SnakeBody(this->mWorldWidth / 2, this->mWorldHeight / 2);
+    int length = 1;
+    while (length < this->mInitialSnakeLength && start.getY() + length < this->mWorldHeight - 1
+        && !(this->mLevel.isLoaded() && this->mLevel.isWall(start.getX(), start.getY() + length)))
+    {
+        length ++;
+    }
+    return length;
+}
+
+// One step of the game and its frame, false once the snake is dead
+bool Game::playTick()
+{
+    /* TODO
+    * this is the main control loop of the game.
+    * it keeps running a while loop, and does the following things:
+    * 	1. process your keyboard input
+    * 	2. clear the window
+    * 	3. move the current snake forward
+    * 	4. check if the snake has eaten the food after movement
+    * 	5. check if the snake dies after the movement
+    * 	6. make corresponding steps for the ``if conditions'' in 3 and 4.
+    *   7. render the position of the food and snake in the new frame of window.
+    *   8. update other game states and refresh the window
+    */
+    this->mTick ++;
+    //Ӽ̶뷽
+    this->controlSnake();
+    // startGame saves it
+    if (this->mSaveRequested)
+    {
+        return false;
+    }
+    // The board doesn't fit the terminal, wait for it to grow again
+    if (this->mPaused)
+    {
+        this->renderBoards();
+        this->renderPaused();
+        this->mEvents.dispatch();
+        this->presentFrame();
+        this->mRedrawAll = true;
+        return true;
+    }
+    this->mFoodTick ++;
+
+    //ƶ
+    //ײǽҧԼ Ϸ
+    if (this->checkCollision())
+    {
+        SnakeBody head = this->mPtrSnake->nextHead();
+        this->mEvents.emit(GameEventType::SnakeDied, this->mPoints, head.getX(), head.getY());
+        this->mEvents.dispatch();
+        return false;
+    }
+
+    //ǰƶ
+    SnakeBody head = this->mPtrSnake->createNewHead();
+    int value = this->mFoods.take(head);
+    if (this->mLargeWorld)
+    {
+        // The new head joins the packed body, the Snake keeps only it. It goes
+        // in before the tail comes out, so a snake of one has a tail to give up.
+        SnakeBodies& snake = this->mPtrSnake->getSnake();
+        this->mBody.pushHead(snake[0]);
+        this->mOccupancy.set(snake[0].getX(), snake[0].getY());
+        snake.pop_back();
+    }
+    //δԵʳ
+    if (value == 0)
+    {
+        this->removeTail();
+    }
+    if (value > 0)
+    {
+        this->mEvents.emit(GameEventType::FoodEaten, value, head.getX(), head.getY());
+        this->mPoints += value;
+        this->mEvents.emit(GameEventType::ScoreChanged, this->mPoints);
+    }
+    // Food whose time is up goes, then the board is topped up again
+    this->mFoods.expire(this->mFoodTick);
+    this->refillFood();
+    this->updateCamera();
+
+    // The game board is drawn again every tick, the panels only when an event changes them
+    if (this->mRedrawAll)
+    {
         this->renderBoards();
-        refresh();
+        this->renderDifficulty();
+        this->renderPoints();
+        this->mRedrawAll = false;
     }
+    else
+    {
+        this->mRenderer->eraseWindow(this->mWindows[1]);
+        this->mRenderer->drawBox(this->mWindows[1]);
+    }
+    //ӡߡʳѶ
+    this->renderSnake();
+    this->renderFood();
+    this->mEvents.dispatch();
+    if (this->mPublisher)
+    {
+        this->publishFrame();
+    }
+
+    this->presentFrame();
+    return true;
 }
 
 //ʼϷ
 void Game::startGame()
 {
-    refresh();
     bool choice;
     while (true)
     {
         this->readLeaderBoard(); //ȡʷ
         this->renderBoards(); //
-        this->initializeGame(); //ʼϷ
+        // A loaded game is already set up
+        if (!this->mResumed)
+        {
+            this->initializeGame(); //ʼϷ
+        }
+        this->mResumed = false;
         this->runGame(); //Ϸ
-        this->updateLeaderBoard(); //ʷ
+        if (this->mSaveRequested)
+        {
+            this->mSaveRequested = false;
+            this->saveGame(this->mSaveFilePath);
+            break;
+        }
+        this->recordGame();
         this->writeLeaderBoard(); //дʷ
         choice = this->renderRestartMenu(); //ѯǷϷ
         if (choice == false)
@@ -433,19 +1133,16 @@ void Game::startGame()
 // https://en.cppreference.com/w/cpp/io/basic_fstream
 bool Game::readLeaderBoard()
 {
+    TraceSpan span(TraceEvent::ReadLeaderBoard, this->mTick);
     std::fstream fhand(this->mRecordBoardFilePath, fhand.binary | fhand.in);
     if (!fhand.is_open())
     {
         return false;
     }
-    int temp;
-    int i = 0;
-    while ((!fhand.eof()) && (i < mNumLeaders))
-    {
-        fhand.read(reinterpret_cast<char*>(&temp), sizeof(temp));
-        this->mLeaderBoard[i] = temp;
-        i ++;
-    }
+    // A file cut short fills in the scores it has, the rest stay as they were
+    std::vector<char> data(sizeof(int) * this->mNumLeaders);
+    fhand.read(data.data(), data.size());
+    decodeLeaderBoard(data.data(), fhand.gcount(), this->mLeaderBoard);
     fhand.close();
     return true;
 }
@@ -472,6 +1169,7 @@ bool Game::updateLeaderBoard()
 //¼ʷнĳļ
 bool Game::writeLeaderBoard()
 {
+    TraceSpan span(TraceEvent::WriteLeaderBoard, this->mTick);
     //trunc: clear the data file
     std::fstream fhand(this->mRecordBoardFilePath, fhand.binary | fhand.trunc | fhand.out);
     if (!fhand.is_open())
@@ -486,10 +1184,515 @@ bool Game::writeLeaderBoard()
     return true;
 }
 
+// A bigger world than the screen. Coordinates are capped by what SnakeBody can hold.
+void Game::setWorldSize(int width, int height)
+{
+    // The callers check the size, see parseSize and Level::parse
+    assert(width >= 3 && height >= 3 && width <= MaxBoardSize && height <= MaxBoardSize);
+    this->mWorldWidth = width;
+    this->mWorldHeight = height;
+    this->mLargeWorld = true;
+    this->mBody = PackedBody(LargeWorldReservedLength);
+    this->mOccupancy.reserve(LargeWorldReservedTiles);
+    this->createGameMemory();
+}
 
+void Game::setLevel(const Level& level)
+{
+    this->mLevel = level;
+    this->setWorldSize(level.getWidth(), level.getHeight());
+}
 
+void Game::setWrap(bool wrap)
+{
+    this->mWrap = wrap;
+}
 
+// Same seed, same food, for replaying a game
+void Game::setSeed(unsigned int seed)
+{
+    this->mRandom.seed(seed);
+}
+
+// Memory for the snake: the whole board up front, so a game never allocates.
+// A big world can't do that, its Snake only holds the head and the new one,
+// the packed body reserves some and grows on the heap.
+void Game::createGameMemory()
+{
+    this->mPtrSnake.reset();
+    std::pmr::memory_resource* upstream = std::pmr::null_memory_resource();
+    this->mReservedLength = std::max(this->mWorldWidth * this->mWorldHeight, 1);
+    if (this->mLargeWorld)
+    {
+        upstream = std::pmr::new_delete_resource();
+        this->mReservedLength = this->mInitialSnakeLength + 1;
+    }
+    this->mGameMemory.reset(new MemoryArena(sizeof(Snake) + this->mReservedLength * sizeof(SnakeBody) + 256, upstream));
+}
 
+// Keep the head in the middle of the view, a world that fits the board stays put.
+// A wrapping world has no edge to stop at, the view goes over it to the other side.
+void Game::updateCamera()
+{
+    int viewWidth = this->mGameBoardWidth - 2;
+    int viewHeight = this->mGameBoardHeight - 2;
+    SnakeBody head = this->mPtrSnake->getSnake()[0];
+    this->mCameraX = 1;
+    this->mCameraY = 1;
+    if (this->mWorldWidth - 2 > viewWidth && this->mWrap)
+    {
+        this->mCameraX = wrapCell(SnakeBody(head.getX() - viewWidth / 2, 1), this->mWorldWidth, this->mWorldHeight).getX();
+    }
+    else if (this->mWorldWidth - 2 > viewWidth)
+    {
+        this->mCameraX = std::max(0, std::min(head.getX() - viewWidth / 2, this->mWorldWidth - viewWidth));
+    }
+    if (this->mWorldHeight - 2 > viewHeight && this->mWrap)
+    {
+        this->mCameraY = wrapCell(SnakeBody(1, head.getY() - viewHeight / 2), this->mWorldWidth, this->mWorldHeight).getY();
+    }
+    else if (this->mWorldHeight - 2 > viewHeight)
+    {
+        this->mCameraY = std::max(0, std::min(head.getY() - viewHeight / 2, this->mWorldHeight - viewHeight));
+    }
+}
 
+// The edges of a big world and the level's obstacles, where they are in view
+void Game::renderWalls() const
+{
+    ViewSpan across[2];
+    ViewSpan down[2];
+    int numAcross = viewSpans(this->mCameraX, this->mGameBoardWidth - 2, this->mWorldWidth, this->mWrap, across);
+    int numDown = viewSpans(this->mCameraY, this->mGameBoardHeight - 2, this->mWorldHeight, this->mWrap, down);
+    for (int i = 0; i < numDown; i ++)
+    {
+        for (int j = 0; j < numAcross; j ++)
+        {
+            for (int worldY = down[i].from; worldY < down[i].to; worldY ++)
+            {
+                for (int worldX = across[j].from; worldX < across[j].to; worldX ++)
+                {
+                    bool obstacle = this->mLevel.isLoaded() && worldX < this->mWorldWidth && worldY < this->mWorldHeight && this->mLevel.isWall(worldX, worldY);
+                    if (obstacle || worldX == 0 || worldY == 0 || worldX == this->mWorldWidth - 1 || worldY == this->mWorldHeight - 1)
+                    {
+                        this->mRenderer->drawChar(this->mWindows[1], worldX + across[j].shift, worldY + down[i].shift, this->mWallSymbol);
+                    }
+                }
+            }
+        }
+    }
+}
 
+// Snake::checkCollision, except a big world looks the next head up in the tiles
+// and in the level's walls
+bool Game::checkCollision() const
+{
+    if (!this->mLargeWorld)
+    {
+        return this->mPtrSnake->checkCollision();
+    }
+    SnakeBody head = this->mPtrSnake->nextHead();
+    return this->mPtrSnake->hitWall() || this->mOccupancy.test(head.getX(), head.getY()) || (this->mLevel.isLoaded() && this->mLevel.isWall(head.getX(), head.getY()));
+}
 
+// The snake moved without eating
+void Game::removeTail()
+{
+    if (this->mLargeWorld)
+    {
+        SnakeBody tail = this->mBody.popTail();
+        this->mOccupancy.clear(tail.getX(), tail.getY());
+        return;
+    }
+    this->mPtrSnake->getSnake().pop_back();
+}
+
+// A big world's body, head first, into mBody and the occupancy tiles
+void Game::packBody(const SnakeBodies& snake)
+{
+    this->mOccupancy.reset();
+    this->mBody.setWrap(this->mWrap ? this->mWorldWidth : 0, this->mWrap ? this->mWorldHeight : 0);
+    this->mBody.reset(snake.back());
+    this->mOccupancy.set(snake.back().getX(), snake.back().getY());
+    for (int i = snake.size() - 2; i >= 0; i --)
+    {
+        this->mBody.pushHead(snake[i]);
+        this->mOccupancy.set(snake[i].getX(), snake[i].getY());
+    }
+}
+
+// Draw the part of a shared arena around our own snake,
+// using the predicted body for it when there is one
+void Game::renderArena(const Arena& arena, int slot, const SnakeBodies& ownSnake) const
+{
+    int viewWidth = this->mGameBoardWidth - 2;
+    int viewHeight = this->mGameBoardHeight - 2;
+    // World cell (cameraX, cameraY) lands on the first cell inside the box
+    int cameraX = 1;
+    int cameraY = 1;
+    if (!ownSnake.empty())
+    {
+        SnakeBody head = ownSnake[0];
+        if (arena.getWidth() - 2 > viewWidth)
+        {
+            cameraX = std::max(0, std::min(head.getX() - viewWidth / 2, arena.getWidth() - viewWidth));
+        }
+        if (arena.getHeight() - 2 > viewHeight)
+        {
+            cameraY = std::max(0, std::min(head.getY() - viewHeight / 2, arena.getHeight() - viewHeight));
+        }
+    }
+
+    this->mRenderer->eraseWindow(this->mWindows[1]);
+    this->mRenderer->drawBox(this->mWindows[1]);
+    const SnakeBodies& foods = arena.getFoods();
+    for (int i = 0; i < foods.size(); i ++)
+    {
+        int x = foods[i].getX() - cameraX;
+        int y = foods[i].getY() - cameraY;
+        if (x >= 0 && x < viewWidth && y >= 0 && y < viewHeight)
+        {
+            this->mRenderer->drawChar(this->mWindows[1], x + 1, y + 1, this->mFoodSymbol);
+        }
+    }
+    for (int other = 0; other <= arena.getNumSlots(); other ++)
+    {
+        const SnakeBodies* body = &ownSnake;
+        char symbol = this->mSnakeSymbol;
+        if (other < arena.getNumSlots())
+        {
+            if (other == slot || !arena.isActive(other))
+            {
+                continue;
+            }
+            body = &arena.getSnake(other).getSnake();
+            symbol = this->mOtherSnakeSymbol;
+        }
+        for (int i = 0; i < body->size(); i ++)
+        {
+            int x = (*body)[i].getX() - cameraX;
+            int y = (*body)[i].getY() - cameraY;
+            if (x >= 0 && x < viewWidth && y >= 0 && y < viewHeight)
+            {
+                this->mRenderer->drawChar(this->mWindows[1], x + 1, y + 1, symbol);
+            }
+        }
+    }
+    this->mRenderer->stageWindow(this->mWindows[1]);
+}
+
+// Send everything drawn since the last frame to the terminal in one write
+void Game::presentFrame()
+{
+    TraceSpan span(TraceEvent::PresentFrame, this->mTick);
+    this->mRenderer->present();
+    if (this->mResizeStart != 0)
+    {
+        long long elapsed = steadyNanoseconds() - this->mResizeStart;
+        this->mResizeStats.resizes ++;
+        this->mResizeStats.totalNanoseconds += elapsed;
+        this->mResizeStats.maxNanoseconds = std::max(this->mResizeStats.maxNanoseconds, elapsed);
+        this->mResizeStart = 0;
+    }
+}
+
+// Play on a shared board hosted by an ArenaServer.
+// Our own snake is predicted ahead of the server, P switches that off
+// to compare, Q leaves the game.
+bool Game::startRemoteGame(const std::string& host, int port)
+{
+    int fd = connectTcp(host, port);
+    if (fd < 0)
+    {
+        return false;
+    }
+    this->renderBoards();
+
+    std::unique_ptr<Arena> arena;
+    std::unique_ptr<Predictor> predictor;
+    bool predicting = true;
+    int slot = -1;
+    this->mPoints = 0;
+    std::vector<unsigned char> buffer;
+    unsigned char chunk[65536];
+    long long lastStatus = 0;
+    bool connected = true;
+    while (connected)
+    {
+        long long now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        int key = this->mRenderer->readKey();
+        int turn = -1;
+        switch(key)
+        {
+            case 'W':
+            case 'w':
+            case KeyUp:
+                turn = static_cast<int>(Direction::Up);
+                break;
+            case 'S':
+            case 's':
+            case KeyDown:
+                turn = static_cast<int>(Direction::Down);
+                break;
+            case 'A':
+            case 'a':
+            case KeyLeft:
+                turn = static_cast<int>(Direction::Left);
+                break;
+            case 'D':
+            case 'd':
+            case KeyRight:
+                turn = static_cast<int>(Direction::Right);
+                break;
+            case 'P':
+            case 'p':
+                predicting = !predicting;
+                break;
+            case 'Q':
+            case 'q':
+                connected = false;
+                break;
+            case KeyResize:
+                // Everything is drawn again below, the status line too
+                this->handleResize();
+                this->renderBoards();
+                lastStatus = 0;
+                break;
+        }
+        if (turn >= 0 && predictor)
+        {
+            unsigned char message[InputMessageSize];
+            encodeInput(message, static_cast<Direction>(turn), predictor->addTurn(static_cast<Direction>(turn), now));
+            send(fd, message, sizeof(message), MSG_NOSIGNAL);
+        }
+
+        bool changed = false;
+        pollfd waiting = {fd, POLLIN, 0};
+        if (poll(&waiting, 1, 5) > 0)
+        {
+            ssize_t received;
+            while ((received = recv(fd, chunk, sizeof(chunk), 0)) > 0)
+            {
+                buffer.insert(buffer.end(), chunk, chunk + received);
+            }
+            if (received == 0)
+            {
+                connected = false;
+            }
+
+            size_t offset = 0;
+            while (true)
+            {
+                MessageType type;
+                const unsigned char* payload;
+                size_t payloadSize;
+                int frameSize = readFrame(buffer.data() + offset, buffer.size() - offset, type, payload, payloadSize);
+                if (frameSize < 0)
+                {
+                    connected = false;
+                }
+                if (frameSize <= 0)
+                {
+                    break;
+                }
+                offset += frameSize;
+                int width, height, ticksPerSecond;
+                uint32_t tick;
+                uint16_t sequence;
+                if (type == MessageType::Welcome && decodeWelcome(payload, payloadSize, slot, width, height, ticksPerSecond))
+                {
+                    arena.reset(new Arena(width, height, this->mInitialSnakeLength, 0));
+                    predictor.reset(new Predictor(ticksPerSecond));
+                }
+                else if (type == MessageType::Keyframe && arena)
+                {
+                    changed = decodeKeyframe(payload, payloadSize, *arena) || changed;
+                }
+                else if (type == MessageType::Tick && arena)
+                {
+                    changed = decodeTick(payload, payloadSize, *arena) || changed;
+                }
+                else if (type == MessageType::Ack && predictor && decodeAck(payload, payloadSize, tick, sequence))
+                {
+                    predictor->onAck(*arena, slot, tick, sequence, now);
+                }
+            }
+            buffer.erase(buffer.begin(), buffer.begin() + offset);
+        }
+        if (!arena)
+        {
+            continue;
+        }
+
+        changed = predictor->predict(*arena, slot, now) || changed || key == KeyResize;
+        if (changed)
+        {
+            static const SnakeBodies gone;
+            const SnakeBodies& own = !arena->isActive(slot) ? gone : predicting ? predictor->getSnake() : arena->getSnake(slot).getSnake();
+            this->renderArena(*arena, slot, own);
+            int points = arena->isActive(slot) ? arena->getPoints(slot) : 0;
+            if (points != this->mPoints)
+            {
+                // Redraw the panel so a shorter score doesn't leave digits behind
+                this->mPoints = points;
+                this->mRenderer->eraseWindow(this->mWindows[2]);
+                this->mRenderer->drawBox(this->mWindows[2]);
+                this->renderInstructionBoard();
+            }
+            this->renderPoints();
+        }
+        if (now - lastStatus > 500000)
+        {
+            lastStatus = now;
+            char message[128];
+            std::snprintf(message, sizeof(message), "Turn latency %.0f ms (server %.0f ms), %d ticks ahead, prediction %s [P]",
+                          predicting ? predictor->getPredictedLatency() : predictor->getServerLatency(),
+                          predictor->getServerLatency(), predictor->getLeadTicks(), predicting ? "on" : "off");
+            // Padded to the edge so a shorter message doesn't leave characters behind
+            char status[512];
+            std::snprintf(status, sizeof(status), "%-*.*s", this->mScreenWidth - 2, this->mScreenWidth - 2, message);
+            this->mRenderer->drawText(this->mWindows[0], 1, 2, status);
+            this->mRenderer->stageWindow(this->mWindows[0]);
+        }
+        this->presentFrame();
+    }
+    closeSocket(fd);
+    return true;
+}
+
+// Publish every frame of this game for snakeview
+bool Game::enableBroadcast(const std::string& name)
+{
+    this->mPublisher.reset(new FramePublisher());
+    if (!this->mPublisher->open(name, this->mGameBoardWidth, this->mGameBoardHeight))
+    {
+        this->mPublisher.reset();
+        return false;
+    }
+    return true;
+}
+
+// Spectators are shown the board the way the player sees it, a big world
+// as the view around the camera, and one food, the one nearest the head
+void Game::publishFrame()
+{
+    SnakeBody food;
+    bool hasFood = this->mFoods.findNearest(this->mPtrSnake->getSnake()[0], food);
+    if (!this->mLargeWorld)
+    {
+        this->mPublisher->publish(this->mPtrSnake->getSnake(), hasFood ? food : SnakeBody(), this->mPoints, this->mDifficulty);
+        return;
+    }
+    ViewSpan across[2];
+    ViewSpan down[2];
+    int numAcross = viewSpans(this->mCameraX, this->mGameBoardWidth - 2, this->mWorldWidth, this->mWrap, across);
+    int numDown = viewSpans(this->mCameraY, this->mGameBoardHeight - 2, this->mWorldHeight, this->mWrap, down);
+    SnakeBody shownFood;
+    for (int i = 0; i < numDown && hasFood; i ++)
+    {
+        for (int j = 0; j < numAcross; j ++)
+        {
+            const ViewSpan& x = across[j];
+            const ViewSpan& y = down[i];
+            if (food.getX() >= x.from && food.getX() < x.to && food.getY() >= y.from && food.getY() < y.to)
+            {
+                shownFood = SnakeBody(food.getX() + x.shift, food.getY() + y.shift);
+            }
+        }
+    }
+    this->mPublisher->beginFrame(shownFood, this->mPoints, this->mDifficulty);
+    for (int i = 0; i < numDown; i ++)
+    {
+        for (int j = 0; j < numAcross; j ++)
+        {
+            const ViewSpan& x = across[j];
+            const ViewSpan& y = down[i];
+            this->mOccupancy.forEachIn(x.from, y.from, x.to, y.to, [this, &x, &y](int cellX, int cellY)
+            {
+                this->mPublisher->addCell(SnakeBody(cellX + x.shift, cellY + y.shift));
+            });
+        }
+    }
+    this->mPublisher->endFrame();
+}
+
+// Show a frame of someone else's game, clipped to our own board
+void Game::renderSpectatorFrame(const SpectatorFrame& frame)
+{
+    this->mRenderer->eraseWindow(this->mWindows[1]);
+    this->mRenderer->drawBox(this->mWindows[1]);
+    if (frame.food.getX() > 0 && frame.food.getY() > 0 && frame.food.getX() < this->mGameBoardWidth - 1 && frame.food.getY() < this->mGameBoardHeight - 1)
+    {
+        this->mRenderer->drawChar(this->mWindows[1], frame.food.getX(), frame.food.getY(), this->mFoodSymbol);
+    }
+    for (int i = 0; i < frame.snake.size(); i ++)
+    {
+        if (frame.snake[i].getX() < this->mGameBoardWidth - 1 && frame.snake[i].getY() < this->mGameBoardHeight - 1)
+        {
+            this->mRenderer->drawChar(this->mWindows[1], frame.snake[i].getX(), frame.snake[i].getY(), this->mSnakeSymbol);
+        }
+    }
+    this->mRenderer->stageWindow(this->mWindows[1]);
+
+    if (frame.points != this->mPoints || frame.difficulty != this->mDifficulty)
+    {
+        // Redraw the panel so a shorter number doesn't leave digits behind
+        this->mPoints = frame.points;
+        this->mDifficulty = frame.difficulty;
+        this->mRenderer->eraseWindow(this->mWindows[2]);
+        this->mRenderer->drawBox(this->mWindows[2]);
+        this->renderInstructionBoard();
+    }
+    this->renderPoints();
+    this->renderDifficulty();
+}
+
+// Follow a broadcast game until the player quits, Q stops watching
+void Game::watchBroadcast(const std::string& name)
+{
+    this->renderBoards();
+    this->mPoints = 0;
+    this->mDifficulty = 0;
+
+    FrameSubscriber subscriber;
+    SpectatorFrame frame;
+    bool attached = false;
+    bool shown = false;
+    while (true)
+    {
+        int key = this->mRenderer->readKey();
+        if (key == 'q' || key == 'Q')
+        {
+            break;
+        }
+        if (key == KeyResize)
+        {
+            this->handleResize();
+            this->renderBoards();
+            if (shown)
+            {
+                this->renderSpectatorFrame(frame);
+            }
+            this->presentFrame();
+        }
+        if (!attached)
+        {
+            attached = subscriber.attach(name);
+        }
+        else if (subscriber.readLatest(frame))
+        {
+            this->renderSpectatorFrame(frame);
+            this->presentFrame();
+            shown = true;
+        }
+        else if (subscriber.isReplaced())
+        {
+            attached = subscriber.attach(name);
+        }
+        else if (subscriber.isClosed())
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(attached ? 10 : 200));
+    }
+}
@@ -1,18 +1,43 @@
 #ifndef GAME_H
 #define GAME_H
 
-#include "curses.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <random>
+#include <fstream>
 
 #include "snake.h"
+#include "arena.h"
+#include "spectate.h"
+#include "memory.h"
+#include "tiles.h"
+#include "packedbody.h"
+#include "food.h"
+#include "level.h"
+#include "renderer.h"
+#include "speed.h"
+#include "events.h"
+#include "snapshot.h"
+#include "config.h"
+#include "stats.h"
+#include "trace.h"
 
+// Terminal resizes and how long each took to put the new layout on screen
+struct ResizeStats
+{
+    int resizes = 0;
+    long long totalNanoseconds = 0;
+    long long maxNanoseconds = 0;
+};
 
 class Game
 {
 public:
     Game();
+    explicit Game(std::unique_ptr<Renderer> renderer);
+    // Set up the way config says, see config.h
+    Game(std::unique_ptr<Renderer> renderer, const GameConfig& config);
     ~Game();
 
 		void createInformationBoard();
@@ -24,6 +49,30 @@ public:
 		void createInstructionBoard();
     void renderInstructionBoard() const;
 
+    void createRestartMenu();
+    void drawRestartMenu(int index) const;
+
+    // Fit the windows to the terminal. Only windows that moved are made again.
+    void fitGameBoard();
+    void layoutWindows();
+    void handleResize();
+    void renderPaused() const;
+    ResizeStats getResizeStats() const;
+
+    // Play in a world bigger than the screen, the view follows the head
+    void setWorldSize(int width, int height);
+    // Play on a level's world, with its obstacles, see level.h
+    void setLevel(const Level& level);
+    // No walls, the snake goes off one edge and comes back in at the other
+    void setWrap(bool wrap);
+    void setSeed(unsigned int seed);
+    void createGameMemory();
+    void updateCamera();
+    void renderWalls() const;
+    bool checkCollision() const;
+    void removeTail();
+    void packBody(const SnakeBodies& snake);
+
 		void loadLeadBoard();
     void updateLeadBoard();
     bool readLeaderBoard();
@@ -35,17 +84,47 @@ public:
 
 		void initializeGame();
     void runGame();
+    bool playTick();
     void renderPoints() const;
     void renderDifficulty() const;
 
-		void createRamdonFood();
+		bool createRamdonFood();
+    void refillFood();
     void renderFood() const;
     void renderSnake() const;
-    void controlSnake() const;
+    void controlSnake();
 
 		void startGame();
-    bool renderRestartMenu() const;
+    bool renderRestartMenu();
     void adjustDelay();
+    void setSpeedCurve(const SpeedCurve& curve);
+    void setFoodRules(const FoodRules& rules);
+    // Q during a game saves it and quits, --resume goes on with it
+    bool saveGame(const std::string& path) const;
+    bool loadGame(const std::string& path);
+    // The same from a save file already read, see fuzz.h
+    bool loadGame(const unsigned char* data, size_t size);
+    bool resumeGame();
+    // Every event from now on, a line each: tick, event, value, x, y
+    bool enableEventLog(const std::string& path);
+    long long getNumEvents(GameEventType type) const;
+    // Games played by the autopilot without a delay, the points of each
+    std::vector<int> playHeadless(int games);
+    // Heap allocations the headless ticks made after warm-up, only counted in
+    // the snakegame-alloc build and 0 anywhere else
+    long long getTickAllocations() const;
+    // The render functions only stage their windows, this puts them on screen
+    void presentFrame();
+
+    // Multiplayer client for an ArenaServer
+    bool startRemoteGame(const std::string& host, int port);
+    void renderArena(const Arena& arena, int slot, const SnakeBodies& ownSnake) const;
+
+    // Live broadcast to local viewers, see FramePublisher
+    bool enableBroadcast(const std::string& name);
+    void publishFrame();
+    void watchBroadcast(const std::string& name);
+    void renderSpectatorFrame(const SpectatorFrame& frame);
 
 
 private:
@@ -56,23 +135,82 @@ private:
     int mScreenHeight;
     int mGameBoardWidth;
     int mGameBoardHeight;
+    // Set by the config, 0 lets the board take all of the terminal
+    const int mMaxBoardWidth;
+    const int mMaxBoardHeight;
+    // The world is the board unless setWorldSize made it bigger.
+    // World cell (mCameraX, mCameraY) is drawn on the first cell inside the box.
+    int mWorldWidth;
+    int mWorldHeight;
+    bool mLargeWorld = false;
+    bool mWrap = false;
+    int mCameraX = 1;
+    int mCameraY = 1;
+    // Snake cells of a big world, where scanning the body would be too slow
+    TileMap mOccupancy;
+    // Obstacles of a world set up by setLevel, empty if there are none
+    Level mLevel;
+    // The body of a big world's snake, the Snake itself only keeps the head
+    PackedBody mBody;
+    const char mWallSymbol = '+';
     const int mInformationHeight = 6;
     const int mInstructionWidth = 18;
-    std::vector<WINDOW *> mWindows;
+    std::unique_ptr<Renderer> mRenderer;
+    std::vector<int> mWindows;
+    int mMenuWindow;
+    // The terminal is too small for the board, the game waits until it grows
+    bool mPaused = false;
+    // The panels are drawn again on the next tick, not just the game board
+    bool mRedrawAll = false;
+    // When the last resize came in, until its frame is out
+    long long mResizeStart = 0;
+    ResizeStats mResizeStats;
     // Snake information
-    const int mInitialSnakeLength = 2;
+    const int mInitialSnakeLength;
     const char mSnakeSymbol = '@';
-    std::unique_ptr<Snake> mPtrSnake; //ָsnakeָ
+    const char mOtherSnakeSymbol = 'o';
+    std::unique_ptr<FramePublisher> mPublisher;
+    // Per game state, the snake lives in here and goes away on restart
+    std::unique_ptr<MemoryArena> mGameMemory;
+    int mReservedLength;
+    std::unique_ptr<Snake, ArenaDelete> mPtrSnake; //ָsnakeָ
     // Food information
-    SnakeBody mFood;
+    FoodField mFoods;
+    FoodRules mFoodRules;
+    std::mt19937 mRandom;
     const char mFoodSymbol = '#';
     int mPoints = 0;
     int mDifficulty = 0;
-    int mBaseDelay = 100;
+    // Delay for each difficulty, looked up when the points change
+    SpeedSchedule mSpeed;
+    // Filled by playTick, emptied at the end of it, see subscribeEvents
+    EventBus mEvents;
+    void subscribeEvents();
+    long long mTick = 0;
+    // Ticks played, paused ones left out: food lasts this many
+    long long mFoodTick = 0;
+    long long mEventCounts[NumGameEventTypes] = {};
+    std::unique_ptr<std::ofstream> mEventLog;
+    // The counters of the thread that made the game, see stats.h
+    StatsCounters* mStats;
+    const std::string mStatsFilePath;
+    bool playCountedTick();
+    void recordGame();
     int mDelay;
-    const std::string mRecordBoardFilePath = "record.dat";
+    const std::string mRecordBoardFilePath;
+    const std::string mSaveFilePath;
+    // Set by Q, the game is saved instead of played on
+    bool mSaveRequested = false;
+    // loadGame set up the next game, startGame must not start a new one
+    bool mResumed = false;
     std::vector<int> mLeaderBoard;
-    const int mNumLeaders = 3;
+    const int mNumLeaders;
+    // The autopilot steers instead of the keyboard, see playHeadless
+    bool mAutopilot = false;
+    long long mTickAllocations = 0;
+    int autopilotKey() const;
+    bool isBlocked(SnakeBody cell) const;
+    int getStartLength() const;
 };
 
 #endif
@@ -0,0 +1,417 @@
+// Plays scripted games through Game on an in-memory terminal and compares
+// every frame with the golden files.
+//
+// Usage: snakegolden [--record] [--golden directory] [name ...]
+// The files are in "golden" unless told otherwise. --record writes them
+// from what the game draws now instead of checking against them.
+//
+// A golden file holds the frames one after another: "frame N" and then a
+// line "row text" for every row that changed since the frame before. When
+// the terminal changes size "size width height" comes before the frame,
+// and that frame has all its rows.
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "game.h"
+#include "memrender.h"
+
+namespace
+{
+
+// The terminal turns into width x height before the tick
+struct Resize
+{
+    int tick;
+    int width;
+    int height;
+};
+
+// One character per tick: '.' no key, w a s d steer, g heads for the food
+struct Scenario
+{
+    std::string name;
+    int width;
+    int height;
+    unsigned int seed;
+    int worldWidth;
+    int worldHeight;
+    std::string keys;
+    std::vector<Resize> resizes;
+    FoodRules food;
+    // A level file to play on, see level.h
+    std::string level;
+    bool wrap = false;
+    // The snake's length at the start, 0 for the game's own
+    int length = 0;
+};
+
+std::string repeat(const std::string& keys, int times)
+{
+    std::string result;
+    for (int i = 0; i < times; i ++)
+    {
+        result += keys;
+    }
+    return result;
+}
+
+std::vector<Scenario> scenarios()
+{
+    return {
+        {"greedy", 80, 24, 1, 0, 0, std::string(400, 'g')},
+        {"square", 80, 24, 2, 0, 0, repeat("a....s....d....w....", 20)},
+        {"small", 40, 16, 3, 0, 0, std::string(300, 'g')},
+        {"world", 80, 24, 4, 120, 60, "d" + std::string(70, '.')},
+        // The big world code on a world that fits the view, so the greedy player can see where it goes
+        {"fitworld", 80, 24, 6, 60, 16, std::string(600, 'g')},
+        // Bigger, too small so the game pauses, then back
+        {"resize", 80, 24, 5, 0, 0, std::string(200, 'g'), {{30, 100, 30}, {60, 60, 20}, {75, 60, 20}, {90, 80, 24}}},
+        // Thirty foods worth up to 5 points, each gone after 60 ticks
+        {"feast", 80, 24, 7, 0, 0, std::string(400, 'g'), {}, {30, 5, 60}},
+        // Obstacles and a closed pocket the food must never drop into
+        {"level", 80, 24, 9, 0, 0, "a" + std::string(300, 'g'), {}, {5, 1, 0}, "levels/pillars.txt"},
+        // Out of the right edge and back in at the left, then up through the top
+        {"wrap", 80, 24, 10, 0, 0, "d" + std::string(120, '.') + "w" + std::string(40, '.') + std::string(200, 'g'), {}, {}, "", true},
+        // A world bigger than the view, which has to show both sides of the edge at once
+        {"wrapworld", 80, 24, 11, 120, 60, "d" + std::string(130, '.') + "w" + std::string(70, '.'), {}, {20, 1, 0}, "", true},
+        // Food that lasts 40 ticks, through a pause longer than that: it keeps the ticks it had left
+        {"pausefood", 80, 24, 13, 0, 0, std::string(200, 'g'), {{30, 60, 20}, {120, 80, 24}}, {5, 1, 40}},
+        // A snake of one in the big world code, whose tail is its head
+        {"worldone", 80, 24, 12, 60, 16, std::string(400, 'g'), {}, {}, "", false, 1},
+    };
+}
+
+struct Point
+{
+    int x = -1;
+    int y = -1;
+};
+
+// Where the head went and where the food is, read off the screen the way a player would
+class ScreenReader
+{
+public:
+    void read(const std::vector<std::string>& rows, int boardWidth)
+    {
+        Point head;
+        for (int y = 0; y < rows.size(); y ++)
+        {
+            for (int x = 0; x < boardWidth; x ++)
+            {
+                if (rows[y][x] == '#')
+                {
+                    this->mFood.x = x;
+                    this->mFood.y = y;
+                }
+                bool before = y < this->mRows.size() && x < this->mRows[y].size() && this->mRows[y][x] == '@';
+                if (rows[y][x] == '@' && !before)
+                {
+                    head.x = x;
+                    head.y = y;
+                }
+            }
+        }
+        if (head.x >= 0)
+        {
+            this->mLastHead = this->mHead;
+            this->mHead = head;
+        }
+        this->mRows = rows;
+    }
+
+    // Straight on while it gets closer, else turn towards the food
+    char greedyKey() const
+    {
+        int moveX = this->mHead.x - this->mLastHead.x;
+        int moveY = this->mHead.y - this->mLastHead.y;
+        int foodX = this->mFood.x - this->mHead.x;
+        int foodY = this->mFood.y - this->mHead.y;
+        if (this->mLastHead.x < 0 || this->mFood.x < 0)
+        {
+            return '.';
+        }
+        if (moveX != 0)
+        {
+            if (foodX * moveX > 0)
+            {
+                return '.';
+            }
+            return foodY < 0 ? 'w' : 's';
+        }
+        if (foodY * moveY > 0)
+        {
+            return '.';
+        }
+        return foodX < 0 ? 'a' : 'd';
+    }
+
+private:
+    std::vector<std::string> mRows;
+    Point mHead;
+    Point mLastHead;
+    Point mFood;
+};
+
+class GoldenFile
+{
+public:
+    bool load(const std::string& path, int height)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+        std::string line;
+        bool resized = true;
+        while (std::getline(file, line))
+        {
+            if (line.compare(0, 5, "size ") == 0)
+            {
+                std::istringstream size(line.substr(5));
+                int width;
+                size >> width >> height;
+                resized = true;
+                continue;
+            }
+            // Rows only change where a frame says so, the rest carry over
+            if (line.compare(0, 6, "frame ") == 0)
+            {
+                if (resized)
+                {
+                    this->mFrames.push_back(std::vector<std::string>(height));
+                }
+                else
+                {
+                    this->mFrames.push_back(this->mFrames.back());
+                }
+                resized = false;
+                continue;
+            }
+            size_t space = line.find(' ');
+            int row = std::stoi(line.substr(0, space));
+            if (this->mFrames.empty() || row < 0 || row >= height)
+            {
+                return false;
+            }
+            this->mFrames.back()[row] = line.substr(space + 1);
+        }
+        return true;
+    }
+
+    int getNumFrames() const
+    {
+        return this->mFrames.size();
+    }
+
+    const std::vector<std::string>& getFrame(int frame) const
+    {
+        return this->mFrames[frame];
+    }
+
+private:
+    std::vector<std::vector<std::string>> mFrames;
+};
+
+void writeFrame(std::ostream& output, int frame, const std::vector<std::string>& rows, const std::vector<std::string>& previous)
+{
+    bool resized = !previous.empty() && (rows.size() != previous.size() || rows[0].size() != previous[0].size());
+    if (resized)
+    {
+        output << "size " << rows[0].size() << " " << rows.size() << "\n";
+    }
+    output << "frame " << frame << "\n";
+    for (int row = 0; row < rows.size(); row ++)
+    {
+        if (previous.empty() || resized || rows[row] != previous[row])
+        {
+            output << row << " " << rows[row] << "\n";
+        }
+    }
+}
+
+// Plays one scenario, false if a frame is not the golden one
+bool runScenario(const Scenario& scenario, const std::string& directory, bool record)
+{
+    std::string path = directory + "/" + scenario.name + ".txt";
+    GoldenFile golden;
+    if (!record)
+    {
+        if (!golden.load(path, scenario.height))
+        {
+            std::cout << scenario.name << ": cannot read " << path << std::endl;
+            return false;
+        }
+    }
+    std::ostringstream recording;
+
+    MemoryRenderer* terminal = new MemoryRenderer(scenario.width, scenario.height);
+    GameConfig config;
+    if (scenario.length > 0)
+    {
+        config.initialSnakeLength = scenario.length;
+    }
+    Game game(std::unique_ptr<Renderer>(terminal), config);
+    game.setSeed(scenario.seed);
+    game.setFoodRules(scenario.food);
+    game.setWrap(scenario.wrap);
+    if (scenario.worldWidth > 0)
+    {
+        game.setWorldSize(scenario.worldWidth, scenario.worldHeight);
+    }
+    if (!scenario.level.empty())
+    {
+        Level level;
+        if (!level.load(scenario.level))
+        {
+            std::cout << scenario.name << ": cannot read " << scenario.level << std::endl;
+            return false;
+        }
+        game.setLevel(level);
+    }
+    ScreenReader reader;
+    std::vector<std::string> rows;
+    std::vector<std::string> previous;
+    int nextResize = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    game.renderBoards();
+    game.initializeGame();
+    game.presentFrame();
+    int frame = 0;
+    bool same = true;
+    while (true)
+    {
+        rows.resize(terminal->getFrameHeight());
+        for (int y = 0; y < rows.size(); y ++)
+        {
+            terminal->getRow(y, rows[y]);
+        }
+        if (record)
+        {
+            writeFrame(recording, frame, rows, previous);
+        }
+        else if (frame >= golden.getNumFrames())
+        {
+            std::cout << scenario.name << ": frame " << frame << " is not in " << path << std::endl;
+            same = false;
+            break;
+        }
+        else if (rows != golden.getFrame(frame))
+        {
+            std::cout << scenario.name << ": frame " << frame << " differs from " << path << std::endl;
+            for (int y = 0; y < rows.size() && y < golden.getFrame(frame).size(); y ++)
+            {
+                if (rows[y] != golden.getFrame(frame)[y])
+                {
+                    std::cout << "  row " << y << " expected " << golden.getFrame(frame)[y] << "\n"
+                              << "  row " << y << " got      " << rows[y] << std::endl;
+                }
+            }
+            same = false;
+            break;
+        }
+        previous = rows;
+        // A game keeps its board when the terminal grows, it only gets smaller
+        reader.read(rows, std::min(terminal->getFrameWidth(), scenario.width) - 18);
+
+        if (frame == scenario.keys.size())
+        {
+            break;
+        }
+        char key = scenario.keys[frame];
+        if (key == 'g')
+        {
+            key = reader.greedyKey();
+        }
+        if (key != '.')
+        {
+            terminal->pushKey(key);
+        }
+        for (; nextResize < scenario.resizes.size() && scenario.resizes[nextResize].tick == frame; nextResize ++)
+        {
+            terminal->pushResize(scenario.resizes[nextResize].width, scenario.resizes[nextResize].height);
+        }
+        if (!game.playTick())
+        {
+            break;
+        }
+        frame ++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (same && !record && frame + 1 != golden.getNumFrames())
+    {
+        std::cout << scenario.name << ": the game ended at frame " << frame << ", " << path << " has " << golden.getNumFrames() << " frames" << std::endl;
+        same = false;
+    }
+    if (record)
+    {
+        std::ofstream file(path);
+        file << recording.str();
+        if (!file)
+        {
+            std::cout << scenario.name << ": cannot write " << path << std::endl;
+            return false;
+        }
+    }
+    std::cout << std::fixed << std::setprecision(0)
+              << std::setw(8) << std::left << scenario.name << std::right << " " << scenario.width << "x" << scenario.height
+              << " | " << frame + 1 << " frames " << (record ? "recorded" : same ? "match" : "FAILED")
+              << " | " << (frame + 1) / seconds << " frames/s";
+    if (!scenario.resizes.empty())
+    {
+        ResizeStats resizes = game.getResizeStats();
+        std::cout << std::setprecision(1) << " | " << resizes.resizes << " resizes, stable after "
+                  << resizes.totalNanoseconds / 1000.0 / std::max(resizes.resizes, 1) << " us, worst "
+                  << resizes.maxNanoseconds / 1000.0 << " us";
+    }
+    std::cout << std::endl;
+    return same;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    bool record = false;
+    std::string directory = "golden";
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i ++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--record")
+        {
+            record = true;
+        }
+        else if (argument == "--golden" && i + 1 < argc)
+        {
+            directory = argv[++ i];
+        }
+        else
+        {
+            names.push_back(argument);
+        }
+    }
+
+    bool passed = true;
+    std::vector<Scenario> all = scenarios();
+    for (int i = 0; i < all.size(); i ++)
+    {
+        bool selected = names.empty();
+        for (int j = 0; j < names.size(); j ++)
+        {
+            selected = selected || all[i].name == names[j];
+        }
+        if (selected)
+        {
+            passed = runScenario(all[i], directory, record) && passed;
+        }
+    }
+    return passed ? 0 : 1;
+}
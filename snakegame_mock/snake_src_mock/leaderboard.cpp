@@ -0,0 +1,16 @@
+#include <cstring>
+
+#include "leaderboard.h"
+
+int decodeLeaderBoard(const char* data, size_t size, std::vector<int>& leaders)
+{
+    int count = 0;
+    while (count < leaders.size() && (count + 1) * sizeof(int) <= size)
+    {
+        int score;
+        std::memcpy(&score, data + count * sizeof(int), sizeof(score));
+        leaders[count] = score < 0 ? 0 : score;
+        count ++;
+    }
+    return count;
+}
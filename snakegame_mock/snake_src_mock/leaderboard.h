@@ -0,0 +1,13 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <vector>
+#include <cstddef>
+
+// The leader board file is the best scores one after another, highest first,
+// each an int as this machine keeps it. Returns how many whole scores data
+// has, at most leaders.size(); leaders past them are left as they were. A
+// negative score can't have been written by a game and reads as 0.
+int decodeLeaderBoard(const char* data, size_t size, std::vector<int>& leaders);
+
+#endif
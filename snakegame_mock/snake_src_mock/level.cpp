@@ -0,0 +1,186 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <utility>
+
+#include "level.h"
+
+bool Level::load(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    Level loaded;
+    bool parsed = loaded.parse(static_cast<const char*>(data), status.st_size);
+    munmap(data, status.st_size);
+    if (!parsed)
+    {
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
+
+// Two passes over the text: the size first, then the walls straight into the bitmap
+bool Level::parse(const char* data, size_t size)
+{
+    int rows = 0;
+    int columns = 0;
+    int length = 0;
+    for (size_t i = 0; i < size; i ++)
+    {
+        if (data[i] == '\n')
+        {
+            rows ++;
+            length = 0;
+        }
+        else if (data[i] != '\r')
+        {
+            length ++;
+            columns = std::max(columns, length);
+        }
+    }
+    rows += length > 0;
+    if (rows == 0 || columns == 0 || rows + 2 > MaxSize || columns + 2 > MaxSize)
+    {
+        return false;
+    }
+
+    this->mWidth = columns + 2;
+    this->mHeight = rows + 2;
+    this->mWordsPerRow = (this->mWidth + 63) / 64;
+    this->mWalls.assign(this->mWordsPerRow * this->mHeight, 0);
+    for (int x = 0; x < this->mWidth; x ++)
+    {
+        this->setWall(x, 0);
+        this->setWall(x, this->mHeight - 1);
+    }
+    for (int y = 0; y < this->mHeight; y ++)
+    {
+        this->setWall(0, y);
+        this->setWall(this->mWidth - 1, y);
+    }
+    this->mStart = SnakeBody(this->mWidth / 2, this->mHeight / 2);
+    int x = 1;
+    int y = 1;
+    for (size_t i = 0; i < size; i ++)
+    {
+        if (data[i] == '\n')
+        {
+            x = 1;
+            y ++;
+            continue;
+        }
+        if (data[i] == '#')
+        {
+            this->setWall(x, y);
+        }
+        else if (data[i] == 'S')
+        {
+            this->mStart = SnakeBody(x, y);
+        }
+        x += data[i] != '\r';
+    }
+    if (this->isWall(this->mStart.getX(), this->mStart.getY()) || this->isWall(this->mStart.getX(), this->mStart.getY() + 1))
+    {
+        // Not left half made, so the level still says it isn't loaded
+        *this = Level();
+        return false;
+    }
+    this->computeDistances();
+    return true;
+}
+
+bool Level::isLoaded() const
+{
+    return this->mWidth > 0;
+}
+
+int Level::getWidth() const
+{
+    return this->mWidth;
+}
+
+int Level::getHeight() const
+{
+    return this->mHeight;
+}
+
+SnakeBody Level::getStart() const
+{
+    return this->mStart;
+}
+
+bool Level::isWall(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= this->mWidth || y >= this->mHeight)
+    {
+        return true;
+    }
+    return (this->mWalls[y * this->mWordsPerRow + x / 64] >> (x % 64)) & 1;
+}
+
+int Level::getDistance(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= this->mWidth || y >= this->mHeight)
+    {
+        return -1;
+    }
+    return this->mDistances[y * this->mWidth + x];
+}
+
+bool Level::isReachable(int x, int y) const
+{
+    return this->getDistance(x, y) >= 0;
+}
+
+size_t Level::getMemoryUsage() const
+{
+    return sizeof(Level) + this->mWalls.capacity() * sizeof(uint64_t) + this->mDistances.capacity() * sizeof(int);
+}
+
+void Level::setWall(int x, int y)
+{
+    this->mWalls[y * this->mWordsPerRow + x / 64] |= uint64_t(1) << (x % 64);
+}
+
+// Breadth first from the start, the queue is the cells in the order they were reached
+void Level::computeDistances()
+{
+    this->mDistances.assign(this->mWidth * this->mHeight, -1);
+    std::vector<SnakeBody> queue;
+    queue.reserve(this->mWidth * this->mHeight);
+    queue.push_back(this->mStart);
+    this->mDistances[this->mStart.getY() * this->mWidth + this->mStart.getX()] = 0;
+    for (size_t next = 0; next < queue.size(); next ++)
+    {
+        SnakeBody cell = queue[next];
+        int distance = this->mDistances[cell.getY() * this->mWidth + cell.getX()];
+        for (int i = 0; i < 4; i ++)
+        {
+            SnakeBody neighbour = stepCell(cell, static_cast<Direction>(i));
+            int& seen = this->mDistances[neighbour.getY() * this->mWidth + neighbour.getX()];
+            if (seen == -1 && !this->isWall(neighbour.getX(), neighbour.getY()))
+            {
+                seen = distance + 1;
+                queue.push_back(neighbour);
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "snake.h"
+
+// Obstacles for a single player world, from a text file with one line per
+// row of the inside of the board: '#' is an obstacle, 'S' is where the head
+// starts (the middle if there is none) and anything else is free. Short
+// lines are free at the end. The world is the file with a wall all around.
+// The snake's tail starts below the head, so that cell has to be free too.
+//
+// Walls are kept one bit per cell, and every cell knows how many steps it is
+// from the start, so both are a single lookup during a game.
+class Level
+{
+public:
+    static const int MaxSize = 2048;
+
+    // The file is mapped and parsed in place, false if it isn't a usable level
+    bool load(const std::string& path);
+    // The same for text already in memory, on a level that isn't loaded yet
+    bool parse(const char* data, size_t size);
+    bool isLoaded() const;
+    // Of the world, the outer walls included
+    int getWidth() const;
+    int getHeight() const;
+    SnakeBody getStart() const;
+    // The outer walls and the obstacles, anything outside the world too
+    bool isWall(int x, int y) const;
+    // Steps from the start around the obstacles, -1 for walls and pockets that can't be reached
+    int getDistance(int x, int y) const;
+    bool isReachable(int x, int y) const;
+    size_t getMemoryUsage() const;
+
+private:
+    void setWall(int x, int y);
+    void computeDistances();
+
+    int mWidth = 0;
+    int mHeight = 0;
+    int mWordsPerRow = 0;
+    std::vector<uint64_t> mWalls;
+    std::vector<int> mDistances;
+    SnakeBody mStart;
+};
+
+#endif
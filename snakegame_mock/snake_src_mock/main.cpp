@@ -1,7 +1,244 @@
+#include <string>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
 #include "game.h"
+#include "server.h"
+#include "net.h"
+#include "termout.h"
+#include "stats.h"
+#include "trace.h"
+
+// snakegame                                  single player
+// snakegame --server [port] [width] [height] host a shared arena
+// snakegame --connect [host] [port]          join a shared arena
+// snakegame --broadcast [name]               single player, watchable with snakeview
+// snakegame --world [width] [height]         single player on a world bigger than the screen
+// snakegame --output-stats                   single player, then print terminal writes per frame
+//                                            and how long resizes took to show
+// snakegame --resume                         go on with the game Q saved
+// Any of them can be preceded by options, see config.h: --config file reads them from a file
+// first, the others go on top of it. --renderer ncurses|ansi|null picks how the game is drawn,
+// --speed file loads the speed curve, see speed.h, --food count[:value[:lifetime]] keeps that
+// much food on the board, worth up to value points and gone after lifetime ticks, --level file
+// plays a level with obstacles, see level.h, --wrap takes the walls away and --event-log file
+// writes down every game event. A game saved on a level resumes with the same --level, a saved
+// game resumes wrapping or not the way it was played. --headless has the autopilot play
+// --games games without a terminal and prints their points. --stats-file file writes the
+// game statistics in the Prometheus text format after every game, --stats-port port serves
+// them on 127.0.0.1, see stats.h. --trace file records where the time of every tick goes,
+// snaketrace turns it into JSON for Perfetto, see trace.h. --server goes by --length and --seed
+// for its arena and --connect by --renderer and --board, the other options are an error there.
+
+// The options before the mode are taken off argv, their names go to given.
+// false with the reason in error
+bool parseOptions(int& argc, char**& argv, GameConfig& config, std::vector<std::string>& given, std::string& error)
+{
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    int end = 1;
+    while (end < argc)
+    {
+        std::string key = argv[end];
+        bool takesValue = key == "--config";
+        // --world W H is the mode, --world WxH the option
+        bool worldMode = key == "--world" && (end + 1 >= argc || std::string(argv[end + 1]).find('x') == std::string::npos);
+        if (key.compare(0, 2, "--") != 0 || worldMode || (!takesValue && !isOption(key.substr(2), takesValue)))
+        {
+            break;
+        }
+        if (takesValue && end + 1 >= argc)
+        {
+            error = key + " needs a value";
+            return false;
+        }
+        keys.push_back(key.substr(2));
+        values.push_back(takesValue ? argv[end + 1] : "");
+        end += takesValue ? 2 : 1;
+    }
+    for (int i = 0; i < keys.size(); i ++)
+    {
+        if (keys[i] == "config" && !loadConfig(values[i], config, error))
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < keys.size(); i ++)
+    {
+        if (keys[i] != "config" && !applyOption(keys[i], values[i], config, error))
+        {
+            return false;
+        }
+    }
+    given = keys;
+    argc -= end - 1;
+    argv += end - 1;
+    return true;
+}
+
+// The multiplayer modes go by a few options only. One given on the command
+// line that the mode would drop is an error, the same as an unknown one.
+bool checkModeOptions(const std::string& mode, const std::vector<std::string>& given, const std::vector<std::string>& used, std::string& error)
+{
+    for (int i = 0; i < given.size(); i ++)
+    {
+        if (given[i] != "config" && std::find(used.begin(), used.end(), given[i]) == used.end())
+        {
+            error = "--" + given[i] + " doesn't apply to " + mode;
+            return false;
+        }
+    }
+    return true;
+}
 
 int main(int argc, char** argv)
 {
-    Game game;
+    GameConfig config;
+    std::vector<std::string> given;
+    std::string error;
+    if (!parseOptions(argc, argv, config, given, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::string renderer = config.headless ? "null" : config.renderer;
+    // Scraped while the games run, stopped when main returns
+    StatsServer statsServer;
+    if (config.statsPort > 0 && !statsServer.start(config.statsPort))
+    {
+        std::cerr << "Cannot serve stats on port " << config.statsPort << std::endl;
+        return 1;
+    }
+    // Flushed and closed when main returns, after the games
+    TraceWriter traceWriter;
+    if (!config.trace.empty() && !traceWriter.start(config.trace))
+    {
+        std::cerr << "Cannot write a trace to " << config.trace << std::endl;
+        return 1;
+    }
+    std::string mode = argc > 1 ? argv[1] : "";
+    if ((mode == "--server" && !checkModeOptions(mode, given, {"length", "seed"}, error))
+        || (mode == "--connect" && !checkModeOptions(mode, given, {"renderer", "board"}, error)))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (mode == "--server")
+    {
+        int port = DefaultArenaPort;
+        int width = 1000;
+        int height = 1000;
+        if ((argc > 2 && !parseInteger(argv[2], 1, 65535, port)) || (argc > 3 && !parseInteger(argv[3], 8, MaxBoardSize, width))
+            || (argc > 4 && !parseInteger(argv[4], 8, MaxBoardSize, height)) || !isArenaSize(width, height))
+        {
+            std::cerr << "--server takes a port and a board of 8 to " << MaxBoardSize << " cells a side, "
+                      << MaxArenaCells << " in all" << std::endl;
+            return 1;
+        }
+        ArenaServer server(port, width, height, 20, config.initialSnakeLength, config.seed);
+        return server.run() ? 0 : 1;
+    }
+    if (mode == "--connect")
+    {
+        std::string host = argc > 2 ? argv[2] : "127.0.0.1";
+        int port = argc > 3 ? std::atoi(argv[3]) : DefaultArenaPort;
+        bool connected;
+        {
+            Game game(createRenderer(renderer), config);
+            connected = game.startRemoteGame(host, port);
+        }
+        if (!connected)
+        {
+            std::cerr << "Cannot connect to " << host << ":" << port << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (mode == "--output-stats")
+    {
+        ResizeStats resizes;
+        long long events[NumGameEventTypes];
+        {
+            Game game(createRenderer(renderer), config);
+            game.startGame();
+            resizes = game.getResizeStats();
+            for (int i = 0; i < NumGameEventTypes; i ++)
+            {
+                events[i] = game.getNumEvents(static_cast<GameEventType>(i));
+            }
+        }
+        TerminalOutputStats stats = getTerminalOutputStats();
+        std::cerr << stats.frames << " frames, " << stats.frameWrites << " writes ("
+                  << (stats.frames ? double(stats.frameWrites) / stats.frames : 0) << " per frame), "
+                  << (stats.frames ? stats.frameBytes / stats.frames : 0) << " bytes per frame, "
+                  << stats.otherWrites << " writes outside frames" << std::endl;
+        std::cerr << resizes.resizes << " resizes, "
+                  << (resizes.resizes ? resizes.totalNanoseconds / 1000 / resizes.resizes : 0) << " us to a stable frame on average, "
+                  << resizes.maxNanoseconds / 1000 << " us at most" << std::endl;
+        for (int i = 0; i < NumGameEventTypes; i ++)
+        {
+            std::cerr << (i ? ", " : "") << events[i] << " " << getEventName(static_cast<GameEventType>(i));
+        }
+        std::cerr << std::endl;
+        return 0;
+    }
+    if (mode == "--resume")
+    {
+        bool resumed;
+        {
+            Game game(createRenderer(renderer), config);
+            resumed = game.resumeGame();
+            if (resumed)
+            {
+                game.startGame();
+            }
+        }
+        if (!resumed)
+        {
+            std::cerr << "No saved game to resume" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (mode == "--world")
+    {
+        // Held to the same sizes as the option
+        std::string width = argc > 2 ? argv[2] : "30000";
+        std::string height = argc > 3 ? argv[3] : "30000";
+        if (!applyOption("world", width + "x" + height, config, error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+    Game game(createRenderer(renderer), config);
+    if (config.headless)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<int> points = game.playHeadless(config.games);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        long long total = 0;
+        int best = 0;
+        for (int i = 0; i < points.size(); i ++)
+        {
+            total += points[i];
+            best = std::max(best, points[i]);
+        }
+        std::cout << points.size() << " games, " << (points.empty() ? 0 : double(total) / points.size()) << " points on average, "
+                  << best << " at best, " << seconds << " s" << std::endl;
+        if (game.getTickAllocations() > 0)
+        {
+            std::cerr << game.getTickAllocations() << " heap allocations in ticks after warm-up" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (mode == "--broadcast")
+    {
+        game.enableBroadcast(argc > 2 ? argv[2] : DefaultBroadcastName);
+    }
     game.startGame();
 }
@@ -0,0 +1,68 @@
+#include <atomic>
+#include <cstdlib>
+
+#include "memory.h"
+
+MemoryArena::MemoryArena(size_t capacity, std::pmr::memory_resource* upstream): mBuffer(new unsigned char[capacity]), mCapacity(capacity), mResource(mBuffer.get(), capacity, upstream)
+{
+}
+
+std::pmr::memory_resource* MemoryArena::getResource()
+{
+    return &this->mResource;
+}
+
+void MemoryArena::reset()
+{
+    this->mResource.release();
+}
+
+size_t MemoryArena::getCapacity() const
+{
+    return this->mCapacity;
+}
+
+#ifdef SNAKE_COUNT_ALLOCATIONS
+
+namespace
+{
+
+std::atomic<long long> gHeapAllocations(0);
+
+}
+
+// Array and nothrow forms end up here too
+void* operator new (std::size_t size)
+{
+    gHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete (void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete (void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+long long countHeapAllocations()
+{
+    return gHeapAllocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+long long countHeapAllocations()
+{
+    return 0;
+}
+
+#endif
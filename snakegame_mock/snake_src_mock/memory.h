@@ -0,0 +1,54 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+// One block of memory handed out front to back and taken back all at once.
+// Everything a single player game needs is carved from it, so a restart is
+// a reset instead of a round of frees and mallocs. The block is sized up
+// front; by default running out throws bad_alloc, with an upstream given
+// the arena grows from there instead (big worlds can't size the snake up front).
+class MemoryArena
+{
+public:
+    explicit MemoryArena(size_t capacity, std::pmr::memory_resource* upstream = std::pmr::null_memory_resource());
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator = (const MemoryArena&) = delete;
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        void* memory = this->mResource.allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+    // For containers that should live in the arena too
+    std::pmr::memory_resource* getResource();
+    // Objects made from the arena must be destroyed before this
+    void reset();
+    size_t getCapacity() const;
+
+private:
+    std::unique_ptr<unsigned char[]> mBuffer;
+    const size_t mCapacity;
+    std::pmr::monotonic_buffer_resource mResource;
+};
+
+// Deleter for objects from MemoryArena::create, the memory goes back on reset
+struct ArenaDelete
+{
+    template <typename T>
+    void operator () (T* object) const
+    {
+        object->~T();
+    }
+};
+
+// Calls to operator new so far. Only counted when built with
+// SNAKE_COUNT_ALLOCATIONS, see the snakegame-alloc target.
+long long countHeapAllocations();
+
+#endif
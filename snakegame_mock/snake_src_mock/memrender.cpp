@@ -0,0 +1,74 @@
+#include "memrender.h"
+
+MemoryRenderer::MemoryRenderer(int width, int height): CellRenderer(width, height), mFrame(width * height), mFrameWidth(width), mFrameHeight(height)
+{
+}
+
+void MemoryRenderer::present()
+{
+    this->mFrame = this->mScreen;
+    this->mFrameWidth = this->getWidth();
+    this->mFrameHeight = this->getHeight();
+    this->mNumFrames ++;
+}
+
+int MemoryRenderer::readKey()
+{
+    if (this->mNextKey == this->mKeys.size())
+    {
+        this->mKeys.clear();
+        this->mNextKey = 0;
+        this->mSizes.clear();
+        this->mNextSize = 0;
+        return NoKey;
+    }
+    int key = this->mKeys[this->mNextKey ++];
+    if (key == KeyResize)
+    {
+        this->resizeScreen(this->mSizes[this->mNextSize], this->mSizes[this->mNextSize + 1]);
+        this->mNextSize += 2;
+    }
+    return key;
+}
+
+void MemoryRenderer::pushKey(int key)
+{
+    this->mKeys.push_back(key);
+}
+
+void MemoryRenderer::pushResize(int width, int height)
+{
+    this->mKeys.push_back(KeyResize);
+    this->mSizes.push_back(width);
+    this->mSizes.push_back(height);
+}
+
+void MemoryRenderer::getRow(int y, std::string& row) const
+{
+    int width = this->mFrameWidth;
+    row.resize(width);
+    for (int x = 0; x < width; x ++)
+    {
+        const Cell& cell = this->mFrame[y * width + x];
+        row[x] = cell.symbol;
+        if (cell.style & LineStyle)
+        {
+            row[x] = cell.symbol == 'q' ? '-' : cell.symbol == 'x' ? '|' : '+';
+        }
+    }
+}
+
+int MemoryRenderer::getFrameWidth() const
+{
+    return this->mFrameWidth;
+}
+
+int MemoryRenderer::getFrameHeight() const
+{
+    return this->mFrameHeight;
+}
+
+long long MemoryRenderer::getNumFrames() const
+{
+    return this->mNumFrames;
+}
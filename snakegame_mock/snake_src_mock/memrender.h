@@ -0,0 +1,41 @@
+#ifndef MEMRENDER_H
+#define MEMRENDER_H
+
+#include <string>
+#include <vector>
+
+#include "cells.h"
+
+// A terminal that only exists in memory. Keys are queued up front and
+// each present keeps a copy of the whole screen, so a game can be played
+// and looked at without a TTY.
+class MemoryRenderer : public CellRenderer
+{
+public:
+    MemoryRenderer(int width, int height);
+
+    void present() override;
+    int readKey() override;
+
+    void pushKey(int key);
+    // The terminal turns into width x height when readKey gets to it
+    void pushResize(int width, int height);
+    // Row y of the last frame presented, lines drawn with + - | and standout dropped
+    void getRow(int y, std::string& row) const;
+    // The size of the last frame, the terminal may have changed since
+    int getFrameWidth() const;
+    int getFrameHeight() const;
+    long long getNumFrames() const;
+
+private:
+    std::vector<Cell> mFrame;
+    int mFrameWidth;
+    int mFrameHeight;
+    std::vector<int> mKeys;
+    std::vector<int> mSizes;
+    int mNextSize = 0;
+    int mNextKey = 0;
+    long long mNumFrames = 0;
+};
+
+#endif
@@ -0,0 +1,305 @@
+#include <curses.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
+
+#include "ncrender.h"
+#include "termout.h"
+
+namespace
+{
+
+volatile sig_atomic_t gResized = 0;
+// What the signal handler needs to give the terminal back
+termios gSavedTerminal;
+char gLeave[64];
+int gLeaveLength = 0;
+
+WINDOW* toWindow(void* window)
+{
+    return static_cast<WINDOW*>(window);
+}
+
+void onResize(int)
+{
+    gResized = 1;
+}
+
+// curses' own handler would clean up a terminal it never had
+void onInterrupt(int number)
+{
+    tcsetattr(STDIN_FILENO, TCSANOW, &gSavedTerminal);
+    write(STDOUT_FILENO, gLeave, gLeaveLength);
+    signal(number, SIG_DFL);
+    raise(number);
+}
+
+void appendCapability(const char* name)
+{
+    const char* value = tigetstr(name);
+    if (value == nullptr || value == reinterpret_cast<char*>(-1))
+    {
+        return;
+    }
+    int length = std::min<int>(std::strlen(value), sizeof(gLeave) - gLeaveLength);
+    std::memcpy(gLeave + gLeaveLength, value, length);
+    gLeaveLength += length;
+}
+
+void restoreEnvironment(const char* name, const std::string& value)
+{
+    if (value.empty())
+    {
+        unsetenv(name);
+    }
+    else
+    {
+        setenv(name, value.c_str(), 1);
+    }
+}
+
+}
+
+NcursesRenderer::NcursesRenderer(): mTerminalFd(STDOUT_FILENO)
+{
+    this->mInputFd = STDIN_FILENO;
+    tcgetattr(this->mInputFd, &this->mSavedTerminal);
+    gSavedTerminal = this->mSavedTerminal;
+    termios raw = this->mSavedTerminal;
+    // curses can't set the modes of a terminal it doesn't draw on. Keys come
+    // one at a time without echo, and a line feed only moves down, as curses expects.
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_oflag &= ~ONLCR;
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(this->mInputFd, TCSANOW, &raw);
+    // Before newterm, so curses leaves these signals to us
+    struct sigaction action = {};
+    action.sa_handler = onResize;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &action, &this->mSavedResize);
+    action.sa_handler = onInterrupt;
+    sigaction(SIGINT, &action, &this->mSavedInterrupt);
+    sigaction(SIGTERM, &action, &this->mSavedTerminate);
+    this->mInput = fdopen(dup(this->mInputFd), "r");
+    this->open(nullptr, getTerminalWidth(), getTerminalHeight());
+    gLeaveLength = 0;
+    appendCapability("sgr0");
+    appendCapability("cnorm");
+    appendCapability("rmcup");
+    appendCapability("rmkx");
+    refresh();
+    this->sendDrawn(false);
+}
+
+NcursesRenderer::NcursesRenderer(int outputFd, int width, int height): mTerminalFd(outputFd)
+{
+    this->mInput = fopen("/dev/null", "r");
+    this->open("xterm", width, height);
+}
+
+NcursesRenderer::~NcursesRenderer()
+{
+    for (int i = 0; i < this->mWindows.size(); i ++)
+    {
+        delwin(toWindow(this->mWindows[i]));
+    }
+    delwin(toWindow(this->mKeyWindow));
+    endwin();
+    if (this->mInputFd >= 0)
+    {
+        this->sendDrawn(false);
+        tcsetattr(this->mInputFd, TCSANOW, &this->mSavedTerminal);
+        sigaction(SIGWINCH, &this->mSavedResize, nullptr);
+        sigaction(SIGINT, &this->mSavedInterrupt, nullptr);
+        sigaction(SIGTERM, &this->mSavedTerminate, nullptr);
+    }
+    delscreen(static_cast<SCREEN*>(this->mScreen));
+    fclose(this->mOutput);
+    fclose(this->mInput);
+}
+
+// A null terminalType means $TERM
+void NcursesRenderer::open(const char* terminalType, int width, int height)
+{
+    this->mOutput = fdopen(memfd_create("snakegame-frame", 0), "w");
+    // With no terminal to ask, curses starts out at the size these say,
+    // and sets the terminal up for that size
+    std::string columns = getenv("COLUMNS") ? getenv("COLUMNS") : "";
+    std::string lines = getenv("LINES") ? getenv("LINES") : "";
+    setenv("COLUMNS", std::to_string(width).c_str(), 1);
+    setenv("LINES", std::to_string(height).c_str(), 1);
+    this->mScreen = newterm(terminalType, this->mOutput, this->mInput);
+    restoreEnvironment("COLUMNS", columns);
+    restoreEnvironment("LINES", lines);
+    resize_term(height, width);
+    // Worst case every cell needs a move and a style change
+    this->mDrawn.resize(width * height * 16);
+    this->setUp();
+}
+
+void NcursesRenderer::setUp()
+{
+    this->mKeyWindow = newwin(1, 1, 0, 0);
+    // If there wasn't any key pressed don't wait for keypress
+    nodelay(toWindow(this->mKeyWindow), true);
+    // Turn on keypad control
+    keypad(toWindow(this->mKeyWindow), true);
+    // Untouched, so reading keys never refreshes it
+    wnoutrefresh(toWindow(this->mKeyWindow));
+    // No echo for the key pressed
+    noecho();
+    // No cursor show
+    curs_set(0);
+    getmaxyx(stdscr, this->mHeight, this->mWidth);
+}
+
+int NcursesRenderer::getWidth() const
+{
+    return this->mWidth;
+}
+
+int NcursesRenderer::getHeight() const
+{
+    return this->mHeight;
+}
+
+int NcursesRenderer::createWindow(int x, int y, int width, int height)
+{
+    this->mWindows.push_back(this->makeWindow(x, y, width, height));
+    return this->mWindows.size() - 1;
+}
+
+void NcursesRenderer::placeWindow(int window, int x, int y, int width, int height)
+{
+    WINDOW* target = toWindow(this->mWindows[window]);
+    int oldX, oldY, oldWidth, oldHeight;
+    getbegyx(target, oldY, oldX);
+    getmaxyx(target, oldHeight, oldWidth);
+    if (x == oldX && y == oldY && width == oldWidth && height == oldHeight)
+    {
+        return;
+    }
+    delwin(target);
+    this->mWindows[window] = this->makeWindow(x, y, width, height);
+}
+
+// newwin fails for a window that doesn't fit the screen, so it is cut to fit
+void* NcursesRenderer::makeWindow(int x, int y, int width, int height) const
+{
+    x = std::max(0, std::min(x, this->mWidth - 1));
+    y = std::max(0, std::min(y, this->mHeight - 1));
+    width = std::max(1, std::min(width, this->mWidth - x));
+    height = std::max(1, std::min(height, this->mHeight - y));
+    return newwin(height, width, y, x);
+}
+
+void NcursesRenderer::eraseWindow(int window)
+{
+    werase(toWindow(this->mWindows[window]));
+}
+
+void NcursesRenderer::drawBox(int window)
+{
+    box(toWindow(this->mWindows[window]), 0, 0);
+}
+
+void NcursesRenderer::drawChar(int window, int x, int y, char symbol)
+{
+    mvwaddch(toWindow(this->mWindows[window]), y, x, symbol);
+}
+
+void NcursesRenderer::drawText(int window, int x, int y, const char* text, bool standout)
+{
+    WINDOW* target = toWindow(this->mWindows[window]);
+    // addstr would wrap onto the next line
+    int length = std::min<int>(std::strlen(text), getmaxx(target) - x);
+    if (length <= 0)
+    {
+        return;
+    }
+    if (standout)
+    {
+        wattron(target, A_STANDOUT);
+    }
+    mvwaddnstr(target, y, x, text, length);
+    if (standout)
+    {
+        wattroff(target, A_STANDOUT);
+    }
+}
+
+void NcursesRenderer::stageWindow(int window)
+{
+    wnoutrefresh(toWindow(this->mWindows[window]));
+}
+
+void NcursesRenderer::present()
+{
+    doupdate();
+    this->sendDrawn(true);
+}
+
+// Everything curses wrote since the last time, read back from the start of
+// the memory file, which then starts over
+void NcursesRenderer::sendDrawn(bool frame)
+{
+    fflush(this->mOutput);
+    int fd = fileno(this->mOutput);
+    off_t size = lseek(fd, 0, SEEK_CUR);
+    if (size <= 0)
+    {
+        return;
+    }
+    if (size > this->mDrawn.size())
+    {
+        this->mDrawn.resize(size);
+    }
+    size = std::max<off_t>(pread(fd, this->mDrawn.data(), size, 0), 0);
+    lseek(fd, 0, SEEK_SET);
+    if (frame)
+    {
+        writeTerminalFrame(this->mTerminalFd, this->mDrawn.data(), size);
+    }
+    else
+    {
+        writeTerminal(this->mTerminalFd, this->mDrawn.data(), size);
+    }
+}
+
+int NcursesRenderer::readKey()
+{
+    // Any number of resizes since the last key make one
+    if (this->mInputFd >= 0 && gResized)
+    {
+        gResized = 0;
+        // resizeterm would queue a KEY_RESIZE of its own on top of this one
+        resize_term(getTerminalHeight(), getTerminalWidth());
+        // After a resize the terminal shows who knows what
+        clearok(curscr, true);
+        getmaxyx(stdscr, this->mHeight, this->mWidth);
+        return KeyResize;
+    }
+    int key = wgetch(toWindow(this->mKeyWindow));
+    switch (key)
+    {
+        case ERR:
+            return NoKey;
+        case KEY_UP:
+            return KeyUp;
+        case KEY_DOWN:
+            return KeyDown;
+        case KEY_LEFT:
+            return KeyLeft;
+        case KEY_RIGHT:
+            return KeyRight;
+        case KEY_RESIZE:
+            // curses has already fitted itself to the new size
+            getmaxyx(stdscr, this->mHeight, this->mWidth);
+            return KeyResize;
+    }
+    return key;
+}
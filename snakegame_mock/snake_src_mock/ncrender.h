@@ -0,0 +1,67 @@
+#ifndef NCRENDER_H
+#define NCRENDER_H
+
+#include <cstdio>
+#include <vector>
+#include <termios.h>
+#include <signal.h>
+
+#include "renderer.h"
+
+// The game as it always looked, drawn by curses. curses itself stays in
+// ncrender.cpp, its macros would clash with names everywhere else.
+// curses writes to its output a few bytes at a time, so it gets a file in
+// memory instead of the terminal; present sends what it wrote there to the
+// terminal in one write (termout.h).
+class NcursesRenderer : public Renderer
+{
+public:
+    // Takes over the terminal
+    NcursesRenderer();
+    // Draws into outputFd as if it were a terminal of the given size
+    NcursesRenderer(int outputFd, int width, int height);
+    ~NcursesRenderer();
+    NcursesRenderer(const NcursesRenderer&) = delete;
+    NcursesRenderer& operator = (const NcursesRenderer&) = delete;
+
+    int getWidth() const override;
+    int getHeight() const override;
+    int createWindow(int x, int y, int width, int height) override;
+    void placeWindow(int window, int x, int y, int width, int height) override;
+    void eraseWindow(int window) override;
+    void drawBox(int window) override;
+    void drawChar(int window, int x, int y, char symbol) override;
+    void drawText(int window, int x, int y, const char* text, bool standout) override;
+    void stageWindow(int window) override;
+    void present() override;
+    int readKey() override;
+
+private:
+    void open(const char* terminalType, int width, int height);
+    void setUp();
+    void sendDrawn(bool frame);
+    void* makeWindow(int x, int y, int width, int height) const;
+
+    int mWidth;
+    int mHeight;
+    // WINDOW pointers
+    std::vector<void*> mWindows;
+    // Keys are read through a window of its own. Reading them through stdscr
+    // would repaint it, outside any frame, every time the terminal resizes.
+    void* mKeyWindow = nullptr;
+    void* mScreen = nullptr;
+    // Where the frames go in the end
+    int mTerminalFd;
+    // The memory file curses draws into, and a frame read back out of it
+    FILE* mOutput = nullptr;
+    std::vector<char> mDrawn;
+    FILE* mInput = nullptr;
+    // -1 unless we own the terminal
+    int mInputFd = -1;
+    termios mSavedTerminal;
+    struct sigaction mSavedResize;
+    struct sigaction mSavedInterrupt;
+    struct sigaction mSavedTerminate;
+};
+
+#endif
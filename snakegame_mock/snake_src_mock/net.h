@@ -0,0 +1,17 @@
+#ifndef NET_H
+#define NET_H
+
+#include <string>
+
+// Thin wrappers over POSIX sockets for the multiplayer mode.
+// All of them return -1 / false on failure.
+const int DefaultArenaPort = 7777;
+
+int listenTcp(int port);
+int connectTcp(const std::string& host, int port);
+bool setNonBlocking(int fd);
+void closeSocket(int fd);
+// One socket per player, so lift the open file limit as far as allowed
+void raiseFileLimit();
+
+#endif
@@ -0,0 +1,113 @@
+#include "packedbody.h"
+
+namespace
+{
+
+// The step opposite to step, for walking from the tail back to the head
+Direction reverseStep(Direction step)
+{
+    return static_cast<Direction>(static_cast<int>(step) ^ 1);
+}
+
+}
+
+PackedBody::PackedBody(size_t reservedLength)
+{
+    // The ring holds a power of two of steps, 32 to a word
+    size_t capacity = 32;
+    while (capacity < reservedLength)
+    {
+        capacity *= 2;
+    }
+    this->mSteps.assign(capacity / 32, 0);
+    this->mMask = capacity - 1;
+}
+
+void PackedBody::reset(SnakeBody head)
+{
+    this->mFirst = 0;
+    this->mNumSteps = 0;
+    this->mHead = head;
+    this->mTail = head;
+}
+
+void PackedBody::setWrap(int width, int height)
+{
+    this->mWrapWidth = width;
+    this->mWrapHeight = height;
+}
+
+void PackedBody::pushHead(SnakeBody head)
+{
+    if (this->mNumSteps == this->mMask + 1)
+    {
+        this->grow();
+    }
+    this->mFirst = (this->mFirst - 1) & this->mMask;
+    this->mNumSteps ++;
+    this->setStep(0, stepDirection(head, this->mHead));
+    this->mHead = head;
+}
+
+SnakeBody PackedBody::popTail()
+{
+    SnakeBody tail = this->mTail;
+    if (this->mNumSteps > 0)
+    {
+        this->mNumSteps --;
+        this->mTail = this->follow(tail, reverseStep(this->getStep(this->mNumSteps)));
+    }
+    return tail;
+}
+
+SnakeBody PackedBody::getHead() const
+{
+    return this->mHead;
+}
+
+SnakeBody PackedBody::getTail() const
+{
+    return this->mTail;
+}
+
+size_t PackedBody::getLength() const
+{
+    return this->mNumSteps + 1;
+}
+
+size_t PackedBody::getMemoryUsage() const
+{
+    return sizeof(PackedBody) + this->mSteps.capacity() * sizeof(uint64_t);
+}
+
+Direction PackedBody::getStep(size_t index) const
+{
+    size_t slot = (this->mFirst + index) & this->mMask;
+    return static_cast<Direction>((this->mSteps[slot / 32] >> (slot % 32 * 2)) & 3);
+}
+
+void PackedBody::setStep(size_t index, Direction step)
+{
+    size_t slot = (this->mFirst + index) & this->mMask;
+    uint64_t& word = this->mSteps[slot / 32];
+    word = (word & ~(uint64_t(3) << (slot % 32 * 2))) | static_cast<uint64_t>(step) << (slot % 32 * 2);
+}
+
+SnakeBody PackedBody::follow(SnakeBody cell, Direction step) const
+{
+    SnakeBody next = stepCell(cell, step);
+    return this->mWrapWidth > 0 ? wrapCell(next, this->mWrapWidth, this->mWrapHeight) : next;
+}
+
+// Twice the room, the steps copied out in order so the ring starts at 0 again
+void PackedBody::grow()
+{
+    PackedBody bigger((this->mMask + 1) * 2);
+    for (size_t i = 0; i < this->mNumSteps; i ++)
+    {
+        bigger.setStep(i, this->getStep(i));
+    }
+    this->mSteps.swap(bigger.mSteps);
+    this->mMask = bigger.mMask;
+    this->mFirst = 0;
+}
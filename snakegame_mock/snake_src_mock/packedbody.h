@@ -0,0 +1,66 @@
+#ifndef PACKEDBODY_H
+#define PACKEDBODY_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "snake.h"
+
+// A snake body for big worlds, where a segment can't cost four bytes.
+// Only the head and tail cells are kept, with the 2 bit step from every
+// segment to the next in a ring of bits: moving is one step in at the head
+// and one out at the tail, and a segment costs a quarter byte. It can't say
+// if a cell is part of the snake, the occupancy tiles are there for that.
+class PackedBody
+{
+public:
+    explicit PackedBody(size_t reservedLength = 64);
+
+    // A body of just the head
+    void reset(SnakeBody head);
+    // For a width x height world that wraps around, 0 x 0 for one that doesn't
+    void setWrap(int width, int height);
+    // head has to be next to the current head
+    void pushHead(SnakeBody head);
+    // Returns the cell the tail left, a body of one segment keeps it
+    SnakeBody popTail();
+    SnakeBody getHead() const;
+    SnakeBody getTail() const;
+    size_t getLength() const;
+    size_t getMemoryUsage() const;
+
+    // Calls function(cell) for every segment, head to tail
+    template <typename Function>
+    void forEach(Function function) const;
+
+private:
+    Direction getStep(size_t index) const;
+    void setStep(size_t index, Direction step);
+    SnakeBody follow(SnakeBody cell, Direction step) const;
+    void grow();
+
+    // Step i goes from segment i to segment i + 1, it sits at (mFirst + i) & mMask
+    std::vector<uint64_t> mSteps;
+    size_t mMask;
+    size_t mFirst = 0;
+    size_t mNumSteps = 0;
+    SnakeBody mHead;
+    SnakeBody mTail;
+    int mWrapWidth = 0;
+    int mWrapHeight = 0;
+};
+
+template <typename Function>
+void PackedBody::forEach(Function function) const
+{
+    SnakeBody cell = this->mHead;
+    function(cell);
+    for (size_t i = 0; i < this->mNumSteps; i ++)
+    {
+        cell = this->follow(cell, this->getStep(i));
+        function(cell);
+    }
+}
+
+#endif
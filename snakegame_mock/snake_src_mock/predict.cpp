@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cmath>
+
+#include "predict.h"
+
+namespace
+{
+
+const int MaxPredictedTicks = 32;
+const int HistorySize = 64;
+
+// Exponential average, seeded by the first sample
+double smooth(double average, double sample)
+{
+    return average == 0 ? sample : average * 0.875 + sample * 0.125;
+}
+
+}
+
+Predictor::Predictor(int ticksPerSecond): mTickPeriod(1000000 / ticksPerSecond), mRoundTrip(1000000 / ticksPerSecond)
+{
+    this->mHistory.resize(HistorySize);
+}
+
+uint16_t Predictor::addTurn(Direction direction, long long now)
+{
+    Turn turn;
+    turn.sequence = this->mNextSequence ++;
+    turn.direction = direction;
+    // The server takes one turn per tick, so queued turns land on later ticks
+    turn.tick = this->mDisplayTick + 1;
+    if (!this->mTurns.empty())
+    {
+        turn.tick = std::max(turn.tick, this->mTurns.back().tick + 1);
+    }
+    turn.time = now;
+    turn.shown = false;
+    this->mTurns.push_back(turn);
+    return turn.sequence;
+}
+
+void Predictor::onAck(const Arena& mirror, int slot, uint32_t tick, uint16_t sequence, long long now)
+{
+    this->mServerTime = now;
+    PredictedHead& predicted = this->mHistory[tick % HistorySize];
+    if (predicted.tick == tick && mirror.isActive(slot))
+    {
+        SnakeBody head = mirror.getSnake(slot).getSnake()[0];
+        if (head != predicted.head)
+        {
+            this->mMispredictions ++;
+        }
+    }
+    // Sequence numbers wrap, compare them as a signed distance
+    while (!this->mTurns.empty() && static_cast<int16_t>(sequence - this->mTurns.front().sequence) >= 0)
+    {
+        double sample = now - this->mTurns.front().time;
+        this->mRoundTrip = smooth(this->mRoundTrip, sample);
+        this->mServerLatency = smooth(this->mServerLatency, sample / 1000.0);
+        this->mTurns.pop_front();
+    }
+}
+
+bool Predictor::predict(const Arena& mirror, int slot, long long now)
+{
+    if (!mirror.isActive(slot))
+    {
+        this->mSnake.clear();
+        return false;
+    }
+    uint32_t base = mirror.getTick();
+    long long elapsed = std::min<long long>((now - this->mServerTime) / this->mTickPeriod, 3);
+    uint32_t target = base + this->getLeadTicks() + elapsed;
+    // Don't step back over small jitter, but follow the server after a long stall
+    if (target < this->mDisplayTick && this->mDisplayTick - target < 8)
+    {
+        target = this->mDisplayTick;
+    }
+    int steps = std::min<int>(target - base, MaxPredictedTicks);
+
+    // Roll back to the server state and replay the turns it hasn't seen
+    Snake& authoritative = mirror.getSnake(slot);
+    Snake snake(mirror.getWidth(), mirror.getHeight(), authoritative.getLength(), authoritative.getSnake()[0].getX(), authoritative.getSnake()[0].getY());
+    snake.getSnake() = authoritative.getSnake();
+    snake.setDirection(authoritative.getDirection());
+    this->mEaten.clear();
+    size_t nextTurn = 0;
+    for (int i = 1; i <= steps; i ++)
+    {
+        if (nextTurn < this->mTurns.size() && this->mTurns[nextTurn].tick <= base + i)
+        {
+            snake.changeDirection(this->mTurns[nextTurn].direction);
+            nextTurn ++;
+        }
+        // Deaths are left to the server, the prediction just stops
+        SnakeBody head = snake.nextHead();
+        if (mirror.isBlocked(head.getX(), head.getY()) && mirror.getCell(head.getX(), head.getY()) != slot + 1)
+        {
+            break;
+        }
+        if (snake.isPartOfSnake(head.getX(), head.getY()))
+        {
+            break;
+        }
+        snake.createNewHead();
+        bool eaten = false;
+        for (int j = 0; j < this->mEaten.size(); j ++)
+        {
+            eaten = eaten || this->mEaten[j] == head;
+        }
+        if (mirror.getCell(head.getX(), head.getY()) == -1 && !eaten)
+        {
+            this->mEaten.push_back(head);
+        }
+        else
+        {
+            snake.getSnake().pop_back();
+        }
+    }
+    this->mSnake = snake.getSnake();
+
+    for (int i = 0; i < this->mTurns.size(); i ++)
+    {
+        Turn& turn = this->mTurns[i];
+        if (!turn.shown && turn.tick <= target)
+        {
+            turn.shown = true;
+            this->mPredictedLatency = smooth(this->mPredictedLatency, (now - turn.time) / 1000.0);
+        }
+    }
+    this->mHistory[target % HistorySize].tick = target;
+    this->mHistory[target % HistorySize].head = this->mSnake[0];
+    bool changed = target != this->mDisplayTick;
+    this->mDisplayTick = target;
+    return changed;
+}
+
+const SnakeBodies& Predictor::getSnake() const
+{
+    return this->mSnake;
+}
+
+// Enough ticks ahead that a turn made now reaches the server in time
+int Predictor::getLeadTicks() const
+{
+    return std::min<int>(std::ceil(this->mRoundTrip / this->mTickPeriod), MaxPredictedTicks / 2);
+}
+
+double Predictor::getPredictedLatency() const
+{
+    return this->mPredictedLatency;
+}
+
+double Predictor::getServerLatency() const
+{
+    return this->mServerLatency;
+}
+
+int Predictor::getMispredictions() const
+{
+    return this->mMispredictions;
+}
@@ -0,0 +1,68 @@
+#ifndef PREDICT_H
+#define PREDICT_H
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+#include "snake.h"
+#include "arena.h"
+
+// Client side prediction for the multiplayer client.
+// Our own snake is shown a few ticks ahead of the last server state:
+// every time we draw, the snake is rolled back to the mirror and the
+// turns the server hasn't applied yet are replayed with the same Snake
+// rules the server uses, one turn per tick. When the server state
+// arrives the prediction for that tick is checked and simply rebuilt.
+// All times are in microseconds.
+class Predictor
+{
+public:
+    explicit Predictor(int ticksPerSecond);
+
+    // A local turn, returns the sequence number to send along
+    uint16_t addTurn(Direction direction, long long now);
+    // Server state for a tick arrived with every turn up to sequence applied
+    void onAck(const Arena& mirror, int slot, uint32_t tick, uint16_t sequence, long long now);
+    // Re-simulate for the tick shown now, returns true if that tick changed
+    bool predict(const Arena& mirror, int slot, long long now);
+
+    const SnakeBodies& getSnake() const;
+    int getLeadTicks() const;
+    // Averages in milliseconds from a key press to the turn showing up
+    double getPredictedLatency() const;
+    double getServerLatency() const;
+    int getMispredictions() const;
+
+private:
+    struct Turn
+    {
+        uint16_t sequence;
+        Direction direction;
+        uint32_t tick;
+        long long time;
+        bool shown;
+    };
+
+    struct PredictedHead
+    {
+        uint32_t tick;
+        SnakeBody head;
+    };
+
+    const long long mTickPeriod;
+    std::deque<Turn> mTurns;
+    uint16_t mNextSequence = 1;
+    // Smoothed round trip from sending a turn to its Ack
+    double mRoundTrip;
+    long long mServerTime = 0;
+    uint32_t mDisplayTick = 0;
+    SnakeBodies mSnake;
+    SnakeBodies mEaten;
+    std::vector<PredictedHead> mHistory;
+    double mPredictedLatency = 0;
+    double mServerLatency = 0;
+    int mMispredictions = 0;
+};
+
+#endif
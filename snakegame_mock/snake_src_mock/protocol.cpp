@@ -0,0 +1,459 @@
+#include <algorithm>
+
+#include "protocol.h"
+#include "bitstream.h"
+
+namespace
+{
+
+void putU32(std::vector<unsigned char>& out, uint32_t value)
+{
+    out.push_back(value & 0xff);
+    out.push_back((value >> 8) & 0xff);
+    out.push_back((value >> 16) & 0xff);
+    out.push_back((value >> 24) & 0xff);
+}
+
+uint32_t getU32(const unsigned char* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// Write the type and leave room for the size, patched by endFrame
+size_t beginFrame(std::vector<unsigned char>& out, MessageType type)
+{
+    size_t start = out.size();
+    putU32(out, 0);
+    out.push_back(static_cast<unsigned char>(type));
+    return start;
+}
+
+void endFrame(std::vector<unsigned char>& out, size_t start)
+{
+    uint32_t size = out.size() - start - 4;
+    for (int i = 0; i < 4; i ++)
+    {
+        out[start + i] = (size >> (8 * i)) & 0xff;
+    }
+}
+
+uint32_t cellOf(const Arena& arena, SnakeBody cell)
+{
+    return cell.getY() * arena.getWidth() + cell.getX();
+}
+
+// Direction of the step from one cell to its neighbour
+uint32_t stepBetween(SnakeBody from, SnakeBody to)
+{
+    if (to.getY() < from.getY())
+    {
+        return static_cast<uint32_t>(Direction::Up);
+    }
+    if (to.getY() > from.getY())
+    {
+        return static_cast<uint32_t>(Direction::Down);
+    }
+    if (to.getX() < from.getX())
+    {
+        return static_cast<uint32_t>(Direction::Left);
+    }
+    return static_cast<uint32_t>(Direction::Right);
+}
+
+SnakeBody stepFrom(SnakeBody cell, uint32_t direction)
+{
+    switch (static_cast<Direction>(direction))
+    {
+        case Direction::Up:
+            return SnakeBody(cell.getX(), cell.getY() - 1);
+        case Direction::Down:
+            return SnakeBody(cell.getX(), cell.getY() + 1);
+        case Direction::Left:
+            return SnakeBody(cell.getX() - 1, cell.getY());
+        case Direction::Right:
+            return SnakeBody(cell.getX() + 1, cell.getY());
+    }
+    return cell;
+}
+
+bool insideBoard(const Arena& arena, SnakeBody cell)
+{
+    return cell.getX() >= 0 && cell.getY() >= 0 && cell.getX() < arena.getWidth() && cell.getY() < arena.getHeight();
+}
+
+// Head cell, heading, length and points, then a 2 bit step from each segment to the next
+void putBody(BitWriter& writer, const Arena& arena, int slot)
+{
+    Snake& snake = arena.getSnake(slot);
+    const SnakeBodies& body = snake.getSnake();
+    writer.writeVarint(cellOf(arena, body[0]));
+    writer.writeBits(static_cast<uint32_t>(snake.getDirection()), 2);
+    writer.writeVarint(arena.getPoints(slot));
+    writer.writeVarint(body.size());
+    for (int i = 1; i < body.size(); i ++)
+    {
+        writer.writeBits(stepBetween(body[i - 1], body[i]), 2);
+    }
+}
+
+// Cell indexes sorted and delta coded, so dense food costs about a byte each
+void putCells(BitWriter& writer, const Arena& arena, const SnakeBodies& cells, std::vector<uint32_t>& scratch)
+{
+    scratch.clear();
+    for (int i = 0; i < cells.size(); i ++)
+    {
+        scratch.push_back(cellOf(arena, cells[i]));
+    }
+    std::sort(scratch.begin(), scratch.end());
+    writer.writeVarint(scratch.size());
+    uint32_t previous = 0;
+    for (int i = 0; i < scratch.size(); i ++)
+    {
+        writer.writeVarint(scratch[i] - previous);
+        previous = scratch[i];
+    }
+}
+
+struct BodyRecord
+{
+    int slot;
+    Direction direction;
+    int points;
+    SnakeBodies body;
+};
+
+bool readCell(BitReader& reader, const Arena& arena, uint32_t index, SnakeBody& cell)
+{
+    if (!reader.ok() || index >= static_cast<uint32_t>(arena.getWidth()) * arena.getHeight())
+    {
+        return false;
+    }
+    cell = SnakeBody(index % arena.getWidth(), index / arena.getWidth());
+    return true;
+}
+
+bool readBody(BitReader& reader, const Arena& arena, BodyRecord& record)
+{
+    SnakeBody head;
+    if (!readCell(reader, arena, reader.readVarint(), head))
+    {
+        return false;
+    }
+    record.direction = static_cast<Direction>(reader.readBits(2));
+    record.points = reader.readVarint();
+    uint32_t length = reader.readVarint();
+    if (!reader.ok() || length == 0 || length > static_cast<uint32_t>(arena.getWidth()) * arena.getHeight())
+    {
+        return false;
+    }
+    record.body.resize(length);
+    record.body[0] = head;
+    for (uint32_t i = 1; i < length; i ++)
+    {
+        record.body[i] = stepFrom(record.body[i - 1], reader.readBits(2));
+        if (!insideBoard(arena, record.body[i]))
+        {
+            return false;
+        }
+    }
+    return reader.ok();
+}
+
+bool readCells(BitReader& reader, const Arena& arena, SnakeBodies& cells)
+{
+    uint32_t count = reader.readVarint();
+    if (!reader.ok() || count > static_cast<uint32_t>(arena.getWidth()) * arena.getHeight())
+    {
+        return false;
+    }
+    cells.resize(count);
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        index += reader.readVarint();
+        if (!readCell(reader, arena, index, cells[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readNumSlots(BitReader& reader, const Arena& arena, uint32_t& numSlots)
+{
+    numSlots = reader.readVarint();
+    return reader.ok() && numSlots <= static_cast<uint32_t>(arena.getWidth()) * arena.getHeight();
+}
+
+}
+
+void encodeWelcome(std::vector<unsigned char>& out, int slot, const Arena& arena, int ticksPerSecond)
+{
+    size_t start = beginFrame(out, MessageType::Welcome);
+    putU32(out, slot);
+    putU32(out, arena.getWidth());
+    putU32(out, arena.getHeight());
+    putU32(out, ticksPerSecond);
+    endFrame(out, start);
+}
+
+void encodeKeyframe(std::vector<unsigned char>& out, const Arena& arena)
+{
+    std::vector<uint32_t> scratch;
+    size_t start = beginFrame(out, MessageType::Keyframe);
+    BitWriter writer(out);
+    writer.writeVarint(arena.getTick());
+    writer.writeVarint(arena.getNumSlots());
+    for (int slot = 0; slot < arena.getNumSlots(); slot ++)
+    {
+        writer.writeBits(arena.isActive(slot), 1);
+        if (arena.isActive(slot))
+        {
+            putBody(writer, arena, slot);
+        }
+    }
+    putCells(writer, arena, arena.getFoods(), scratch);
+    writer.flush();
+    endFrame(out, start);
+}
+
+// Per slot a 2 bit state: 0 gone, 1 moved, 2 placed anew.
+// A move is the 2 bit heading plus one bit telling whether the tail
+// went away; a kept tail means the snake ate and scored a point.
+// Bodies of new snakes and the new food come after the per slot bits.
+void encodeTick(std::vector<unsigned char>& out, const Arena& arena)
+{
+    std::vector<uint32_t> scratch;
+    size_t start = beginFrame(out, MessageType::Tick);
+    BitWriter writer(out);
+    writer.writeVarint(arena.getTick());
+    writer.writeVarint(arena.getNumSlots());
+    for (int slot = 0; slot < arena.getNumSlots(); slot ++)
+    {
+        if (!arena.isActive(slot))
+        {
+            writer.writeBits(0, 2);
+        }
+        else if (arena.isRespawned(slot))
+        {
+            writer.writeBits(2, 2);
+        }
+        else
+        {
+            writer.writeBits(1, 2);
+            writer.writeBits(static_cast<uint32_t>(arena.getSnake(slot).getDirection()), 2);
+            writer.writeBits(!arena.hasEaten(slot), 1);
+        }
+    }
+    for (int slot = 0; slot < arena.getNumSlots(); slot ++)
+    {
+        if (arena.isActive(slot) && arena.isRespawned(slot))
+        {
+            putBody(writer, arena, slot);
+        }
+    }
+    putCells(writer, arena, arena.getNewFoods(), scratch);
+    writer.flush();
+    endFrame(out, start);
+}
+
+void encodeAck(std::vector<unsigned char>& out, uint32_t tick, uint16_t sequence)
+{
+    size_t start = beginFrame(out, MessageType::Ack);
+    putU32(out, tick);
+    out.push_back(sequence & 0xff);
+    out.push_back(sequence >> 8);
+    endFrame(out, start);
+}
+
+void encodeInput(unsigned char* out, Direction direction, uint16_t sequence)
+{
+    out[0] = static_cast<unsigned char>(direction);
+    out[1] = sequence & 0xff;
+    out[2] = sequence >> 8;
+}
+
+int readFrame(const unsigned char* data, size_t size, MessageType& type, const unsigned char*& payload, size_t& payloadSize)
+{
+    if (size < 4)
+    {
+        return 0;
+    }
+    uint32_t frameSize = getU32(data);
+    if (frameSize < 1 || frameSize > (1u << 30))
+    {
+        return -1;
+    }
+    if (size < frameSize + 4)
+    {
+        return 0;
+    }
+    type = static_cast<MessageType>(data[4]);
+    payload = data + 5;
+    payloadSize = frameSize - 1;
+    return frameSize + 4;
+}
+
+bool decodeWelcome(const unsigned char* payload, size_t size, int& slot, int& width, int& height, int& ticksPerSecond)
+{
+    if (size != 16)
+    {
+        return false;
+    }
+    slot = getU32(payload);
+    width = getU32(payload + 4);
+    height = getU32(payload + 8);
+    ticksPerSecond = getU32(payload + 12);
+    return slot >= 0 && isArenaSize(width, height) && ticksPerSecond > 0 && ticksPerSecond <= 1000;
+}
+
+bool decodeAck(const unsigned char* payload, size_t size, uint32_t& tick, uint16_t& sequence)
+{
+    if (size != 6)
+    {
+        return false;
+    }
+    tick = getU32(payload);
+    sequence = payload[4] | (payload[5] << 8);
+    return true;
+}
+
+bool decodeInput(const unsigned char* data, Direction& direction, uint16_t& sequence)
+{
+    direction = static_cast<Direction>(data[0]);
+    sequence = data[1] | (data[2] << 8);
+    return data[0] <= static_cast<unsigned char>(Direction::Right);
+}
+
+bool decodeKeyframe(const unsigned char* payload, size_t size, Arena& mirror)
+{
+    BitReader reader(payload, size);
+    uint32_t tick = reader.readVarint();
+    uint32_t numSlots;
+    if (!readNumSlots(reader, mirror, numSlots))
+    {
+        return false;
+    }
+    std::vector<BodyRecord> bodies;
+    for (uint32_t slot = 0; slot < numSlots; slot ++)
+    {
+        if (reader.readBits(1) == 0)
+        {
+            continue;
+        }
+        bodies.emplace_back();
+        bodies.back().slot = slot;
+        if (!readBody(reader, mirror, bodies.back()))
+        {
+            return false;
+        }
+    }
+    SnakeBodies foods;
+    if (!readCells(reader, mirror, foods) || !reader.done())
+    {
+        return false;
+    }
+
+    mirror.resetMirror(tick, numSlots);
+    for (int i = 0; i < bodies.size(); i ++)
+    {
+        mirror.loadSnake(bodies[i].slot, bodies[i].body, bodies[i].direction, bodies[i].points);
+    }
+    for (int i = 0; i < foods.size(); i ++)
+    {
+        mirror.addFood(foods[i]);
+    }
+    return true;
+}
+
+// Applied in the order the server changed the board:
+// removals, moves, newly placed snakes and then new food
+bool decodeTick(const unsigned char* payload, size_t size, Arena& mirror)
+{
+    struct MoveRecord
+    {
+        int slot;
+        SnakeBody head;
+        int length;
+        int points;
+    };
+
+    BitReader reader(payload, size);
+    uint32_t tick = reader.readVarint();
+    uint32_t numSlots;
+    if (!readNumSlots(reader, mirror, numSlots))
+    {
+        return false;
+    }
+    std::vector<int> clears;
+    std::vector<MoveRecord> moves;
+    std::vector<BodyRecord> bodies;
+    for (uint32_t slot = 0; slot < numSlots; slot ++)
+    {
+        uint32_t state = reader.readBits(2);
+        if (state == 0 || state == 2)
+        {
+            clears.push_back(slot);
+        }
+        if (state == 1)
+        {
+            uint32_t direction = reader.readBits(2);
+            bool tailRemoved = reader.readBits(1);
+            if (!reader.ok() || !mirror.isActive(slot))
+            {
+                return false;
+            }
+            Snake& snake = mirror.getSnake(slot);
+            MoveRecord move;
+            move.slot = slot;
+            move.head = stepFrom(snake.getSnake()[0], direction);
+            move.length = snake.getLength() + (tailRemoved ? 0 : 1);
+            move.points = mirror.getPoints(slot) + (tailRemoved ? 0 : 1);
+            if (!insideBoard(mirror, move.head))
+            {
+                return false;
+            }
+            moves.push_back(move);
+        }
+        else if (state == 2)
+        {
+            bodies.emplace_back();
+            bodies.back().slot = slot;
+        }
+        else if (state != 0)
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < bodies.size(); i ++)
+    {
+        if (!readBody(reader, mirror, bodies[i]))
+        {
+            return false;
+        }
+    }
+    SnakeBodies foods;
+    if (!readCells(reader, mirror, foods) || !reader.done())
+    {
+        return false;
+    }
+
+    mirror.setTick(tick);
+    for (int i = 0; i < clears.size(); i ++)
+    {
+        mirror.clearSlot(clears[i]);
+    }
+    for (int i = 0; i < moves.size(); i ++)
+    {
+        mirror.advanceSnake(moves[i].slot, moves[i].head, moves[i].length, moves[i].points);
+    }
+    for (int i = 0; i < bodies.size(); i ++)
+    {
+        mirror.loadSnake(bodies[i].slot, bodies[i].body, bodies[i].direction, bodies[i].points);
+    }
+    for (int i = 0; i < foods.size(); i ++)
+    {
+        mirror.addFood(foods[i]);
+    }
+    return true;
+}
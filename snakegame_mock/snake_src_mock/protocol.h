@@ -0,0 +1,46 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+
+// Wire format between the arena server and its clients.
+// Server to client: [u32 size][u8 type][payload], the size little endian.
+// Keyframes and ticks are bit packed (see bitstream.h): a tick only carries
+// what Arena::step changed, a keyframe carries the whole board and is sent
+// on join, periodically, and to clients that skipped frames.
+// Every tick frame is followed by an Ack telling the client which of its
+// turns the server applied so far, for client side prediction.
+// Client to server: a turn is [u8 direction][u16 sequence number].
+enum class MessageType
+{
+    Welcome = 1,
+    Keyframe = 2,
+    Tick = 3,
+    Ack = 4,
+};
+
+const int InputMessageSize = 3;
+
+void encodeWelcome(std::vector<unsigned char>& out, int slot, const Arena& arena, int ticksPerSecond);
+// Full board, sent on join and to clients that fell behind
+void encodeKeyframe(std::vector<unsigned char>& out, const Arena& arena);
+// What changed during the last Arena::step
+void encodeTick(std::vector<unsigned char>& out, const Arena& arena);
+void encodeAck(std::vector<unsigned char>& out, uint32_t tick, uint16_t sequence);
+void encodeInput(unsigned char* out, Direction direction, uint16_t sequence);
+
+// Split one frame off the front of a receive buffer.
+// Returns the frame size, 0 if the frame is not complete yet, -1 if it is malformed.
+int readFrame(const unsigned char* data, size_t size, MessageType& type, const unsigned char*& payload, size_t& payloadSize);
+
+bool decodeWelcome(const unsigned char* payload, size_t size, int& slot, int& width, int& height, int& ticksPerSecond);
+bool decodeKeyframe(const unsigned char* payload, size_t size, Arena& mirror);
+bool decodeTick(const unsigned char* payload, size_t size, Arena& mirror);
+bool decodeAck(const unsigned char* payload, size_t size, uint32_t& tick, uint16_t& sequence);
+bool decodeInput(const unsigned char* data, Direction& direction, uint16_t& sequence);
+
+#endif
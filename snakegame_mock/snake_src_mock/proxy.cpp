@@ -0,0 +1,198 @@
+// Latency injection proxy for testing remote play.
+// Accepts clients on one port and forwards each connection to the arena
+// server, holding every chunk back for delay +- jitter milliseconds in
+// both directions. Order within a connection is kept, like a real link.
+//
+// Usage: snakeproxy [listen port] [server port] [delay ms] [jitter ms]
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <random>
+#include <csignal>
+#include <cstdlib>
+#include <algorithm>
+
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "net.h"
+
+namespace
+{
+
+struct Chunk
+{
+    long long due;
+    std::vector<unsigned char> data;
+    size_t sent;
+};
+
+// One direction of a connection
+struct Pipe
+{
+    int from;
+    int to;
+    std::deque<Chunk> queue;
+    long long lastDue;
+};
+
+struct Link
+{
+    Pipe up;
+    Pipe down;
+    bool closed;
+};
+
+volatile std::sig_atomic_t gStopProxy = 0;
+
+void stopProxy(int)
+{
+    gStopProxy = 1;
+}
+
+long long nowMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns false when the sending side went away
+bool readPipe(Pipe& pipe, long long delay, long long jitter, std::mt19937& random)
+{
+    unsigned char buffer[65536];
+    while (true)
+    {
+        ssize_t received = recv(pipe.from, buffer, sizeof(buffer), 0);
+        if (received == 0)
+        {
+            return false;
+        }
+        if (received < 0)
+        {
+            return true;
+        }
+        long long offset = jitter > 0 ? static_cast<long long>(random() % (2 * jitter + 1)) - jitter : 0;
+        long long due = std::max(nowMicroseconds() + std::max(0LL, delay + offset), pipe.lastDue);
+        pipe.lastDue = due;
+        pipe.queue.push_back(Chunk{due, std::vector<unsigned char>(buffer, buffer + received), 0});
+    }
+}
+
+void writePipe(Pipe& pipe, long long now)
+{
+    while (!pipe.queue.empty() && pipe.queue.front().due <= now)
+    {
+        Chunk& chunk = pipe.queue.front();
+        ssize_t sent = send(pipe.to, chunk.data.data() + chunk.sent, chunk.data.size() - chunk.sent, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return;
+        }
+        chunk.sent += sent;
+        if (chunk.sent < chunk.data.size())
+        {
+            return;
+        }
+        pipe.queue.pop_front();
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    int listenPort = argc > 1 ? std::atoi(argv[1]) : DefaultArenaPort + 1;
+    int serverPort = argc > 2 ? std::atoi(argv[2]) : DefaultArenaPort;
+    long long delay = (argc > 3 ? std::atoi(argv[3]) : 50) * 1000LL;
+    long long jitter = (argc > 4 ? std::atoi(argv[4]) : 0) * 1000LL;
+
+    raiseFileLimit();
+    int listenFd = listenTcp(listenPort);
+    if (listenFd < 0)
+    {
+        std::cerr << "Cannot listen on port " << listenPort << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, stopProxy);
+    std::signal(SIGTERM, stopProxy);
+    std::cout << "Proxy 127.0.0.1:" << listenPort << " -> " << serverPort
+              << ", " << delay / 1000 << " +- " << jitter / 1000 << " ms each way" << std::endl;
+
+    std::mt19937 random(1);
+    std::vector<Link> links;
+    std::vector<pollfd> fds;
+    while (!gStopProxy)
+    {
+        long long now = nowMicroseconds();
+        long long nextDue = now + 10000;
+        fds.resize(1 + 2 * links.size());
+        fds[0] = {listenFd, POLLIN, 0};
+        for (int i = 0; i < links.size(); i ++)
+        {
+            fds[1 + 2 * i] = {links[i].up.from, POLLIN, 0};
+            fds[2 + 2 * i] = {links[i].down.from, POLLIN, 0};
+            if (!links[i].up.queue.empty())
+            {
+                nextDue = std::min(nextDue, links[i].up.queue.front().due);
+            }
+            if (!links[i].down.queue.empty())
+            {
+                nextDue = std::min(nextDue, links[i].down.queue.front().due);
+            }
+        }
+        poll(fds.data(), fds.size(), std::max(0LL, (nextDue - now + 999) / 1000));
+
+        now = nowMicroseconds();
+        for (int i = 0; i < links.size(); i ++)
+        {
+            Link& link = links[i];
+            if (fds[1 + 2 * i].revents && !readPipe(link.up, delay, jitter, random))
+            {
+                link.closed = true;
+            }
+            if (fds[2 + 2 * i].revents && !readPipe(link.down, delay, jitter, random))
+            {
+                link.closed = true;
+            }
+            writePipe(link.up, now);
+            writePipe(link.down, now);
+        }
+        for (int i = links.size() - 1; i >= 0; i --)
+        {
+            if (links[i].closed)
+            {
+                closeSocket(links[i].up.from);
+                closeSocket(links[i].down.from);
+                links[i] = std::move(links.back());
+                links.pop_back();
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            int client;
+            while ((client = accept(listenFd, nullptr, nullptr)) >= 0)
+            {
+                int server = connectTcp("127.0.0.1", serverPort);
+                if (server < 0)
+                {
+                    closeSocket(client);
+                    continue;
+                }
+                setNonBlocking(client);
+                Link link;
+                link.up = Pipe{client, server, {}, 0};
+                link.down = Pipe{server, client, {}, 0};
+                link.closed = false;
+                links.push_back(std::move(link));
+            }
+        }
+    }
+    for (int i = 0; i < links.size(); i ++)
+    {
+        closeSocket(links[i].up.from);
+        closeSocket(links[i].down.from);
+    }
+    closeSocket(listenFd);
+    return 0;
+}
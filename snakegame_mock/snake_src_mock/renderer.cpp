@@ -0,0 +1,72 @@
+#include "renderer.h"
+#include "ncrender.h"
+#include "ansi.h"
+
+NullRenderer::NullRenderer(int width, int height): mWidth(width), mHeight(height)
+{
+}
+
+int NullRenderer::getWidth() const
+{
+    return this->mWidth;
+}
+
+int NullRenderer::getHeight() const
+{
+    return this->mHeight;
+}
+
+int NullRenderer::createWindow(int x, int y, int width, int height)
+{
+    return this->mNumWindows ++;
+}
+
+void NullRenderer::placeWindow(int window, int x, int y, int width, int height)
+{
+}
+
+void NullRenderer::eraseWindow(int window)
+{
+}
+
+void NullRenderer::drawBox(int window)
+{
+}
+
+void NullRenderer::drawChar(int window, int x, int y, char symbol)
+{
+}
+
+void NullRenderer::drawText(int window, int x, int y, const char* text, bool standout)
+{
+}
+
+void NullRenderer::stageWindow(int window)
+{
+}
+
+void NullRenderer::present()
+{
+}
+
+int NullRenderer::readKey()
+{
+    return NoKey;
+}
+
+std::unique_ptr<Renderer> createRenderer(const std::string& name)
+{
+    if (name == "ncurses")
+    {
+        return std::unique_ptr<Renderer>(new NcursesRenderer());
+    }
+    if (name == "ansi")
+    {
+        return std::unique_ptr<Renderer>(new AnsiRenderer());
+    }
+    if (name == "null")
+    {
+        return std::unique_ptr<Renderer>(new NullRenderer(80, 24));
+    }
+    return nullptr;
+}
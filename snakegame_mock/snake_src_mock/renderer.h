@@ -0,0 +1,72 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <memory>
+#include <string>
+
+// Keys readKey returns besides plain characters
+const int NoKey = -1;
+const int KeyUp = 0x103;
+const int KeyDown = 0x102;
+const int KeyLeft = 0x104;
+const int KeyRight = 0x105;
+// The terminal changed size, getWidth and getHeight have the new one
+const int KeyResize = 0x222;
+
+// Everything Game needs from a terminal. Windows are rectangles of cells
+// numbered in the order they are made, drawn into off screen. stageWindow
+// queues a window for the next present, which puts the staged windows on
+// the terminal together, the later ones on top.
+// Coordinates are inside the window and anything outside it is cut off.
+class Renderer
+{
+public:
+    virtual ~Renderer() {}
+
+    virtual int getWidth() const = 0;
+    virtual int getHeight() const = 0;
+
+    virtual int createWindow(int x, int y, int width, int height) = 0;
+    // Puts a window somewhere else or makes it another size. Nothing happens
+    // if it is already there, otherwise it is made again and comes back empty.
+    virtual void placeWindow(int window, int x, int y, int width, int height) = 0;
+    virtual void eraseWindow(int window) = 0;
+    // A line around the edge of the window
+    virtual void drawBox(int window) = 0;
+    virtual void drawChar(int window, int x, int y, char symbol) = 0;
+    virtual void drawText(int window, int x, int y, const char* text, bool standout = false) = 0;
+    virtual void stageWindow(int window) = 0;
+    virtual void present() = 0;
+
+    // Never waits, NoKey if nothing was pressed
+    virtual int readKey() = 0;
+};
+
+// Draws nothing and reads no keys, to measure everything but the terminal
+class NullRenderer : public Renderer
+{
+public:
+    NullRenderer(int width, int height);
+
+    int getWidth() const override;
+    int getHeight() const override;
+    int createWindow(int x, int y, int width, int height) override;
+    void placeWindow(int window, int x, int y, int width, int height) override;
+    void eraseWindow(int window) override;
+    void drawBox(int window) override;
+    void drawChar(int window, int x, int y, char symbol) override;
+    void drawText(int window, int x, int y, const char* text, bool standout) override;
+    void stageWindow(int window) override;
+    void present() override;
+    int readKey() override;
+
+private:
+    int mWidth;
+    int mHeight;
+    int mNumWindows = 0;
+};
+
+// "ncurses", "ansi" or "null", nullptr for anything else
+std::unique_ptr<Renderer> createRenderer(const std::string& name);
+
+#endif
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <ctime>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "server.h"
+#include "net.h"
+#include "protocol.h"
+
+namespace
+{
+
+volatile std::sig_atomic_t gStopServer = 0;
+
+void stopServer(int)
+{
+    gStopServer = 1;
+}
+
+long long nowMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+ArenaServer::ArenaServer(int port, int gameBoardWidth, int gameBoardHeight, int ticksPerSecond, int initialSnakeLength, unsigned int seed): mPort(port), mTicksPerSecond(ticksPerSecond), mArena(gameBoardWidth, gameBoardHeight, initialSnakeLength, seed != 0 ? seed : std::time(nullptr))
+{
+}
+
+ArenaServer::~ArenaServer()
+{
+    for (int i = 0; i < this->mClients.size(); i ++)
+    {
+        closeSocket(this->mClients[i].fd);
+    }
+    closeSocket(this->mListenFd);
+}
+
+// Every new connection gets a snake and the full board
+void ArenaServer::acceptClients()
+{
+    while (true)
+    {
+        int fd = accept(this->mListenFd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return;
+        }
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        setNonBlocking(fd);
+        Client client;
+        client.fd = fd;
+        client.slot = this->mArena.addSnake();
+        client.sent = 0;
+        client.needsKeyframe = true;
+        client.lastTurn = 0;
+        std::vector<unsigned char> welcome;
+        encodeWelcome(welcome, client.slot, this->mArena, this->mTicksPerSecond);
+        this->mClients.push_back(client);
+        this->sendFrame(this->mClients.back(), welcome);
+    }
+}
+
+bool ArenaServer::readInputs(Client& client)
+{
+    unsigned char buffer[256];
+    while (true)
+    {
+        ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (received == 0)
+        {
+            return false;
+        }
+        if (received < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client.input.insert(client.input.end(), buffer, buffer + received);
+        size_t used = 0;
+        for (; used + InputMessageSize <= client.input.size(); used += InputMessageSize)
+        {
+            Direction direction;
+            uint16_t sequence;
+            if (!decodeInput(client.input.data() + used, direction, sequence))
+            {
+                return false;
+            }
+            if (client.turns.size() < this->mMaxQueuedTurns)
+            {
+                client.turns.push_back(std::make_pair(direction, sequence));
+            }
+        }
+        client.input.erase(client.input.begin(), client.input.begin() + used);
+    }
+}
+
+// The server takes one turn per client per tick, the same as the client predicts
+void ArenaServer::applyTurns()
+{
+    for (int i = 0; i < this->mClients.size(); i ++)
+    {
+        Client& client = this->mClients[i];
+        if (client.turns.empty())
+        {
+            continue;
+        }
+        this->mArena.setInput(client.slot, client.turns.front().first);
+        client.lastTurn = client.turns.front().second;
+        client.turns.pop_front();
+    }
+}
+
+// Returns true once nothing is left over from earlier frames
+bool ArenaServer::flushPending(Client& client)
+{
+    while (client.sent < client.pending.size())
+    {
+        ssize_t sent = send(client.fd, client.pending.data() + client.sent, client.pending.size() - client.sent, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        client.sent += sent;
+        this->mBytesSent += sent;
+    }
+    client.pending.clear();
+    client.sent = 0;
+    return true;
+}
+
+void ArenaServer::sendFrame(Client& client, const std::vector<unsigned char>& frame)
+{
+    ssize_t sent = 0;
+    if (client.pending.empty())
+    {
+        sent = send(client.fd, frame.data(), frame.size(), MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            sent = 0;
+        }
+        this->mBytesSent += sent;
+    }
+    if (sent < frame.size())
+    {
+        client.pending.insert(client.pending.end(), frame.begin() + sent, frame.end());
+    }
+}
+
+// A client that hasn't taken the previous frame skips this one and
+// gets a keyframe once it catches up, so slow readers never block the tick
+void ArenaServer::broadcast()
+{
+    bool keyframeTick = this->mArena.getTick() % this->mKeyframeInterval == 0;
+    this->mTickFrame.clear();
+    this->mKeyframe.clear();
+    for (int i = 0; i < this->mClients.size(); i ++)
+    {
+        Client& client = this->mClients[i];
+        if (!this->flushPending(client))
+        {
+            client.needsKeyframe = true;
+            this->mSkippedFrames ++;
+            continue;
+        }
+        // The shared frame and this client's Ack go out in one send
+        if (client.needsKeyframe || keyframeTick)
+        {
+            if (this->mKeyframe.empty())
+            {
+                encodeKeyframe(this->mKeyframe, this->mArena);
+            }
+            client.needsKeyframe = false;
+            this->mScratch = this->mKeyframe;
+        }
+        else
+        {
+            if (this->mTickFrame.empty())
+            {
+                encodeTick(this->mTickFrame, this->mArena);
+            }
+            this->mScratch = this->mTickFrame;
+        }
+        encodeAck(this->mScratch, this->mArena.getTick(), client.lastTurn);
+        this->sendFrame(client, this->mScratch);
+    }
+}
+
+void ArenaServer::dropClient(int index)
+{
+    closeSocket(this->mClients[index].fd);
+    this->mArena.removeSnake(this->mClients[index].slot);
+    this->mClients[index] = std::move(this->mClients.back());
+    this->mClients.pop_back();
+}
+
+// Serve the sockets until the next tick is due
+void ArenaServer::waitForTick(long long deadline)
+{
+    std::vector<pollfd> fds;
+    while (!gStopServer)
+    {
+        long long now = nowMicroseconds();
+        if (now >= deadline)
+        {
+            return;
+        }
+        fds.resize(this->mClients.size() + 1);
+        fds[0].fd = this->mListenFd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < this->mClients.size(); i ++)
+        {
+            fds[i + 1].fd = this->mClients[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        int timeout = (deadline - now + 999) / 1000;
+        if (poll(fds.data(), fds.size(), timeout) <= 0)
+        {
+            continue;
+        }
+        // Walk backwards so dropping a client doesn't shift unvisited entries
+        for (int i = this->mClients.size() - 1; i >= 0; i --)
+        {
+            if (fds[i + 1].revents && !this->readInputs(this->mClients[i]))
+            {
+                this->dropClient(i);
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            this->acceptClients();
+        }
+    }
+}
+
+void ArenaServer::reportStats(long long now)
+{
+    if (now - this->mStatsStart < 1000000)
+    {
+        return;
+    }
+    double seconds = (now - this->mStatsStart) / 1e6;
+    int ticks = this->mTicks > 0 ? this->mTicks : 1;
+    std::cout << "tick " << this->mArena.getTick()
+              << " | " << this->mTicks / seconds << " ticks/s"
+              << " | clients " << this->mClients.size()
+              << " | snakes " << this->mArena.getNumSnakes()
+              << " | step " << this->mStepTime / ticks << " us"
+              << " | broadcast " << this->mBroadcastTime / ticks << " us"
+              << " | " << this->mBytesSent / seconds / 1e6 << " MB/s"
+              << " | skipped " << this->mSkippedFrames
+              << std::endl;
+    this->mStatsStart = now;
+    this->mTicks = 0;
+    this->mStepTime = 0;
+    this->mBroadcastTime = 0;
+    this->mBytesSent = 0;
+    this->mSkippedFrames = 0;
+}
+
+bool ArenaServer::run()
+{
+    if (!isArenaSize(this->mArena.getWidth(), this->mArena.getHeight()))
+    {
+        std::cerr << "Cannot host a " << this->mArena.getWidth() << "x" << this->mArena.getHeight()
+                  << " arena, it takes up to " << MaxBoardSize << " cells a side and " << MaxArenaCells << " in all" << std::endl;
+        return false;
+    }
+    raiseFileLimit();
+    this->mListenFd = listenTcp(this->mPort);
+    if (this->mListenFd < 0)
+    {
+        std::cerr << "Cannot listen on port " << this->mPort << std::endl;
+        return false;
+    }
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cout << "Arena " << this->mArena.getWidth() << "x" << this->mArena.getHeight()
+              << " listening on 127.0.0.1:" << this->mPort << std::endl;
+
+    long long period = 1000000 / this->mTicksPerSecond;
+    long long deadline = nowMicroseconds() + period;
+    this->mStatsStart = nowMicroseconds();
+    while (!gStopServer)
+    {
+        this->waitForTick(deadline);
+        long long start = nowMicroseconds();
+        this->applyTurns();
+        this->mArena.step();
+        long long stepped = nowMicroseconds();
+        this->broadcast();
+        long long done = nowMicroseconds();
+
+        this->mStepTime += stepped - start;
+        this->mBroadcastTime += done - stepped;
+        this->mTicks ++;
+        this->reportStats(done);
+        // Late ticks run back to back instead of piling up forever
+        deadline += period;
+        if (deadline < done - period)
+        {
+            deadline = done;
+        }
+    }
+    return true;
+}
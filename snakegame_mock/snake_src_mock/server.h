@@ -0,0 +1,68 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+
+// Authoritative multiplayer server.
+// Runs the Arena at a fixed tick rate, takes turns from every connected
+// client and broadcasts the result of each tick to all of them.
+class ArenaServer
+{
+public:
+    // A seed of 0 seeds from the clock
+    ArenaServer(int port, int gameBoardWidth, int gameBoardHeight, int ticksPerSecond, int initialSnakeLength = 2, unsigned int seed = 0);
+    ~ArenaServer();
+
+    bool run();
+
+private:
+    struct Client
+    {
+        int fd;
+        int slot;
+        // Turns wait here and are applied one per tick, in order
+        std::deque<std::pair<Direction, uint16_t>> turns;
+        std::vector<unsigned char> input;
+        uint16_t lastTurn;
+        // Bytes of the last frame the socket didn't take yet
+        std::vector<unsigned char> pending;
+        size_t sent;
+        bool needsKeyframe;
+    };
+
+    void acceptClients();
+    bool readInputs(Client& client);
+    bool flushPending(Client& client);
+    void sendFrame(Client& client, const std::vector<unsigned char>& frame);
+    void applyTurns();
+    void broadcast();
+    void dropClient(int index);
+    void waitForTick(long long deadline);
+    void reportStats(long long now);
+
+    const int mPort;
+    const int mTicksPerSecond;
+    // Everyone gets the full board every few seconds
+    const int mKeyframeInterval = 100;
+    const int mMaxQueuedTurns = 8;
+    int mListenFd = -1;
+    Arena mArena;
+    std::vector<Client> mClients;
+    std::vector<unsigned char> mTickFrame;
+    std::vector<unsigned char> mKeyframe;
+    std::vector<unsigned char> mScratch;
+    // Per second statistics printed while running
+    long long mStatsStart = 0;
+    long long mStepTime = 0;
+    long long mBroadcastTime = 0;
+    long long mBytesSent = 0;
+    int mTicks = 0;
+    int mSkippedFrames = 0;
+};
+
+#endif
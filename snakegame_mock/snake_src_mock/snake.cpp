@@ -6,32 +6,23 @@
 #include "snake.h"
 
 
-SnakeBody::SnakeBody()
+Snake::Snake(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength): mGameBoardWidth(gameBoardWidth), mGameBoardHeight(gameBoardHeight), mStartX(gameBoardWidth / 2), mStartY(gameBoardHeight / 2), mInitialSnakeLength(initialSnakeLength)
 {
+    this->initializeSnake();
+    this->setRandomSeed();
 }
 
-SnakeBody::SnakeBody(int x, int y): mX(x), mY(y)
-{
-}
-
-int SnakeBody::getX() const
-{
-    return mX;
-}
-
-int SnakeBody::getY() const
-{
-    return mY;
-}
-
-bool SnakeBody::operator == (const SnakeBody& snakeBody)
+// Used by the arena, which owns the random generator, so the seed is left alone
+Snake::Snake(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength, int startX, int startY): mGameBoardWidth(gameBoardWidth), mGameBoardHeight(gameBoardHeight), mStartX(startX), mStartY(startY), mInitialSnakeLength(initialSnakeLength)
 {
-    // TODO overload the == operator for SnakeBody comparision.
-    return this->getX() == snakeBody.getX() && this->getY() == snakeBody.getY();
+    this->initializeSnake();
 }
 
-Snake::Snake(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength): mGameBoardWidth(gameBoardWidth), mGameBoardHeight(gameBoardHeight), mInitialSnakeLength(initialSnakeLength)
+// Reserving the whole board means growing never reallocates,
+// so a running game doesn't touch memory again
+Snake::Snake(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength, std::pmr::memory_resource* memory, int reservedLength): mGameBoardWidth(gameBoardWidth), mGameBoardHeight(gameBoardHeight), mStartX(gameBoardWidth / 2), mStartY(gameBoardHeight / 2), mInitialSnakeLength(initialSnakeLength), mSnake(memory)
 {
+    this->mSnake.reserve(reservedLength);
     this->initializeSnake();
     this->setRandomSeed();
 }
@@ -46,8 +37,8 @@ void Snake::initializeSnake()
 {
     // Instead of using a random initialization algorithm ߳ʼλм
     // We always put the snake at the center of the game mWindows
-    int centerX = this->mGameBoardWidth / 2;
-    int centerY = this->mGameBoardHeight / 2;
+    int centerX = this->mStartX;
+    int centerY = this->mStartY;
 
     //м
     for (int i = 0; i < this->mInitialSnakeLength; i ++)
@@ -61,8 +52,9 @@ void Snake::initializeSnake()
 bool Snake::isPartOfSnake(int x, int y)
 {
     // TODO check if a given point with axis x, y is on the body of the snake.
+    SnakeBody cell(x, y);
     for (int i = 0; i < this->getSnake().size(); i++) {
-        if (this->getSnake()[i] == SnakeBody(x, y))
+        if (this->getSnake()[i] == cell)
             return true;
     }
     return false;
@@ -75,6 +67,10 @@ bool Snake::isPartOfSnake(int x, int y)
 bool Snake::hitWall()
 {
     // TODO check if the snake has hit the wall
+    if (this->mWrap)
+    {
+        return false;
+    }
     int headX = this->getSnake()[0].getX(), headY = this->getSnake()[0].getY();
 
     switch (this->mDirection) {
@@ -100,23 +96,8 @@ bool Snake::hitWall()
 bool Snake::hitSelf()
 {
     // TODO check if the snake has hit itself.
-    int headX = this->mSnake[0].getX(), headY = this->mSnake[0].getY();
-
-    switch (this->mDirection) {
-        case Direction::Up:
-            if (this->isPartOfSnake(headX, headY - 1)) return true;
-            break;
-        case Direction::Down:
-            if (this->isPartOfSnake(headX, headY + 1)) return true;
-            break;
-        case Direction::Left:
-            if (this->isPartOfSnake(headX - 1, headY)) return true;
-            break;
-        case Direction::Right:
-            if (this->isPartOfSnake(headX + 1, headY)) return true;
-            break;
-    }
-    return false;
+    SnakeBody newHead = this->nextHead();
+    return this->isPartOfSnake(newHead.getX(), newHead.getY());
 }
 
 //ͷһǷʳ
@@ -141,7 +122,7 @@ void Snake::senseFood(SnakeBody food) //
 }
 
 //ش
-std::vector<SnakeBody>& Snake::getSnake()
+SnakeBodies& Snake::getSnake()
 {
     return this->mSnake;
 }
@@ -160,7 +141,11 @@ bool Snake::changeDirection(Direction newDirection)
                 case Direction::Left:
                 case Direction::Right:
                     this->mDirection = newDirection;
+                    return true;
+                default:
+                    break;
             }
+            break;
         }
         case Direction::Down:
         {
@@ -170,7 +155,11 @@ bool Snake::changeDirection(Direction newDirection)
                 case Direction::Left:
                 case Direction::Right:
                     this->mDirection = newDirection;
+                    return true;
+                default:
+                    break;
             }
+            break;
         }
         case Direction::Left:
         {
@@ -180,7 +169,11 @@ bool Snake::changeDirection(Direction newDirection)
                 case Direction::Up:
                 case Direction::Down:
                     this->mDirection = newDirection;
+                    return true;
+                default:
+                    break;
             }
+            break;
         }
         case Direction::Right:
         {
@@ -190,7 +183,11 @@ bool Snake::changeDirection(Direction newDirection)
                 case Direction::Up:
                 case Direction::Down:
                     this->mDirection = newDirection;
+                    return true;
+                default:
+                    break;
             }
+            break;
         }
     }
 
@@ -206,27 +203,23 @@ SnakeBody Snake::createNewHead()
     * add the new head according to the direction
     * return the new head
     */
-    int headX = this->mSnake[0].getX(), headY = this->mSnake[0].getY();
-
-    switch (this->mDirection) {
-        case Direction::Up:
-            this->mSnake.insert(mSnake.begin(), SnakeBody(headX, headY - 1));
-            break;
-        case Direction::Down:
-            this->mSnake.insert(mSnake.begin(), SnakeBody(headX, headY + 1));
-            break;
-        case Direction::Left:
-            this->mSnake.insert(mSnake.begin(), SnakeBody(headX - 1, headY));
-            break;
-        case Direction::Right:
-            this->mSnake.insert(mSnake.begin(), SnakeBody(headX + 1, headY));
-            break;
-    }
+    this->mSnake.insert(mSnake.begin(), this->nextHead());
 
     SnakeBody newHead = this->mSnake[0];
     return newHead;
 }
 
+// Position the head would take on the next step, without moving the snake
+SnakeBody Snake::nextHead()
+{
+    SnakeBody newHead = stepCell(this->mSnake[0], this->mDirection);
+    if (this->mWrap)
+    {
+        newHead = wrapCell(newHead, this->mGameBoardWidth, this->mGameBoardHeight);
+    }
+    return newHead;
+}
+
 /*
  * If eat food, return true, otherwise return false
  */
@@ -267,3 +260,14 @@ Direction Snake::getDirection()
 {
     return this->mDirection;
 }
+
+// Overwrite the direction without the turning rules, used when restoring state
+void Snake::setDirection(Direction direction)
+{
+    this->mDirection = direction;
+}
+
+void Snake::setWrap(bool wrap)
+{
+    this->mWrap = wrap;
+}
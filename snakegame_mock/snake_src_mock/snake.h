@@ -2,6 +2,8 @@
 #define SNAKE_H
 
 #include <vector>
+#include <memory_resource>
+#include <cstdint>
 
 enum class Direction
 {
@@ -11,25 +13,112 @@ enum class Direction
     Right = 3,
 };
 
+// A board cell packed into one integer, x in the low and y in the high
+// 16 bits. Both are signed, so boards go up to 32767 cells a side.
+constexpr int MaxBoardSize = 32767;
+
+constexpr uint32_t packCell(int x, int y)
+{
+    return static_cast<uint16_t>(x) | static_cast<uint32_t>(static_cast<uint16_t>(y)) << 16;
+}
+
+constexpr int cellX(uint32_t cell)
+{
+    return static_cast<int16_t>(cell & 0xffff);
+}
+
+constexpr int cellY(uint32_t cell)
+{
+    return static_cast<int16_t>(cell >> 16);
+}
+
+// Four bytes per segment, comparing two is a single integer compare
 class SnakeBody
 {
 public:
-    SnakeBody();
-    SnakeBody(int x, int y);
-    int getX() const;
-    int getY() const;
-    bool operator == (const SnakeBody& snakeBody);
+    constexpr SnakeBody();
+    constexpr SnakeBody(int x, int y);
+    constexpr int getX() const;
+    constexpr int getY() const;
+    constexpr uint32_t getCell() const;
+    constexpr bool operator == (const SnakeBody& snakeBody) const;
+    constexpr bool operator != (const SnakeBody& snakeBody) const;
 private:
-    int mX;
-    int mY;
+    uint32_t mCell;
 };
 
+constexpr SnakeBody::SnakeBody(): mCell(0)
+{
+}
+
+constexpr SnakeBody::SnakeBody(int x, int y): mCell(packCell(x, y))
+{
+}
+
+constexpr int SnakeBody::getX() const
+{
+    return cellX(this->mCell);
+}
+
+constexpr int SnakeBody::getY() const
+{
+    return cellY(this->mCell);
+}
+
+constexpr uint32_t SnakeBody::getCell() const
+{
+    return this->mCell;
+}
+
+constexpr bool SnakeBody::operator == (const SnakeBody& snakeBody) const
+{
+    return this->mCell == snakeBody.mCell;
+}
+
+constexpr bool SnakeBody::operator != (const SnakeBody& snakeBody) const
+{
+    return this->mCell != snakeBody.mCell;
+}
+
+// The cell next to cell in direction
+constexpr SnakeBody stepCell(SnakeBody cell, Direction direction)
+{
+    return direction == Direction::Up ? SnakeBody(cell.getX(), cell.getY() - 1)
+        : direction == Direction::Down ? SnakeBody(cell.getX(), cell.getY() + 1)
+        : direction == Direction::Left ? SnakeBody(cell.getX() - 1, cell.getY())
+        : SnakeBody(cell.getX() + 1, cell.getY());
+}
+
+// A cell stepped off the inside of a width x height board that wraps
+// around, moved back in at the other edge. Compares instead of a %.
+constexpr SnakeBody wrapCell(SnakeBody cell, int width, int height)
+{
+    return SnakeBody(cell.getX() + (cell.getX() < 1) * (width - 2) - (cell.getX() > width - 2) * (width - 2),
+        cell.getY() + (cell.getY() < 1) * (height - 2) - (cell.getY() > height - 2) * (height - 2));
+}
+
+// Which way to go from a cell to the one next to it. Cells further apart
+// than that are next to each other across the edge of a wrapping board.
+constexpr Direction stepDirection(SnakeBody from, SnakeBody to)
+{
+    return to.getY() != from.getY() ? ((to.getY() < from.getY()) == (to.getY() - from.getY() >= -1 && to.getY() - from.getY() <= 1) ? Direction::Up : Direction::Down)
+        : ((to.getX() < from.getX()) == (to.getX() - from.getX() >= -1 && to.getX() - from.getX() <= 1) ? Direction::Left : Direction::Right);
+}
+
+// Body cells, head first. The allocator is polymorphic so a game can keep
+// its snake in memory of its own, everyone else gets the normal heap.
+typedef std::pmr::vector<SnakeBody> SnakeBodies;
+
 // Snake class should have no depency on the GUI library
 class Snake
 {
 public:
     //Snake();
     Snake(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength);
+    // Place the head at (startX, startY) with the body trailing below it
+    Snake(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength, int startX, int startY);
+    // Room for reservedLength segments is taken from memory up front
+    Snake(int gameBoardWidth, int gameBoardHeight, int initialSnakeLength, std::pmr::memory_resource* memory, int reservedLength);
     // Set random seed
     void setRandomSeed();
     // Initialize snake
@@ -44,9 +133,13 @@ public:
     bool checkCollision();
 
     bool changeDirection(Direction newDirection);
-    std::vector<SnakeBody>& getSnake();
+    void setDirection(Direction direction);
+    // The head goes off one edge and comes back in at the other instead of hitting the wall
+    void setWrap(bool wrap);
+    SnakeBodies& getSnake();
     int getLength();
     SnakeBody createNewHead();
+    SnakeBody nextHead();
     bool moveFoward();
 
     Direction getDirection();
@@ -54,11 +147,14 @@ public:
 private:
     const int mGameBoardWidth;
     const int mGameBoardHeight;
+    const int mStartX;
+    const int mStartY;
     // Snake information
     const int mInitialSnakeLength; //ʼ߳
     Direction mDirection; //ж
+    bool mWrap = false;
     SnakeBody mFood; //ˢ³ʳ
-    std::vector<SnakeBody> mSnake; //ߵÿ岿ֵ
+    SnakeBodies mSnake; //ߵÿ岿ֵ
 };
 
 #endif
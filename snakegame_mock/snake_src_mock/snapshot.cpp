@@ -0,0 +1,204 @@
+#include <sstream>
+#include <algorithm>
+#include <string>
+
+#include "snapshot.h"
+#include "bitstream.h"
+
+namespace
+{
+
+const unsigned char Magic[4] = {'S', 'N', 'K', 'S'};
+const int HeaderSize = 13;
+// More state words than any std::mt19937 has
+const uint32_t MaxRandomWords = 1024;
+
+void putU32(unsigned char* out, uint32_t value)
+{
+    for (int i = 0; i < 4; i ++)
+    {
+        out[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+uint32_t getU32(const unsigned char* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// FNV-1a, enough to notice a damaged file
+uint32_t checksum(const unsigned char* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i ++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Cells inside the walls of a world
+bool insideWorld(const GameSnapshot& snapshot, SnakeBody cell)
+{
+    return cell.getX() >= 1 && cell.getY() >= 1 && cell.getX() < snapshot.worldWidth - 1 && cell.getY() < snapshot.worldHeight - 1;
+}
+
+uint32_t cellIndex(const GameSnapshot& snapshot, SnakeBody cell)
+{
+    return static_cast<uint32_t>(cell.getY()) * snapshot.worldWidth + cell.getX();
+}
+
+bool readCell(BitReader& reader, const GameSnapshot& snapshot, SnakeBody& cell)
+{
+    uint32_t index = reader.readVarint();
+    cell = SnakeBody(index % snapshot.worldWidth, index / snapshot.worldWidth);
+    return reader.ok() && index / snapshot.worldWidth < static_cast<uint32_t>(snapshot.worldHeight) && insideWorld(snapshot, cell);
+}
+
+}
+
+void encodeSnapshot(std::vector<unsigned char>& out, const GameSnapshot& snapshot)
+{
+    size_t start = out.size();
+    out.insert(out.end(), Magic, Magic + 4);
+    out.push_back(SnapshotVersion);
+    out.resize(start + HeaderSize);
+
+    BitWriter writer(out);
+    writer.writeVarint(snapshot.worldWidth);
+    writer.writeVarint(snapshot.worldHeight);
+    writer.writeBits(snapshot.largeWorld ? 1 : 0, 1);
+    writer.writeBits(snapshot.wrap ? 1 : 0, 1);
+    writer.writeVarint(snapshot.points);
+    writer.writeVarint(snapshot.difficulty);
+    writer.writeBits(static_cast<uint32_t>(snapshot.direction), 2);
+    writer.writeVarint(snapshot.foods.size());
+    for (int i = 0; i < snapshot.foods.size(); i ++)
+    {
+        writer.writeVarint(cellIndex(snapshot, snapshot.foods[i].cell));
+        writer.writeVarint(snapshot.foods[i].value);
+        writer.writeVarint(snapshot.foods[i].ticksLeft);
+    }
+    const SnakeBodies& body = snapshot.body;
+    writer.writeVarint(body.size());
+    writer.writeVarint(cellIndex(snapshot, body[0]));
+    for (int i = 1; i < body.size(); i ++)
+    {
+        writer.writeBits(static_cast<uint32_t>(stepDirection(body[i - 1], body[i])), 2);
+    }
+    // The standard only promises the generator as text, a list of its state words
+    std::ostringstream text;
+    text << snapshot.random;
+    std::istringstream words(text.str());
+    std::vector<uint32_t> state;
+    uint32_t word;
+    while (words >> word)
+    {
+        state.push_back(word);
+    }
+    writer.writeVarint(state.size());
+    for (int i = 0; i < state.size(); i ++)
+    {
+        writer.writeBits(state[i], 32);
+    }
+    writer.flush();
+
+    uint32_t size = out.size() - start - HeaderSize;
+    putU32(&out[start + 5], size);
+    putU32(&out[start + 9], checksum(&out[start + HeaderSize], size));
+}
+
+bool decodeSnapshot(const unsigned char* data, size_t size, GameSnapshot& snapshot)
+{
+    int version = size < HeaderSize ? 0 : data[4];
+    if (size < HeaderSize || !std::equal(Magic, Magic + 4, data) || version < 1 || version > SnapshotVersion)
+    {
+        return false;
+    }
+    uint32_t payloadSize = getU32(data + 5);
+    if (payloadSize != size - HeaderSize || getU32(data + 9) != checksum(data + HeaderSize, payloadSize))
+    {
+        return false;
+    }
+
+    BitReader reader(data + HeaderSize, payloadSize);
+    GameSnapshot loaded;
+    loaded.worldWidth = reader.readVarint();
+    loaded.worldHeight = reader.readVarint();
+    loaded.largeWorld = reader.readBits(1);
+    loaded.wrap = version >= 3 && reader.readBits(1);
+    loaded.points = reader.readVarint();
+    loaded.difficulty = reader.readVarint();
+    loaded.direction = static_cast<Direction>(reader.readBits(2));
+    if (!reader.ok() || loaded.worldWidth < 3 || loaded.worldHeight < 3 || loaded.worldWidth > MaxBoardSize || loaded.worldHeight > MaxBoardSize
+        || loaded.points < 0 || loaded.difficulty < 0)
+    {
+        return false;
+    }
+    uint32_t cells = static_cast<uint32_t>(loaded.worldWidth - 2) * (loaded.worldHeight - 2);
+    // Version 1 had one food, worth a point and there for good
+    uint32_t numFoods = version == 1 ? 1 : reader.readVarint();
+    // A food takes a byte at least, a segment after the head two bits and a state word 32
+    if (!reader.ok() || numFoods > cells || numFoods > reader.bitsLeft() / 8)
+    {
+        return false;
+    }
+    loaded.foods.resize(numFoods);
+    for (uint32_t i = 0; i < numFoods; i ++)
+    {
+        SavedFood& food = loaded.foods[i];
+        if (!readCell(reader, loaded, food.cell))
+        {
+            return false;
+        }
+        if (version > 1)
+        {
+            food.value = reader.readVarint();
+            food.ticksLeft = reader.readVarint();
+            if (!reader.ok() || food.value < 1 || food.ticksLeft < 0)
+            {
+                return false;
+            }
+        }
+    }
+    uint32_t length = reader.readVarint();
+    SnakeBody head;
+    if (!reader.ok() || length == 0 || length > cells || length - 1 > reader.bitsLeft() / 2 || !readCell(reader, loaded, head))
+    {
+        return false;
+    }
+    loaded.body.resize(length);
+    loaded.body[0] = head;
+    for (uint32_t i = 1; i < length; i ++)
+    {
+        loaded.body[i] = stepCell(loaded.body[i - 1], static_cast<Direction>(reader.readBits(2)));
+        if (loaded.wrap)
+        {
+            loaded.body[i] = wrapCell(loaded.body[i], loaded.worldWidth, loaded.worldHeight);
+        }
+        if (!insideWorld(loaded, loaded.body[i]))
+        {
+            return false;
+        }
+    }
+
+    uint32_t numWords = reader.readVarint();
+    if (!reader.ok() || numWords > MaxRandomWords || numWords > reader.bitsLeft() / 32)
+    {
+        return false;
+    }
+    std::string text;
+    for (uint32_t i = 0; i < numWords; i ++)
+    {
+        text += std::to_string(reader.readBits(32));
+        text += ' ';
+    }
+    std::istringstream words(text);
+    words >> loaded.random;
+    if (words.fail() || !reader.done())
+    {
+        return false;
+    }
+    snapshot = std::move(loaded);
+    return true;
+}
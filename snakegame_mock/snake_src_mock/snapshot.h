@@ -0,0 +1,49 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <vector>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+
+#include "snake.h"
+
+// Ticks left is 0 for food that stays
+struct SavedFood
+{
+    SnakeBody cell;
+    int value = 1;
+    int ticksLeft = 0;
+};
+
+// Everything a single player game needs to go on where it stopped
+struct GameSnapshot
+{
+    int worldWidth = 0;
+    int worldHeight = 0;
+    bool largeWorld = false;
+    // The world wraps around at the edges
+    bool wrap = false;
+    int points = 0;
+    int difficulty = 0;
+    Direction direction = Direction::Up;
+    std::vector<SavedFood> foods;
+    // Head first, like Snake::getSnake
+    SnakeBodies body;
+    std::mt19937 random;
+};
+
+// A save file is "SNKS", [u8 version][u32 size][u32 FNV-1a of the rest] and then size bytes bit packed
+// (see bitstream.h): world size, big world and wrap flags, points, difficulty, heading,
+// the number of foods and for each its cell, value and ticks left, body length,
+// the head cell and a 2 bit step from each segment to the next, and last the
+// random generator's state words. The numbers in the header are little endian.
+// A board full of snake takes a quarter byte per cell. Version 1 files, with a
+// single food cell, and version 2 files, without the wrap flag, still load.
+const int SnapshotVersion = 3;
+
+void encodeSnapshot(std::vector<unsigned char>& out, const GameSnapshot& snapshot);
+// false if the data is not a snapshot of this version or doesn't make sense
+bool decodeSnapshot(const unsigned char* data, size_t size, GameSnapshot& snapshot);
+
+#endif
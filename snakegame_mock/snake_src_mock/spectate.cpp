@@ -0,0 +1,317 @@
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "spectate.h"
+
+namespace
+{
+
+const uint32_t BroadcastMagic = 0x534e4b42;
+const uint32_t NumFrameSlots = 8;
+// What RingHeader::closed says
+const uint32_t RingOpen = 0;
+const uint32_t RingClosed = 1;
+// A ring of another size took over the name, see FramePublisher::reopen
+const uint32_t RingReplaced = 2;
+
+struct RingHeader
+{
+    uint32_t magic;
+    uint32_t width;
+    uint32_t height;
+    uint32_t slotSize;
+    std::atomic<uint64_t> latest;
+    std::atomic<uint32_t> closed;
+};
+
+// Odd sequence numbers mark a slot that is being written
+struct SlotHeader
+{
+    std::atomic<uint64_t> sequence;
+    uint64_t number;
+    int32_t points;
+    int32_t difficulty;
+    uint32_t food;
+    uint32_t length;
+};
+
+size_t alignedSize(size_t size)
+{
+    return (size + 63) / 64 * 64;
+}
+
+size_t slotSize(uint32_t width, uint32_t height)
+{
+    return alignedSize(sizeof(SlotHeader) + sizeof(uint32_t) * width * height);
+}
+
+std::string sharedName(const std::string& name)
+{
+    return "/snakegame-" + name;
+}
+
+RingHeader* ringOf(unsigned char* memory)
+{
+    return reinterpret_cast<RingHeader*>(memory);
+}
+
+SlotHeader* slotOf(unsigned char* memory, uint64_t frame)
+{
+    RingHeader* ring = ringOf(memory);
+    return reinterpret_cast<SlotHeader*>(memory + alignedSize(sizeof(RingHeader)) + (frame % NumFrameSlots) * ring->slotSize);
+}
+
+}
+
+FramePublisher::FramePublisher()
+{
+}
+
+FramePublisher::~FramePublisher()
+{
+    this->close();
+}
+
+bool FramePublisher::open(const std::string& name, int gameBoardWidth, int gameBoardHeight)
+{
+    this->close();
+    this->mName = sharedName(name);
+    return this->create(gameBoardWidth, gameBoardHeight);
+}
+
+bool FramePublisher::reopen(int gameBoardWidth, int gameBoardHeight)
+{
+    unsigned char* previous = this->mMemory;
+    size_t previousSize = this->mSize;
+    // Attached viewers keep their mapping of the old ring while the name goes to the new one
+    this->mMemory = nullptr;
+    shm_unlink(this->mName.c_str());
+    bool created = this->create(gameBoardWidth, gameBoardHeight);
+    if (previous)
+    {
+        ringOf(previous)->closed.store(created ? RingReplaced : RingClosed, std::memory_order_release);
+        munmap(previous, previousSize);
+    }
+    return created;
+}
+
+bool FramePublisher::create(int gameBoardWidth, int gameBoardHeight)
+{
+    this->mSize = alignedSize(sizeof(RingHeader)) + NumFrameSlots * slotSize(gameBoardWidth, gameBoardHeight);
+    int fd = shm_open(this->mName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (ftruncate(fd, this->mSize) < 0)
+    {
+        ::close(fd);
+        shm_unlink(this->mName.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, this->mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(this->mName.c_str());
+        return false;
+    }
+    this->mMemory = static_cast<unsigned char*>(memory);
+
+    RingHeader* ring = new (this->mMemory) RingHeader;
+    ring->width = gameBoardWidth;
+    ring->height = gameBoardHeight;
+    ring->slotSize = slotSize(gameBoardWidth, gameBoardHeight);
+    ring->latest.store(0);
+    ring->closed.store(RingOpen);
+    for (uint64_t i = 0; i < NumFrameSlots; i ++)
+    {
+        new (slotOf(this->mMemory, i)) SlotHeader;
+        slotOf(this->mMemory, i)->sequence.store(0);
+    }
+    // Readers check the magic last, once everything else is in place
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->magic = BroadcastMagic;
+    return true;
+}
+
+void FramePublisher::publish(const SnakeBodies& snake, SnakeBody food, int points, int difficulty)
+{
+    this->beginFrame(food, points, difficulty);
+    for (int i = 0; i < snake.size(); i ++)
+    {
+        this->addCell(snake[i]);
+    }
+    this->endFrame();
+}
+
+void FramePublisher::beginFrame(SnakeBody food, int points, int difficulty)
+{
+    if (!this->mMemory)
+    {
+        return;
+    }
+    RingHeader* ring = ringOf(this->mMemory);
+    SlotHeader* slot = slotOf(this->mMemory, this->mNextFrame);
+    uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->number = this->mNextFrame;
+    slot->points = points;
+    slot->difficulty = difficulty;
+    // Cell 0 is in the wall, the viewer shows no food there
+    bool inside = food.getX() >= 0 && food.getY() >= 0 && food.getX() < int(ring->width) && food.getY() < int(ring->height);
+    slot->food = inside ? food.getY() * ring->width + food.getX() : 0;
+    slot->length = 0;
+}
+
+void FramePublisher::addCell(SnakeBody cell)
+{
+    if (!this->mMemory)
+    {
+        return;
+    }
+    RingHeader* ring = ringOf(this->mMemory);
+    SlotHeader* slot = slotOf(this->mMemory, this->mNextFrame);
+    uint32_t* cells = reinterpret_cast<uint32_t*>(slot + 1);
+    if (cell.getX() < 0 || cell.getY() < 0 || cell.getX() >= int(ring->width) || cell.getY() >= int(ring->height) || slot->length >= ring->width * ring->height)
+    {
+        return;
+    }
+    cells[slot->length ++] = cell.getY() * ring->width + cell.getX();
+}
+
+void FramePublisher::endFrame()
+{
+    if (!this->mMemory)
+    {
+        return;
+    }
+    RingHeader* ring = ringOf(this->mMemory);
+    SlotHeader* slot = slotOf(this->mMemory, this->mNextFrame);
+    slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    ring->latest.store(this->mNextFrame ++, std::memory_order_release);
+}
+
+void FramePublisher::close()
+{
+    if (!this->mMemory)
+    {
+        return;
+    }
+    ringOf(this->mMemory)->closed.store(RingClosed, std::memory_order_release);
+    munmap(this->mMemory, this->mSize);
+    // Attached viewers keep their mapping, new ones can't find the game any more
+    shm_unlink(this->mName.c_str());
+    this->mMemory = nullptr;
+}
+
+FrameSubscriber::FrameSubscriber()
+{
+}
+
+FrameSubscriber::~FrameSubscriber()
+{
+    if (this->mMemory)
+    {
+        munmap(this->mMemory, this->mSize);
+    }
+}
+
+bool FrameSubscriber::attach(const std::string& name)
+{
+    if (this->mMemory)
+    {
+        munmap(this->mMemory, this->mSize);
+        this->mMemory = nullptr;
+    }
+    int fd = shm_open(sharedName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < alignedSize(sizeof(RingHeader)))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+    RingHeader* ring = static_cast<RingHeader*>(memory);
+    if (ring->magic != BroadcastMagic || info.st_size < alignedSize(sizeof(RingHeader)) + NumFrameSlots * slotSize(ring->width, ring->height))
+    {
+        munmap(memory, info.st_size);
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    this->mMemory = static_cast<unsigned char*>(memory);
+    this->mSize = info.st_size;
+    return true;
+}
+
+bool FrameSubscriber::readLatest(SpectatorFrame& frame)
+{
+    RingHeader* ring = ringOf(this->mMemory);
+    uint32_t capacity = ring->width * ring->height;
+    // A torn copy means the writer lapped us, go again for the newer frame
+    for (int attempt = 0; attempt < 4; attempt ++)
+    {
+        uint64_t latest = ring->latest.load(std::memory_order_acquire);
+        if (latest <= this->mLastFrame)
+        {
+            return false;
+        }
+        SlotHeader* slot = slotOf(this->mMemory, latest);
+        const uint32_t* cells = reinterpret_cast<const uint32_t*>(slot + 1);
+        uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        frame.number = slot->number;
+        frame.width = ring->width;
+        frame.height = ring->height;
+        frame.points = slot->points;
+        frame.difficulty = slot->difficulty;
+        uint32_t food = slot->food;
+        uint32_t length = std::min(slot->length, capacity);
+        frame.snake.resize(length);
+        for (uint32_t i = 0; i < length; i ++)
+        {
+            uint32_t cell = cells[i] < capacity ? cells[i] : 0;
+            frame.snake[i] = SnakeBody(cell % ring->width, cell / ring->width);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) != before || frame.number <= this->mLastFrame)
+        {
+            continue;
+        }
+        food = food < capacity ? food : 0;
+        frame.food = SnakeBody(food % ring->width, food / ring->width);
+        this->mLastFrame = frame.number;
+        return true;
+    }
+    return false;
+}
+
+bool FrameSubscriber::isClosed() const
+{
+    return ringOf(this->mMemory)->closed.load(std::memory_order_acquire) == RingClosed;
+}
+
+bool FrameSubscriber::isReplaced() const
+{
+    return ringOf(this->mMemory)->closed.load(std::memory_order_acquire) == RingReplaced;
+}
@@ -0,0 +1,75 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "snake.h"
+
+// Live broadcast of a single player game to local viewers.
+// The player's Game writes every frame into a ring of slots in POSIX
+// shared memory. Each slot is guarded by a sequence number (a seqlock),
+// so readers never take a lock and never slow the writer down; a reader
+// always goes for the newest frame and simply skips the ones it missed.
+const std::string DefaultBroadcastName = "snakegame";
+
+struct SpectatorFrame
+{
+    uint64_t number = 0;
+    int width = 0;
+    int height = 0;
+    int points = 0;
+    int difficulty = 0;
+    SnakeBody food;
+    SnakeBodies snake;
+};
+
+class FramePublisher
+{
+public:
+    FramePublisher();
+    ~FramePublisher();
+
+    bool open(const std::string& name, int gameBoardWidth, int gameBoardHeight);
+    // A new board size under the same name, attached viewers move over to it
+    bool reopen(int gameBoardWidth, int gameBoardHeight);
+    void publish(const SnakeBodies& snake, SnakeBody food, int points, int difficulty);
+    // The same a cell at a time, for a frame that isn't kept as a list of
+    // cells. Cells and food outside the ring's board are left out.
+    void beginFrame(SnakeBody food, int points, int difficulty);
+    void addCell(SnakeBody cell);
+    void endFrame();
+    void close();
+
+private:
+    bool create(int gameBoardWidth, int gameBoardHeight);
+
+    std::string mName;
+    unsigned char* mMemory = nullptr;
+    size_t mSize = 0;
+    uint64_t mNextFrame = 1;
+};
+
+class FrameSubscriber
+{
+public:
+    FrameSubscriber();
+    ~FrameSubscriber();
+
+    bool attach(const std::string& name);
+    // True if a frame newer than the last one returned was copied out
+    bool readLatest(SpectatorFrame& frame);
+    // The player quit
+    bool isClosed() const;
+    // The player's board changed size, attach again to get the new one
+    bool isReplaced() const;
+
+private:
+    unsigned char* mMemory = nullptr;
+    size_t mSize = 0;
+    uint64_t mLastFrame = 0;
+};
+
+#endif
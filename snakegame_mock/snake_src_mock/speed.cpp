@@ -0,0 +1,105 @@
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "speed.h"
+
+bool loadSpeedCurve(const std::string& path, SpeedCurve& curve)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    SpeedCurve loaded;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string key;
+        if (!(words >> key))
+        {
+            continue;
+        }
+        if (key == "curve")
+        {
+            words >> loaded.shape;
+        }
+        else if (key == "base")
+        {
+            words >> loaded.baseDelay;
+        }
+        else if (key == "factor")
+        {
+            words >> loaded.factor;
+        }
+        else if (key == "step")
+        {
+            words >> loaded.levelsPerStep;
+        }
+        else if (key == "floor")
+        {
+            words >> loaded.minDelay;
+        }
+        else if (key == "delays")
+        {
+            int delay;
+            while (words >> delay)
+            {
+                loaded.delays.push_back(delay);
+            }
+            words.clear();
+        }
+        else
+        {
+            return false;
+        }
+        std::string rest;
+        if (words.fail() || words >> rest)
+        {
+            return false;
+        }
+    }
+    bool known = loaded.shape == "exponential" || loaded.shape == "linear" || loaded.shape == "stepped" || loaded.shape == "table";
+    if (!known || loaded.baseDelay < 0 || loaded.minDelay < 0 || loaded.levelsPerStep < 1 || (loaded.shape == "table" && loaded.delays.empty()))
+    {
+        return false;
+    }
+    curve = loaded;
+    return true;
+}
+
+SpeedSchedule::SpeedSchedule(): SpeedSchedule(SpeedCurve())
+{
+}
+
+SpeedSchedule::SpeedSchedule(const SpeedCurve& curve)
+{
+    for (int level = 0; level < NumLevels; level ++)
+    {
+        int delay;
+        if (curve.shape == "linear")
+        {
+            delay = static_cast<int>(curve.baseDelay - curve.factor * level);
+        }
+        else if (curve.shape == "stepped")
+        {
+            delay = static_cast<int>(curve.baseDelay * std::pow(curve.factor, level / curve.levelsPerStep));
+        }
+        else if (curve.shape == "table")
+        {
+            delay = curve.delays[std::min<int>(level, curve.delays.size() - 1)];
+        }
+        else
+        {
+            delay = static_cast<int>(curve.baseDelay * std::pow(curve.factor, level));
+        }
+        this->mDelays[level] = std::max(delay, curve.minDelay);
+    }
+}
+
+int SpeedSchedule::getDelay(int difficulty) const
+{
+    return this->mDelays[std::max(0, std::min(difficulty, NumLevels - 1))];
+}
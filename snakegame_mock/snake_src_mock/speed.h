@@ -0,0 +1,45 @@
+#ifndef SPEED_H
+#define SPEED_H
+
+#include <string>
+#include <vector>
+
+// How the delay between ticks falls as the difficulty goes up
+struct SpeedCurve
+{
+    // "exponential": base * factor ^ level
+    // "linear":      base - factor * level
+    // "stepped":     base * factor ^ (level / step)
+    // "table":       delays[level], the last one from then on
+    std::string shape = "exponential";
+    int baseDelay = 100;
+    double factor = 0.75;
+    int levelsPerStep = 1;
+    std::vector<int> delays;
+    // Never faster than this, or the top levels would spin without sleeping
+    int minDelay = 10;
+};
+
+// Reads "key value" lines: curve, base, factor, step, floor and delays,
+// the last one followed by any number of milliseconds. # starts a comment.
+// false if the file can't be read or has something else in it.
+bool loadSpeedCurve(const std::string& path, SpeedCurve& curve);
+
+// A curve worked out for every level up front, so the game only looks its
+// delay up when the difficulty changes
+class SpeedSchedule
+{
+public:
+    // Levels past this get the delay of the last one
+    static const int NumLevels = 64;
+
+    SpeedSchedule();
+    explicit SpeedSchedule(const SpeedCurve& curve);
+
+    int getDelay(int difficulty) const;
+
+private:
+    int mDelays[NumLevels];
+};
+
+#endif
@@ -0,0 +1,340 @@
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "stats.h"
+#include "net.h"
+
+namespace
+{
+
+// Room for the text of a few hundred threads
+const size_t StatsTextSize = 64 * 1024;
+
+// Every thread's counters, only touched when a thread asks for its own the first time and by readers
+std::mutex gRegistryMutex;
+
+std::vector<std::unique_ptr<StatsCounters>>& getRegistry()
+{
+    static std::vector<std::unique_ptr<StatsCounters>> registry;
+    return registry;
+}
+
+// Lines go in whole or not at all
+struct StatsText
+{
+    char* data;
+    size_t size;
+    size_t used;
+    // Once a line didn't fit, so no later line goes in out of place
+    bool full;
+
+    void line(const char* format, ...)
+    {
+        if (this->full)
+        {
+            return;
+        }
+        va_list arguments;
+        va_start(arguments, format);
+        int length = std::vsnprintf(this->data + this->used, this->size - this->used, format, arguments);
+        va_end(arguments);
+        this->full = length < 0 || this->used + length >= this->size;
+        this->used += this->full ? 0 : length;
+    }
+};
+
+struct StatInfo
+{
+    Stat stat;
+    const char* name;
+    const char* type;
+    const char* help;
+    // Highs are the largest of the threads, the rest their sum
+    bool highest;
+};
+
+const StatInfo Totals[] = {
+    {Stat::Games, "snake_games_total", "counter", "Games played to the end.", false},
+    {Stat::Points, "snake_points_total", "counter", "Points scored over all games.", false},
+    {Stat::Ticks, "snake_ticks_total", "counter", "Ticks survived over all games.", false},
+    {Stat::Inputs, "snake_inputs_total", "counter", "Keys that reached the snake.", false},
+    {Stat::FoodRetries, "snake_food_retries_total", "counter", "Cells tried and found taken while placing food.", false},
+    {Stat::BestPoints, "snake_best_points", "gauge", "Most points in one game.", true},
+    {Stat::LongestSnake, "snake_longest_snake", "gauge", "Longest snake of one game.", true},
+};
+
+const StatInfo Sessions[] = {
+    {Stat::SessionPoints, "snake_session_points", "gauge", "Points of the current or last game.", false},
+    {Stat::SessionLength, "snake_session_length", "gauge", "Length of the snake of the current or last game.", false},
+    {Stat::SessionTicks, "snake_session_ticks", "gauge", "Ticks survived in the current or last game.", false},
+    {Stat::SessionInputs, "snake_session_inputs", "gauge", "Keys that reached the snake in the current or last game.", false},
+    {Stat::SessionFoodRetries, "snake_session_food_retries", "gauge", "Cells tried and found taken while placing food in the current or last game.", false},
+};
+
+// Sends all of data, false if the client went away
+bool sendAll(int fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+}
+
+StatsCounters::StatsCounters()
+{
+    for (int i = 0; i < NumStats; i ++)
+    {
+        this->mValues[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+long long StatsCounters::get(Stat stat) const
+{
+    return this->mValues[static_cast<int>(stat)].load(std::memory_order_relaxed);
+}
+
+void StatsCounters::startSession(int length)
+{
+    this->set(Stat::SessionPoints, 0);
+    this->set(Stat::SessionLength, length);
+    this->set(Stat::SessionTicks, 0);
+    this->set(Stat::SessionTickNanoseconds, 0);
+    this->set(Stat::SessionInputs, 0);
+    this->set(Stat::SessionFoodRetries, 0);
+}
+
+void StatsCounters::endSession()
+{
+    this->add(Stat::Games, 1);
+    this->add(Stat::Points, this->get(Stat::SessionPoints));
+    this->raise(Stat::BestPoints, this->get(Stat::SessionPoints));
+    this->raise(Stat::LongestSnake, this->get(Stat::SessionLength));
+}
+
+void StatsCounters::countTick(long long nanoseconds)
+{
+    this->add(Stat::Ticks, 1);
+    this->add(Stat::TickNanoseconds, nanoseconds);
+    this->add(Stat::SessionTicks, 1);
+    this->add(Stat::SessionTickNanoseconds, nanoseconds);
+}
+
+void StatsCounters::countInput()
+{
+    this->add(Stat::Inputs, 1);
+    this->add(Stat::SessionInputs, 1);
+}
+
+void StatsCounters::countFoodRetries(int retries)
+{
+    this->add(Stat::FoodRetries, retries);
+    this->add(Stat::SessionFoodRetries, retries);
+}
+
+void StatsCounters::setPoints(int points)
+{
+    this->set(Stat::SessionPoints, points);
+}
+
+void StatsCounters::setLength(int length)
+{
+    this->set(Stat::SessionLength, length);
+}
+
+void StatsCounters::add(Stat stat, long long amount)
+{
+    std::atomic<long long>& value = this->mValues[static_cast<int>(stat)];
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+void StatsCounters::raise(Stat stat, long long value)
+{
+    if (value > this->get(stat))
+    {
+        this->set(stat, value);
+    }
+}
+
+void StatsCounters::set(Stat stat, long long value)
+{
+    this->mValues[static_cast<int>(stat)].store(value, std::memory_order_relaxed);
+}
+
+StatsCounters& threadStats()
+{
+    thread_local StatsCounters* counters = nullptr;
+    if (!counters)
+    {
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        getRegistry().emplace_back(new StatsCounters());
+        counters = getRegistry().back().get();
+    }
+    return *counters;
+}
+
+size_t formatStats(char* buffer, size_t size)
+{
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    const std::vector<std::unique_ptr<StatsCounters>>& registry = getRegistry();
+    StatsText text = {buffer, size, 0, size == 0};
+    for (int i = 0; i < sizeof(Totals) / sizeof(Totals[0]); i ++)
+    {
+        long long value = 0;
+        for (int j = 0; j < registry.size(); j ++)
+        {
+            long long own = registry[j]->get(Totals[i].stat);
+            value = Totals[i].highest ? std::max(value, own) : value + own;
+        }
+        text.line("# HELP %s %s\n# TYPE %s %s\n%s %lld\n", Totals[i].name, Totals[i].help, Totals[i].name, Totals[i].type, Totals[i].name, value);
+    }
+    long long tickNanoseconds = 0;
+    for (int j = 0; j < registry.size(); j ++)
+    {
+        tickNanoseconds += registry[j]->get(Stat::TickNanoseconds);
+    }
+    text.line("# HELP snake_tick_seconds_total Time spent in ticks over all games.\n# TYPE snake_tick_seconds_total counter\nsnake_tick_seconds_total %.9f\n", tickNanoseconds / 1e9);
+
+    for (int i = 0; i < sizeof(Sessions) / sizeof(Sessions[0]); i ++)
+    {
+        text.line("# HELP %s %s\n# TYPE %s %s\n", Sessions[i].name, Sessions[i].help, Sessions[i].name, Sessions[i].type);
+        for (int j = 0; j < registry.size(); j ++)
+        {
+            text.line("%s{thread=\"%d\"} %lld\n", Sessions[i].name, j, registry[j]->get(Sessions[i].stat));
+        }
+    }
+    text.line("# HELP snake_session_tick_seconds_average Average tick of the current or last game.\n# TYPE snake_session_tick_seconds_average gauge\n");
+    for (int j = 0; j < registry.size(); j ++)
+    {
+        long long ticks = registry[j]->get(Stat::SessionTicks);
+        long long nanoseconds = registry[j]->get(Stat::SessionTickNanoseconds);
+        text.line("snake_session_tick_seconds_average{thread=\"%d\"} %.9f\n", j, ticks > 0 ? nanoseconds / 1e9 / ticks : 0.0);
+    }
+    return text.used;
+}
+
+bool writeStatsFile(const std::string& path)
+{
+    std::vector<char> buffer(StatsTextSize);
+    size_t size = formatStats(buffer.data(), buffer.size());
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(buffer.data(), size))
+        {
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+StatsServer::StatsServer(): mStopping(false)
+{
+}
+
+StatsServer::~StatsServer()
+{
+    this->stop();
+}
+
+bool StatsServer::start(int port)
+{
+    this->stop();
+    this->mListenFd = listenTcp(port);
+    if (this->mListenFd < 0)
+    {
+        return false;
+    }
+    this->mBuffer.resize(StatsTextSize);
+    this->mStopping.store(false);
+    this->mThread = std::thread(&StatsServer::serve, this);
+    return true;
+}
+
+void StatsServer::stop()
+{
+    if (this->mThread.joinable())
+    {
+        this->mStopping.store(true);
+        this->mThread.join();
+    }
+    closeSocket(this->mListenFd);
+    this->mListenFd = -1;
+}
+
+// One client at a time, each gets an answer and the connection is closed
+void StatsServer::serve()
+{
+    while (!this->mStopping.load())
+    {
+        pollfd listener = {this->mListenFd, POLLIN, 0};
+        if (poll(&listener, 1, 100) <= 0)
+        {
+            continue;
+        }
+        int fd = accept(this->mListenFd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            continue;
+        }
+        this->answer(fd);
+        closeSocket(fd);
+    }
+}
+
+void StatsServer::answer(int fd)
+{
+    // A client that stalls is given up on instead of holding up the next scrape
+    timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    char request[1024];
+    size_t received = 0;
+    while (received < sizeof(request) - 1)
+    {
+        ssize_t got = recv(fd, request + received, sizeof(request) - 1 - received, 0);
+        if (got <= 0)
+        {
+            return;
+        }
+        received += got;
+        request[received] = '\0';
+        if (std::strstr(request, "\r\n\r\n"))
+        {
+            break;
+        }
+    }
+    request[received] = '\0';
+    bool found = std::strncmp(request, "GET /metrics ", 13) == 0 || std::strncmp(request, "GET / ", 6) == 0;
+    const char* body = "not found\n";
+    size_t size = std::strlen(body);
+    if (found)
+    {
+        body = this->mBuffer.data();
+        size = formatStats(this->mBuffer.data(), this->mBuffer.size());
+    }
+    char header[160];
+    int length = std::snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+        found ? "200 OK" : "404 Not Found", size);
+    if (sendAll(fd, header, length))
+    {
+        sendAll(fd, body, size);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstddef>
+
+// Numbers the single player game keeps about itself for dashboards.
+// Every thread that plays has counters of its own, which only it writes:
+// a tick changes them with relaxed loads and stores, no lock and no locked
+// instruction. Anyone may read them at any time and sees every counter
+// whole, though not all of them from the same tick.
+enum class Stat
+{
+    // Totals over every game, they only go up
+    Games,
+    Points,
+    Ticks,
+    TickNanoseconds,
+    Inputs,
+    FoodRetries,
+    // Highest yet
+    BestPoints,
+    LongestSnake,
+    // The game being played, or the last one until the next starts
+    SessionPoints,
+    SessionLength,
+    SessionTicks,
+    SessionTickNanoseconds,
+    SessionInputs,
+    SessionFoodRetries,
+};
+const int NumStats = 14;
+
+// A cache line of its own, so threads counting side by side don't slow each other down
+class alignas(64) StatsCounters
+{
+public:
+    StatsCounters();
+    StatsCounters(const StatsCounters&) = delete;
+    StatsCounters& operator = (const StatsCounters&) = delete;
+
+    long long get(Stat stat) const;
+
+    // The session counters start again, with a snake of length
+    void startSession(int length);
+    // The game's points and length go into the totals and highs
+    void endSession();
+    void countTick(long long nanoseconds);
+    void countInput();
+    // Random cells tried and found taken while placing a food
+    void countFoodRetries(int retries);
+    void setPoints(int points);
+    void setLength(int length);
+
+private:
+    // Only the owning thread calls these, so a plain load and store is enough
+    void add(Stat stat, long long amount);
+    void raise(Stat stat, long long value);
+    void set(Stat stat, long long value);
+
+    std::atomic<long long> mValues[NumStats];
+};
+
+// The calling thread's counters, made the first time it asks. They are kept
+// until the process ends, so a finished thread still counts in the totals.
+StatsCounters& threadStats();
+
+// Everything in the Prometheus text format: the totals and highs summed over
+// the threads, the sessions labelled with the thread. Writes as many whole
+// lines as fit in buffer and returns the bytes written, nothing is allocated.
+size_t formatStats(char* buffer, size_t size);
+// Written next to path and renamed over it, so a reader never sees half a file
+bool writeStatsFile(const std::string& path);
+
+// formatStats over HTTP on 127.0.0.1, for a dashboard to scrape /metrics.
+// It runs on a thread of its own and formats into a buffer made up front,
+// so a scrape neither allocates nor holds up the game.
+class StatsServer
+{
+public:
+    StatsServer();
+    ~StatsServer();
+
+    bool start(int port);
+    void stop();
+
+private:
+    void serve();
+    void answer(int fd);
+
+    int mListenFd = -1;
+    std::thread mThread;
+    std::atomic<bool> mStopping;
+    std::vector<char> mBuffer;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+
+#include "termout.h"
+
+namespace
+{
+
+const char BeginSynchronizedUpdate[] = "\x1b[?2026h";
+const char EndSynchronizedUpdate[] = "\x1b[?2026l";
+
+TerminalOutputStats gStats = {};
+
+winsize terminalSize()
+{
+    winsize size = {};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_col == 0 || size.ws_row == 0)
+    {
+        size.ws_col = 80;
+        size.ws_row = 24;
+    }
+    return size;
+}
+
+}
+
+void writeTerminalFrame(int fd, const char* data, size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    iovec parts[3] = {
+        {const_cast<char*>(BeginSynchronizedUpdate), sizeof(BeginSynchronizedUpdate) - 1},
+        {const_cast<char*>(data), size},
+        {const_cast<char*>(EndSynchronizedUpdate), sizeof(EndSynchronizedUpdate) - 1}};
+    gStats.frames ++;
+    gStats.frameBytes += parts[0].iov_len + size + parts[2].iov_len;
+    int first = 0;
+    // One write unless the terminal takes it in parts
+    while (first < 3)
+    {
+        ssize_t written = writev(fd, parts + first, 3 - first);
+        gStats.frameWrites ++;
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        while (first < 3 && size_t(written) >= parts[first].iov_len)
+        {
+            written -= parts[first].iov_len;
+            first ++;
+        }
+        if (first < 3)
+        {
+            parts[first].iov_base = static_cast<char*>(parts[first].iov_base) + written;
+            parts[first].iov_len -= written;
+        }
+    }
+}
+
+void writeTerminal(int fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        gStats.otherWrites ++;
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+int getTerminalWidth()
+{
+    return terminalSize().ws_col;
+}
+
+int getTerminalHeight()
+{
+    return terminalSize().ws_row;
+}
+
+TerminalOutputStats getTerminalOutputStats()
+{
+    return gStats;
+}
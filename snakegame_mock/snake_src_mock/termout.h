@@ -0,0 +1,31 @@
+#ifndef TERMOUT_H
+#define TERMOUT_H
+
+#include <cstddef>
+
+// What the renderers send to the terminal. Each puts a frame together on
+// its own and hands it over here once, at the end of present: it goes out
+// in a single write, wrapped in synchronized update marks so terminals that
+// know them paint the frame at once (the others ignore the marks).
+void writeTerminalFrame(int fd, const char* data, size_t size);
+// Anything else, start up and shutting down
+void writeTerminal(int fd, const char* data, size_t size);
+
+// The terminal's size, 80x24 when stdout isn't one
+int getTerminalWidth();
+int getTerminalHeight();
+
+struct TerminalOutputStats
+{
+    // Frames that changed the screen and the write calls it took to send them
+    long long frames;
+    long long frameWrites;
+    long long frameBytes;
+    // Terminal writes made outside of any frame, start up and shutting down
+    long long otherWrites;
+};
+
+// Counted on the thread that draws, read once it is done
+TerminalOutputStats getTerminalOutputStats();
+
+#endif
@@ -0,0 +1,113 @@
+#include <vector>
+
+#include "tiles.h"
+
+TileMap::TileMap(): mTiles(&mPool)
+{
+}
+
+TileMap::~TileMap()
+{
+    this->reset();
+}
+
+// Tiles and entries made and dropped again, the pool keeps their memory
+void TileMap::reserve(size_t numTiles)
+{
+    if (numTiles <= this->mTiles.size())
+    {
+        return;
+    }
+    this->mTiles.reserve(numTiles);
+    std::vector<uint64_t> added;
+    for (uint64_t key = 0; this->mTiles.size() < numTiles; key ++)
+    {
+        Tile*& tile = this->mTiles[key];
+        if (!tile)
+        {
+            tile = new (this->mPool.allocate(sizeof(Tile), alignof(Tile))) Tile();
+            added.push_back(key);
+        }
+    }
+    for (int i = 0; i < added.size(); i ++)
+    {
+        auto found = this->mTiles.find(added[i]);
+        this->mPool.deallocate(found->second, sizeof(Tile), alignof(Tile));
+        this->mTiles.erase(found);
+    }
+}
+
+void TileMap::set(int x, int y)
+{
+    Tile*& tile = this->mTiles[tileKey(x / TileSize, y / TileSize)];
+    if (!tile)
+    {
+        tile = new (this->mPool.allocate(sizeof(Tile), alignof(Tile))) Tile();
+    }
+    uint64_t bit = uint64_t(1) << (x % TileSize);
+    uint64_t& row = tile->rows[y % TileSize];
+    if (!(row & bit))
+    {
+        row |= bit;
+        tile->count ++;
+    }
+}
+
+void TileMap::clear(int x, int y)
+{
+    auto found = this->mTiles.find(tileKey(x / TileSize, y / TileSize));
+    if (found == this->mTiles.end())
+    {
+        return;
+    }
+    Tile& tile = *found->second;
+    uint64_t bit = uint64_t(1) << (x % TileSize);
+    uint64_t& row = tile.rows[y % TileSize];
+    if (row & bit)
+    {
+        row &= ~bit;
+        tile.count --;
+    }
+    if (tile.count == 0)
+    {
+        this->mPool.deallocate(found->second, sizeof(Tile), alignof(Tile));
+        this->mTiles.erase(found);
+    }
+}
+
+bool TileMap::test(int x, int y) const
+{
+    const Tile* tile = this->findTile(x / TileSize, y / TileSize);
+    return tile && (tile->rows[y % TileSize] >> (x % TileSize)) & 1;
+}
+
+void TileMap::reset()
+{
+    for (auto& entry : this->mTiles)
+    {
+        this->mPool.deallocate(entry.second, sizeof(Tile), alignof(Tile));
+    }
+    this->mTiles.clear();
+}
+
+size_t TileMap::getNumTiles() const
+{
+    return this->mTiles.size();
+}
+
+// Tiles plus a rough cost for the hash table around them
+size_t TileMap::getMemoryUsage() const
+{
+    return this->mTiles.size() * (sizeof(Tile) + 4 * sizeof(void*)) + this->mTiles.bucket_count() * sizeof(void*);
+}
+
+uint64_t TileMap::tileKey(int tileX, int tileY)
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(tileY)) << 32 | static_cast<uint32_t>(tileX);
+}
+
+const TileMap::Tile* TileMap::findTile(int tileX, int tileY) const
+{
+    auto found = this->mTiles.find(tileKey(tileX, tileY));
+    return found == this->mTiles.end() ? nullptr : found->second;
+}
@@ -0,0 +1,89 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <unordered_map>
+#include <algorithm>
+
+// Sparse occupancy for big worlds. Cells are kept in 64x64 tiles of bits
+// that are made when their first cell is set and dropped when their last
+// one is cleared, so memory follows the snake's length and not the area
+// of the world. Coordinates are never negative. Dropped tiles and their
+// entries go back to a pool of the map's own and are used again, so once a
+// game has reserved enough of them setting and clearing cells never touches
+// the heap.
+class TileMap
+{
+public:
+    static const int TileSize = 64;
+
+    TileMap();
+    ~TileMap();
+    TileMap(const TileMap&) = delete;
+    TileMap& operator = (const TileMap&) = delete;
+
+    // Room in the pool for numTiles tiles at once
+    void reserve(size_t numTiles);
+    void set(int x, int y);
+    void clear(int x, int y);
+    bool test(int x, int y) const;
+    void reset();
+    size_t getNumTiles() const;
+    size_t getMemoryUsage() const;
+
+    // Calls function(x, y) for every set cell with x0 <= x < x1 and y0 <= y < y1,
+    // looking only at the tiles that exist in that rectangle
+    template <typename Function>
+    void forEachIn(int x0, int y0, int x1, int y1, Function function) const;
+
+private:
+    struct Tile
+    {
+        uint64_t rows[TileSize];
+        int count;
+    };
+
+    static uint64_t tileKey(int tileX, int tileY);
+    const Tile* findTile(int tileX, int tileY) const;
+
+    std::pmr::unsynchronized_pool_resource mPool;
+    std::pmr::unordered_map<uint64_t, Tile*> mTiles;
+};
+
+template <typename Function>
+void TileMap::forEachIn(int x0, int y0, int x1, int y1, Function function) const
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    for (int tileY = y0 / TileSize; tileY * TileSize < y1; tileY ++)
+    {
+        for (int tileX = x0 / TileSize; tileX * TileSize < x1; tileX ++)
+        {
+            const Tile* tile = this->findTile(tileX, tileY);
+            if (!tile)
+            {
+                continue;
+            }
+            int top = std::max(y0, tileY * TileSize);
+            int bottom = std::min(y1, (tileY + 1) * TileSize);
+            int left = std::max(x0, tileX * TileSize);
+            int right = std::min(x1, (tileX + 1) * TileSize);
+            for (int y = top; y < bottom; y ++)
+            {
+                uint64_t row = tile->rows[y - tileY * TileSize];
+                while (row)
+                {
+                    int x = tileX * TileSize + __builtin_ctzll(row);
+                    row &= row - 1;
+                    if (x >= left && x < right)
+                    {
+                        function(x, y);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
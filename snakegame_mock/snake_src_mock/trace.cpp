@@ -0,0 +1,386 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "trace.h"
+#include "events.h"
+
+namespace
+{
+
+// Records a thread can get ahead of the writer, a power of two
+const int RingSize = 4096;
+// How often the writer empties the rings, and how often while they fill up fast
+const int FlushMilliseconds = 50;
+const int BusyFlushMilliseconds = 1;
+const uint32_t TraceVersion = 1;
+const char TraceMagic[8] = {'S', 'N', 'K', 'T', 'R', 'A', 'C', 'E'};
+
+// One thread records at head, the writer takes from tail
+struct TraceRing
+{
+    TraceRecord records[RingSize];
+    alignas(64) std::atomic<uint64_t> head;
+    // The tail as the recording thread last saw it, it only looks again when the ring seems full
+    uint64_t seenTail;
+    std::atomic<uint64_t> dropped;
+    uint8_t thread;
+    alignas(64) std::atomic<uint64_t> tail;
+    // How many of the dropped records the file was told about
+    uint64_t reported;
+};
+
+// Set while a TraceWriter runs
+std::atomic<bool> gTracing(false);
+// Every ring there is, locked when a thread makes its ring and while the writer goes through them
+std::mutex gRingsMutex;
+thread_local TraceRing* tRing = nullptr;
+
+std::vector<std::unique_ptr<TraceRing>>& getRings()
+{
+    static std::vector<std::unique_ptr<TraceRing>> rings;
+    return rings;
+}
+
+TraceRing& getThreadRing()
+{
+    if (!tRing)
+    {
+        std::lock_guard<std::mutex> lock(gRingsMutex);
+        std::unique_ptr<TraceRing> ring(new TraceRing());
+        ring->head.store(0);
+        ring->seenTail = 0;
+        ring->tail.store(0);
+        ring->dropped.store(0);
+        ring->reported = 0;
+        ring->thread = getRings().size();
+        tRing = ring.get();
+        getRings().push_back(std::move(ring));
+    }
+    return *tRing;
+}
+
+uint64_t traceNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Records are stamped with the time stamp counter where there is one, it
+// reads in half the time of the clock. The writer turns it into nanoseconds.
+uint64_t traceTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return traceNanoseconds();
+#endif
+}
+
+void record(TraceEvent event, TracePhase phase, uint32_t tick, int a, int b, int c, int d)
+{
+    if (!gTracing.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    TraceRing& ring = getThreadRing();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.seenTail >= RingSize)
+    {
+        ring.seenTail = ring.tail.load(std::memory_order_acquire);
+        if (head - ring.seenTail >= RingSize)
+        {
+            ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    TraceRecord& slot = ring.records[head & (RingSize - 1)];
+    slot.timestamp = traceTicks();
+    slot.tick = tick;
+    slot.event = static_cast<uint16_t>(event);
+    slot.phase = static_cast<uint8_t>(phase);
+    slot.thread = ring.thread;
+    slot.values[0] = a;
+    slot.values[1] = b;
+    slot.values[2] = c;
+    slot.values[3] = d;
+    // The writer only reads the slot once it sees the new head
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+bool writeAll(int fd, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written <= 0)
+        {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+void putWord(unsigned char* bytes, uint32_t word)
+{
+    for (int i = 0; i < 4; i ++)
+    {
+        bytes[i] = word >> (8 * i);
+    }
+}
+
+uint32_t getWord(const unsigned char* bytes)
+{
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | uint32_t(bytes[3]) << 24;
+}
+
+}
+
+const char* getTraceEventName(TraceEvent event)
+{
+    switch (event)
+    {
+        case TraceEvent::Tick:
+            return "Tick";
+        case TraceEvent::Sleep:
+            return "Sleep";
+        case TraceEvent::RenderBoards:
+            return "RenderBoards";
+        case TraceEvent::RenderSnake:
+            return "RenderSnake";
+        case TraceEvent::RenderFood:
+            return "RenderFood";
+        case TraceEvent::PresentFrame:
+            return "PresentFrame";
+        case TraceEvent::ReadLeaderBoard:
+            return "ReadLeaderBoard";
+        case TraceEvent::WriteLeaderBoard:
+            return "WriteLeaderBoard";
+        case TraceEvent::GameEvent:
+            return "GameEvent";
+        case TraceEvent::Dropped:
+            return "Dropped";
+    }
+    return "Unknown";
+}
+
+void traceBegin(TraceEvent event, uint32_t tick)
+{
+    record(event, TracePhase::Begin, tick, 0, 0, 0, 0);
+}
+
+void traceEnd(TraceEvent event, uint32_t tick)
+{
+    record(event, TracePhase::End, tick, 0, 0, 0, 0);
+}
+
+void traceInstant(TraceEvent event, uint32_t tick, int a, int b, int c, int d)
+{
+    record(event, TracePhase::Instant, tick, a, b, c, d);
+}
+
+void prepareTraceThread()
+{
+    if (gTracing.load())
+    {
+        getThreadRing();
+    }
+}
+
+TraceSpan::TraceSpan(TraceEvent event, uint32_t tick): mEvent(event), mTick(tick)
+{
+    traceBegin(event, tick);
+}
+
+TraceSpan::~TraceSpan()
+{
+    traceEnd(this->mEvent, this->mTick);
+}
+
+TraceWriter::TraceWriter(): mStopping(false)
+{
+}
+
+TraceWriter::~TraceWriter()
+{
+    this->stop();
+}
+
+bool TraceWriter::start(const std::string& path)
+{
+    if (gTracing.load())
+    {
+        return false;
+    }
+    this->mFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (this->mFd < 0)
+    {
+        return false;
+    }
+    unsigned char header[16];
+    std::memcpy(header, TraceMagic, 8);
+    putWord(header + 8, TraceVersion);
+    putWord(header + 12, sizeof(TraceRecord));
+    if (!writeAll(this->mFd, header, sizeof(header)))
+    {
+        close(this->mFd);
+        this->mFd = -1;
+        return false;
+    }
+    // Room for a full ring and the record of what it dropped
+    this->mBuffer.resize(RingSize + 1);
+    this->mStartTicks = traceTicks();
+    this->mStartNanoseconds = traceNanoseconds();
+    this->mStopping.store(false);
+    gTracing.store(true);
+    this->mThread = std::thread(&TraceWriter::run, this);
+    return true;
+}
+
+void TraceWriter::stop()
+{
+    if (!this->mThread.joinable())
+    {
+        return;
+    }
+    gTracing.store(false);
+    this->mStopping.store(true);
+    this->mThread.join();
+    this->flush();
+    close(this->mFd);
+    this->mFd = -1;
+}
+
+void TraceWriter::run()
+{
+    // Quick at first, a game starts with a burst
+    size_t busiest = RingSize;
+    while (!this->mStopping.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(busiest > RingSize / 4 ? BusyFlushMilliseconds : FlushMilliseconds));
+        busiest = this->flush();
+    }
+}
+
+// Everything the rings hold now, a ring at a time, each thread's records in
+// order. Returns the most records a ring held.
+size_t TraceWriter::flush()
+{
+    std::lock_guard<std::mutex> lock(gRingsMutex);
+    std::vector<std::unique_ptr<TraceRing>>& rings = getRings();
+    // Counter ticks per nanosecond, from the start of the trace to now
+    uint64_t ticks = traceTicks();
+    uint64_t nanoseconds = traceNanoseconds();
+    double rate = ticks > this->mStartTicks ? double(nanoseconds - this->mStartNanoseconds) / (ticks - this->mStartTicks) : 1;
+    size_t busiest = 0;
+    for (int i = 0; i < rings.size(); i ++)
+    {
+        TraceRing& ring = *rings[i];
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        size_t count = 0;
+        for (uint64_t j = tail; j < head; j ++)
+        {
+            TraceRecord& copy = this->mBuffer[count ++];
+            copy = ring.records[j & (RingSize - 1)];
+            copy.timestamp = this->mStartNanoseconds + int64_t(double(int64_t(copy.timestamp - this->mStartTicks)) * rate);
+        }
+        // The slots are free again once they are copied out
+        ring.tail.store(head, std::memory_order_release);
+        uint64_t dropped = ring.dropped.load(std::memory_order_relaxed);
+        if (dropped != ring.reported)
+        {
+            TraceRecord& lost = this->mBuffer[count ++];
+            std::memset(&lost, 0, sizeof(lost));
+            lost.timestamp = nanoseconds;
+            lost.event = static_cast<uint16_t>(TraceEvent::Dropped);
+            lost.phase = static_cast<uint8_t>(TracePhase::Instant);
+            lost.thread = ring.thread;
+            lost.values[0] = dropped - ring.reported;
+            ring.reported = dropped;
+        }
+        writeAll(this->mFd, this->mBuffer.data(), count * sizeof(TraceRecord));
+        busiest = std::max(busiest, count);
+    }
+    return busiest;
+}
+
+bool writeChromeTrace(const std::string& path, std::ostream& out, std::string& error)
+{
+    std::ifstream file(path, std::ios::binary);
+    unsigned char header[16];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || std::memcmp(header, TraceMagic, 8) != 0)
+    {
+        error = path + " is not a trace";
+        return false;
+    }
+    if (getWord(header + 8) != TraceVersion || getWord(header + 12) != sizeof(TraceRecord))
+    {
+        error = path + " is a trace of another version";
+        return false;
+    }
+    std::vector<TraceRecord> records;
+    TraceRecord next;
+    while (file.read(reinterpret_cast<char*>(&next), sizeof(next)))
+    {
+        records.push_back(next);
+    }
+    if (file.gcount() != 0)
+    {
+        error = path + " ends in the middle of a record";
+        return false;
+    }
+    uint64_t first = records.empty() ? 0 : records[0].timestamp;
+    for (int i = 0; i < records.size(); i ++)
+    {
+        first = std::min(first, records[i].timestamp);
+    }
+
+    // Microseconds since the first record, to the nanosecond
+    const char* phases[3] = {"B", "E", "i"};
+    out << "{\"traceEvents\":[";
+    for (int i = 0; i < records.size(); i ++)
+    {
+        const TraceRecord& record = records[i];
+        if (record.event >= NumTraceEvents || record.phase > static_cast<uint8_t>(TracePhase::Instant)
+            || (record.event == static_cast<uint16_t>(TraceEvent::GameEvent) && (record.values[0] < 0 || record.values[0] >= NumGameEventTypes)))
+        {
+            error = path + ": bad record " + std::to_string(i);
+            return false;
+        }
+        TraceEvent event = static_cast<TraceEvent>(record.event);
+        const char* name = event == TraceEvent::GameEvent ? getEventName(static_cast<GameEventType>(record.values[0])) : getTraceEventName(event);
+        char timestamp[32];
+        std::snprintf(timestamp, sizeof(timestamp), "%llu.%03llu", (unsigned long long) (record.timestamp - first) / 1000, (unsigned long long) (record.timestamp - first) % 1000);
+        out << (i ? ",\n" : "\n") << "{\"name\":\"" << name << "\",\"ph\":\"" << phases[record.phase] << "\",\"ts\":" << timestamp
+            << ",\"pid\":1,\"tid\":" << int(record.thread);
+        if (record.phase == static_cast<uint8_t>(TracePhase::Instant))
+        {
+            out << ",\"s\":\"t\"";
+        }
+        out << ",\"args\":{\"tick\":" << record.tick;
+        if (event == TraceEvent::GameEvent)
+        {
+            out << ",\"value\":" << record.values[1] << ",\"x\":" << record.values[2] << ",\"y\":" << record.values[3];
+        }
+        else if (event == TraceEvent::Dropped)
+        {
+            out << ",\"records\":" << record.values[0];
+        }
+        out << "}}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return true;
+}
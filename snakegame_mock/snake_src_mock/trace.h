@@ -0,0 +1,107 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+
+// A trace of where the time of a game goes, for looking into slow frames
+// afterwards. Spans and events are fixed size records that go into a ring
+// of the recording thread's own, which only it writes to and a writer
+// thread empties into a file every now and then: recording takes no lock
+// and makes no system call. snaketrace turns the file into Chrome trace
+// JSON for Perfetto or chrome://tracing.
+enum class TraceEvent
+{
+    Tick,
+    Sleep,
+    RenderBoards,
+    RenderSnake,
+    RenderFood,
+    PresentFrame,
+    ReadLeaderBoard,
+    WriteLeaderBoard,
+    // values are the GameEventType, its value, x and y
+    GameEvent,
+    // The ring was full, values[0] records were lost
+    Dropped,
+};
+const int NumTraceEvents = 10;
+
+const char* getTraceEventName(TraceEvent event);
+
+enum class TracePhase : uint8_t
+{
+    Begin,
+    End,
+    Instant,
+};
+
+// As it is in the file, little endian, after a 16 byte header: "SNKTRACE",
+// the version and the record size, each a 32 bit number
+struct TraceRecord
+{
+    // Steady clock nanoseconds
+    uint64_t timestamp;
+    uint32_t tick;
+    uint16_t event;
+    uint8_t phase;
+    // In the order the threads first recorded
+    uint8_t thread;
+    int32_t values[4];
+};
+static_assert(sizeof(TraceRecord) == 32, "trace records are 32 bytes in the file");
+
+// Quick when no trace is being written, a single flag is checked
+void traceBegin(TraceEvent event, uint32_t tick);
+void traceEnd(TraceEvent event, uint32_t tick);
+void traceInstant(TraceEvent event, uint32_t tick, int a = 0, int b = 0, int c = 0, int d = 0);
+// A thread's ring is made the first time it records, this makes it now,
+// before the game has to stop allocating. Nothing if no trace is written.
+void prepareTraceThread();
+
+// Begin when made, end when it goes out of scope
+class TraceSpan
+{
+public:
+    TraceSpan(TraceEvent event, uint32_t tick);
+    ~TraceSpan();
+
+private:
+    TraceEvent mEvent;
+    uint32_t mTick;
+};
+
+// Writes what every thread records into a file, from a thread of its own.
+// Only one can be running, it is the one the trace functions record for.
+class TraceWriter
+{
+public:
+    TraceWriter();
+    ~TraceWriter();
+
+    bool start(const std::string& path);
+    // What is left in the rings goes out before the file is closed
+    void stop();
+
+private:
+    void run();
+    size_t flush();
+
+    int mFd = -1;
+    std::thread mThread;
+    std::atomic<bool> mStopping;
+    std::vector<TraceRecord> mBuffer;
+    // The counter the records are stamped with and the clock, both when the trace started
+    uint64_t mStartTicks = 0;
+    uint64_t mStartNanoseconds = 0;
+};
+
+// A trace file as Chrome trace event JSON, false with the reason in error
+bool writeChromeTrace(const std::string& path, std::ostream& out, std::string& error);
+
+#endif
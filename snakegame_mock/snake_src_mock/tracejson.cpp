@@ -0,0 +1,33 @@
+// Turns a trace written by "snakegame --trace file" into Chrome trace event
+// JSON, which Perfetto (ui.perfetto.dev) and chrome://tracing open.
+//
+// Usage: snaketrace [trace file] [json file]
+// Without a json file the JSON goes to standard output.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "trace.h"
+
+int main(int argc, char** argv)
+{
+    std::string path = argc > 1 ? argv[1] : "snake.trace";
+    std::string error;
+    bool converted;
+    if (argc > 2)
+    {
+        std::ofstream out(argv[2]);
+        converted = out && writeChromeTrace(path, out, error);
+    }
+    else
+    {
+        converted = writeChromeTrace(path, std::cout, error);
+    }
+    if (!converted)
+    {
+        std::cerr << (error.empty() ? std::string("Cannot write ") + argv[2] : error) << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,11 @@
+#include <string>
+
+#include "game.h"
+
+// Watch a game started with "snakegame --broadcast [name]"
+int main(int argc, char** argv)
+{
+    std::string name = argc > 1 ? argv[1] : DefaultBroadcastName;
+    Game game;
+    game.watchBroadcast(name);
+}